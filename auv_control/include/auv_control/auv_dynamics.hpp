@@ -0,0 +1,198 @@
+#ifndef AUV_DYNAMICS
+#define AUV_DYNAMICS
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "auv_core/constants.hpp"
+#include <algorithm>
+
+namespace auv_control
+{
+// AUV Dynamics
+// Analytic (hand-derived) Jacobian of the 12-state AUV model used by the LQR, templated on the scalar type.
+// This is the same model AUVModel records with CppAD: q0 is held at its reference value, and the signs of the quadratic
+// drag terms are taken from the reference. Also integrates the nonlinear 13-state dynamics (fixed-step RK4) to predict
+// the state. Everything is fixed-size, so nothing is allocated.
+//
+// Notation: q = [q0, qv] (B-frame orientation wrt I-frame), [x]x is the skew-symmetric (cross product) matrix of x.
+// Eigen rotates a vector v by q as: q*v = v + 2*q0*(qv x v) + 2*qv x (qv x v), so
+//    d(q*v)/dv = I + 2*q0*[qv]x + 2*[qv]x^2
+//    d(q*v)/dqv = -2*q0*[v]x + 2*((qv.v)I + qv*v' - 2*v*qv')
+//    d(q.conjugate()*v)/dqv = 2*q0*[v]x + 2*((qv.v)I + qv*v' - 2*v*qv')
+template <typename T>
+class AUVDynamics
+{
+public:
+   typedef Eigen::Matrix<T, 3, 1> Vector3T;
+   typedef Eigen::Matrix<T, 6, 1> Vector6T;
+   typedef Eigen::Matrix<T, 13, 1> Vector13T;
+   typedef Eigen::Matrix<T, 3, 3> Matrix3T;
+   typedef Eigen::Matrix<T, 12, 12> Matrix12T;
+
+private:
+   T mass_, Fg_, Fb_;
+   Matrix3T inertia_, inertiaInv_;
+   Eigen::Matrix<T, 6, 2> dragCoeffs_;
+   Vector3T CoB_;
+
+   static Matrix3T skewSym(const Vector3T &v)
+   {
+      Matrix3T skew;
+      skew << T(0), -v(2), v(1),
+          v(2), T(0), -v(0),
+          -v(1), v(0), T(0);
+      return skew;
+   }
+
+   static T sign(const T &x)
+   {
+      if (x > T(0))
+         return T(1);
+      else if (x < T(0))
+         return T(-1);
+      return T(0);
+   }
+
+   /**
+    * @param q0 Quaternion scalar
+    * @param qv Quaternion vector
+    * @param v Vector being rotated by q.conjugate()
+    * \brief Returns the derivative of q.conjugate()*v wrt qv
+    */
+   static Matrix3T conjugateRotationJacobian(const T &q0, const Vector3T &qv, const Vector3T &v)
+   {
+      return T(2) * q0 * skewSym(v) + T(2) * (qv.dot(v) * Matrix3T::Identity() + qv * v.transpose() - T(2) * v * qv.transpose());
+   }
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   /**
+    * @param Fg Weight [N]
+    * @param Fb Buoyant force [N]
+    * @param CoB Center of buoyancy relative to the center of mass [m]
+    * @param inertia 3x3 inertia matrix [kg-m^2]
+    * @param dragCoeffs Linear and quadratic drag coefficients (column 0: translational, column 1: rotational)
+    */
+   AUVDynamics(double Fg, double Fb,
+               const Eigen::Ref<const Eigen::Vector3d> &CoB,
+               const Eigen::Ref<const Eigen::Matrix3d> &inertia,
+               const Eigen::Ref<const Eigen::Matrix<double, 6, 2> > &dragCoeffs)
+   {
+      Fg_ = T(Fg);
+      Fb_ = T(Fb);
+      mass_ = T(Fg / auv_core::constants::GRAVITY);
+      CoB_ = CoB.cast<T>();
+      inertia_ = inertia.cast<T>();
+      inertiaInv_ = inertia.inverse().cast<T>();
+      dragCoeffs_ = dragCoeffs.cast<T>();
+   }
+
+   /**
+    * @param ref Reference state (13 states)
+    * @param A Linearized (12x12) system matrix, evaluated at the reference
+    * \brief Compute the Jacobian of the 12-state dynamics (all other elements are zero)
+    */
+   void computeSystemMatrix(const Vector13T &ref, Matrix12T &A) const
+   {
+      const T &q0 = ref(auv_core::constants::STATE_Q0);
+      Vector3T qv = ref.template segment<3>(auv_core::constants::STATE_Q1);
+      Vector3T uvw = ref.template segment<3>(auv_core::constants::STATE_U);
+      Vector3T pqr = ref.template segment<3>(auv_core::constants::STATE_P);
+      Matrix3T skewQv = skewSym(qv);
+      A.setZero();
+
+      // 1. Time derivatives of: xI, yI, zI = q*uvw
+      A.template block<3, 3>(auv_core::constants::ESTATE_XI, auv_core::constants::ESTATE_U) = Matrix3T::Identity() + T(2) * q0 * skewQv + T(2) * skewQv * skewQv;
+      A.template block<3, 3>(auv_core::constants::ESTATE_XI, auv_core::constants::ESTATE_Q1) = -T(2) * q0 * skewSym(uvw) + T(2) * (qv.dot(uvw) * Matrix3T::Identity() + qv * uvw.transpose() - T(2) * uvw * qv.transpose());
+
+      // 2. Time derivatives of: U, V, W = (q.conjugate()*weight - transDrag - pqr x uvw) / mass
+      Vector3T weight = Vector3T::Zero();
+      weight(2) = Fg_ - Fb_;
+      Matrix3T transDrag = Matrix3T::Zero();
+      for (int i = 0; i < 3; i++)
+         transDrag(i, i) = dragCoeffs_(i, 0) + T(2) * sign(uvw(i)) * dragCoeffs_(i + 3, 0) * uvw(i);
+      A.template block<3, 3>(auv_core::constants::ESTATE_U, auv_core::constants::ESTATE_U) = (-transDrag - skewSym(pqr)) / mass_;
+      A.template block<3, 3>(auv_core::constants::ESTATE_U, auv_core::constants::ESTATE_Q1) = conjugateRotationJacobian(q0, qv, weight) / mass_;
+      A.template block<3, 3>(auv_core::constants::ESTATE_U, auv_core::constants::ESTATE_P) = skewSym(uvw) / mass_;
+
+      // 3. Time derivatives of: q1, q2, q3 = 0.5 * (q0*pqr + qv x pqr)
+      A.template block<3, 3>(auv_core::constants::ESTATE_Q1, auv_core::constants::ESTATE_Q1) = -T(0.5) * skewSym(pqr);
+      A.template block<3, 3>(auv_core::constants::ESTATE_Q1, auv_core::constants::ESTATE_P) = T(0.5) * (q0 * Matrix3T::Identity() + skewQv);
+
+      // 4. Time derivatives of: P, Q, R = I^(-1) * (CoB x (q.conjugate()*buoyancy) - rotDrag - pqr x I*pqr)
+      Vector3T forceBuoyancy = Vector3T::Zero();
+      forceBuoyancy(2) = -Fb_;
+      Matrix3T rotDrag = Matrix3T::Zero();
+      for (int i = 0; i < 3; i++)
+         rotDrag(i, i) = dragCoeffs_(i, 1) + T(2) * sign(pqr(i)) * dragCoeffs_(i + 3, 1) * pqr(i);
+      A.template block<3, 3>(auv_core::constants::ESTATE_P, auv_core::constants::ESTATE_Q1) = inertiaInv_ * skewSym(CoB_) * conjugateRotationJacobian(q0, qv, forceBuoyancy);
+      A.template block<3, 3>(auv_core::constants::ESTATE_P, auv_core::constants::ESTATE_P) = inertiaInv_ * (-rotDrag - (skewSym(pqr) * inertia_ - skewSym(inertia_ * pqr)));
+   }
+
+   /**
+    * @param state State (13 states)
+    * @param load Thruster forces and moments, expressed in the B-frame
+    * @param stateDot Time derivative of the state
+    * \brief Nonlinear dynamics, the same balance as AUVModel::computeNominalLoad solved for the accelerations
+    */
+   void computeStateDerivative(const Vector13T &state, const Vector6T &load, Vector13T &stateDot) const
+   {
+      const T &q0 = state(auv_core::constants::STATE_Q0);
+      Vector3T qv = state.template segment<3>(auv_core::constants::STATE_Q1);
+      Vector3T uvw = state.template segment<3>(auv_core::constants::STATE_U);
+      Vector3T pqr = state.template segment<3>(auv_core::constants::STATE_P);
+      Eigen::Quaternion<T> quat(q0, qv(0), qv(1), qv(2));
+
+      // 1. xI, yI, zI: q*uvw
+      stateDot.template segment<3>(auv_core::constants::STATE_XI) = quat * uvw;
+
+      // 2. U, V, W: mass*(uvwDot + pqr x uvw) = q.conjugate()*weight - transDrag + force
+      Vector3T weight = Vector3T::Zero();
+      weight(2) = Fg_ - Fb_;
+      Vector3T transDrag;
+      for (int i = 0; i < 3; i++)
+         transDrag(i) = dragCoeffs_(i, 0) * uvw(i) + sign(uvw(i)) * dragCoeffs_(i + 3, 0) * uvw(i) * uvw(i);
+      stateDot.template segment<3>(auv_core::constants::STATE_U) = (quat.conjugate() * weight - transDrag + load.template head<3>()) / mass_ - pqr.cross(uvw);
+
+      // 3. q0, q1, q2, q3: 0.5 * q x [0, pqr]
+      stateDot(auv_core::constants::STATE_Q0) = -T(0.5) * qv.dot(pqr);
+      stateDot.template segment<3>(auv_core::constants::STATE_Q1) = T(0.5) * (q0 * pqr + qv.cross(pqr));
+
+      // 4. P, Q, R: I*pqrDot = CoB x (q.conjugate()*buoyancy) - rotDrag - pqr x I*pqr + moment
+      Vector3T forceBuoyancy = Vector3T::Zero();
+      forceBuoyancy(2) = -Fb_;
+      Vector3T rotDrag;
+      for (int i = 0; i < 3; i++)
+         rotDrag(i) = dragCoeffs_(i, 1) * pqr(i) + sign(pqr(i)) * dragCoeffs_(i + 3, 1) * pqr(i) * pqr(i);
+      stateDot.template segment<3>(auv_core::constants::STATE_P) = inertiaInv_ * (CoB_.cross(quat.conjugate() * forceBuoyancy) - rotDrag - pqr.cross(inertia_ * pqr) + load.template tail<3>());
+   }
+
+   /**
+    * @param state Initial state, replaced by the predicted state
+    * @param load Thruster forces and moments (held constant), expressed in the B-frame
+    * @param time Prediction horizon [s]
+    * @param steps Number of (fixed) RK4 steps
+    * \brief Integrate the nonlinear dynamics over the horizon. The quaternion is renormalized after every step.
+    */
+   void predictState(Vector13T &state, const Vector6T &load, const T &time, int steps) const
+   {
+      T h = time / T(std::max(steps, 1));
+      Vector13T k1, k2, k3, k4, stage;
+      for (int i = 0; i < steps; i++)
+      {
+         computeStateDerivative(state, load, k1);
+         stage = state + T(0.5) * h * k1;
+         computeStateDerivative(stage, load, k2);
+         stage = state + T(0.5) * h * k2;
+         computeStateDerivative(stage, load, k3);
+         stage = state + h * k3;
+         computeStateDerivative(stage, load, k4);
+         state += (h / T(6)) * (k1 + T(2) * k2 + T(2) * k3 + k4);
+         state.template segment<4>(auv_core::constants::STATE_Q0).normalize();
+      }
+   }
+};
+} // namespace auv_control
+
+#endif
\ No newline at end of file
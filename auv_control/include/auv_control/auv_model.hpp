@@ -5,11 +5,28 @@
 #include "eigen3/Eigen/Dense"
 #include "eigen3/Eigen/Core"
 #include "auv_control/nominal_thrust_solver.hpp"
+#include "auv_control/thrust_allocator.hpp"
+#include "auv_control/saturated_thrust_allocator.hpp"
+#include "auv_control/gain_schedule.hpp"
+#include "auv_control/feed_forward_schedule.hpp"
+#include "auv_control/kleinman_riccati_solver.hpp"
+#include "auv_control/dare_doubling_solver.hpp"
+#include "auv_control/ltv_mpc_solver.hpp"
+#include "auv_control/auv_dynamics.hpp"
 #include "auv_core/math_lib.hpp"
 #include "auv_core/constants.hpp"
+#include "auv_core/latency_histogram.hpp"
+#include "auv_core/triple_buffer.hpp"
 #include <cppad/cppad.hpp>
 #include "math.h"
+#include <errno.h>
+#include <semaphore.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // Add new typedefs to Eigen namespace so we can use CppAD with it
 namespace Eigen
@@ -51,62 +68,331 @@ typedef Eigen::Matrix<double, 12, 1> Vector12d;
 typedef Eigen::Matrix<double, 8, 1> Vector8d;
 typedef Eigen::Matrix<double, 6, 1> Vector6d;
 
+// Abstract AUV Model
+// Interface to AUVModel that does not depend on the number of thrusters (a template parameter of AUVModel).
+// Use create() to instantiate the smallest AUVModel that fits the vehicle. Everything off the control loop takes
+// dynamic-size arguments, computeLQRThrust returns a fixed-capacity vector, so it still does not allocate.
+class AbstractAUVModel
+{
+public:
+   // Supported thruster counts (AUVModel is instantiated for each of these)
+   static const int MAX_THRUSTERS = 10;
+   static const int NUM_THRUSTER_SIZES = 3;
+   static const int THRUSTER_SIZES[NUM_THRUSTER_SIZES];
+   typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MAX_THRUSTERS, 1> ThrustVector; // Size is the model's thruster count
+
+   // Nominal thrust solvers
+   static const int NOMINAL_THRUST_PINV = 0;  // Closed-form weighted pseudo-inverse (default)
+   static const int NOMINAL_THRUST_CERES = 1; // Nonlinear least squares with Ceres
+
+   // System matrix (Jacobian) methods
+   static const int JACOBIAN_ANALYTIC = 0; // Hand-derived Jacobian, see AUVDynamics (default)
+   static const int JACOBIAN_AUTODIFF = 1; // CppAD tape
+
+   // LQR (Riccati equation) solvers
+   static const int LQR_SOLVER_SCHUR = 0;    // ct_optcon LQR, solved from scratch every time (default)
+   static const int LQR_SOLVER_KLEINMAN = 1; // Newton-Kleinman, warm-started from the previous solution (falls back to ct_optcon)
+   static const int LQR_SOLVER_DISCRETE = 2; // Discrete-time LQR at the control period, DARE by doubling (falls back to ct_optcon)
+
+   // Stages of computeLQRThrust, timed separately
+   static const int STAGE_NOMINAL_THRUST = 0; // Nominal (feed-forward) thrust solve, or feed-forward schedule interpolation
+   static const int STAGE_JACOBIAN = 1;       // Linearization about the reference
+   static const int STAGE_RICCATI = 2;        // Riccati solve (or gain schedule interpolation, or the MPC QP)
+   static const int STAGE_GAIN_MULTIPLY = 3;  // Error state and feedback (gain multiply)
+   static const int STAGE_SATURATION = 4;     // Thrust allocation within the thruster limits
+   static const int STAGE_TOTAL = 5;          // Entire computeLQRThrust call
+   static const int NUM_STAGES = 6;
+   static const char *const STAGE_NAMES[NUM_STAGES];
+
+   static const double PREDICTION_STEP; // Longest RK4 step of predictState [s]
+
+   static AbstractAUVModel *create(double Fg, double Fb,
+                                   const Eigen::Ref<const Eigen::Vector3d> &CoB,
+                                   const Eigen::Ref<const Eigen::Matrix3d> &inertia,
+                                   const Eigen::Ref<const Matrix62d> &dragCoeffs,
+                                   const Eigen::Ref<const Eigen::MatrixXd> &thrusterData,
+                                   int numThrusters);
+   virtual ~AbstractAUVModel() {}
+
+   virtual int getNumThrusters() = 0;
+   virtual int getMaxThrusters() = 0;
+
+   virtual void setLQRCostMatrices(const Eigen::Ref<const Matrix12d> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R) = 0;
+   virtual void setLQRIntegralCostMatrices(const Eigen::Ref<const Matrix18d> &augQ, const Eigen::Ref<const Eigen::MatrixXd> &R) = 0;
+   virtual bool reconfigureLQRCostMatrices(const Eigen::Ref<const Eigen::MatrixXd> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R) = 0;
+   virtual bool isLQRReconfigurePending() = 0;
+   virtual void setNominalThrustSolver(int solver) = 0;
+   virtual void setLQRSolver(int solver) = 0;
+   virtual void setControlPeriod(double period) = 0;
+   virtual void setJacobianMethod(int method) = 0;
+   virtual void setThrustLimits(const Eigen::Ref<const Eigen::VectorXd> &minThrust, const Eigen::Ref<const Eigen::VectorXd> &maxThrust, int maxIterations) = 0;
+
+   virtual bool buildGainSchedule(const std::vector<std::vector<double> > &breakpoints) = 0;
+   virtual bool loadGainSchedule(const std::string &file, const std::vector<std::vector<double> > &breakpoints) = 0;
+   virtual bool saveGainSchedule(const std::string &file) = 0;
+
+   virtual bool startGainThread() = 0;
+   virtual void stopGainThread() = 0;
+
+   virtual const auv_core::LatencyHistogram &getStageLatency(int stage) = 0;
+   virtual void resetStageLatency() = 0;
+
+   virtual bool setThrusterHealth(unsigned int healthMask) = 0;
+   virtual unsigned int getThrusterHealth() = 0;
+   virtual bool isThrusterHealthReady(unsigned int healthMask) = 0;
+
+   virtual bool checkNominalThrust(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel, double tolerance) = 0;
+
+   virtual void setLinearizedSystemMatrix(const Eigen::Ref<const Vector13d> &ref) = 0;
+   virtual Matrix12d getLinearizedSystemMatrix() = 0;
+
+   virtual ThrustVector computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
+                                         const Eigen::Ref<const Vector13d> &ref,
+                                         const Eigen::Ref<const Vector6d> &accel) = 0;
+
+   virtual bool compileFeedForward(const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                   const Eigen::Ref<const Eigen::MatrixXd> &accels,
+                                   double period, bool compileGains) = 0;
+   virtual FeedForwardSchedule *buildFeedForward(const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                                 const Eigen::Ref<const Eigen::MatrixXd> &accels,
+                                                 double period, bool compileGains) = 0;
+   virtual FeedForwardSchedule *swapFeedForward(FeedForwardSchedule *schedule) = 0;
+   virtual void clearFeedForward() = 0;
+   virtual ThrustVector computeLQRThrust(const Eigen::Ref<const Vector13d> &state, double time) = 0;
+
+   virtual Vector13d predictState(const Eigen::Ref<const Vector13d> &state, const ThrustVector &thrust, double time) = 0;
+
+   virtual bool setMPCHorizon(int horizon, double timeStep, int maxIterations) = 0;
+   virtual int getMPCHorizon() = 0;
+   virtual int getMPCIterations() = 0;
+   virtual ThrustVector computeMPCThrust(const Eigen::Ref<const Vector13d> &state,
+                                         const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                         const Eigen::Ref<const Eigen::MatrixXd> &accels) = 0;
+
+   virtual bool setCascadedControl(double innerPeriod, double outerPeriod) = 0;
+   virtual void computeCascadedOuterLoop(const Eigen::Ref<const Vector13d> &state,
+                                         const Eigen::Ref<const Vector13d> &ref,
+                                         const Eigen::Ref<const Vector6d> &accel) = 0;
+   virtual ThrustVector computeCascadedInnerLoop(const Eigen::Ref<const Vector13d> &state) = 0;
+};
+
 // AUV Model
 // Contains information about an AUV's attributes: mass, volume inertia, drag, and thruster properties
 // Used to compute any jacobians and state vectors required by TransEKF and LQR
-class AUVModel
+// N is the number of thrusters the matrices are sized for (at compile time). Vehicles with fewer (enabled) thrusters
+// leave the remaining columns of the thrust coefficients at zero.
+template <int N>
+class AUVModel : public AbstractAUVModel
 {
+public:
+   typedef Eigen::Matrix<double, N, 1> VectorNd;
+   typedef Eigen::Matrix<double, N, N> MatrixNd;
+   typedef Eigen::Matrix<double, 5, N> Matrix5xNd;
+   typedef Eigen::Matrix<double, 6, N> Matrix6xNd;
+   typedef Eigen::Matrix<double, N, 6> MatrixNx6d;
+   typedef Eigen::Matrix<double, 12, N> Matrix12xNd;
+   typedef Eigen::Matrix<double, 18, N> Matrix18xNd;
+   typedef Eigen::Matrix<double, N, 12> MatrixNx12d;
+   typedef Eigen::Matrix<double, N, 18> MatrixNx18d;
+
+private:
    typedef Eigen::Matrix<CppAD::AD<double>, 3, 3> ADMatrix3d;
    typedef Eigen::Matrix<CppAD::AD<double>, Eigen::Dynamic, 1> ADVectorXd;
    typedef Eigen::Matrix<CppAD::AD<double>, 3, 1> ADVector3d;
 
-private:
+   // LQR gains, as published by the gain thread
+   struct LQRGains
+   {
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      MatrixNx12d K;    // Gain matrix
+      MatrixNx18d augK; // Augmented gain matrix
+   };
+
+   // LQR cost matrices requested by reconfigureLQRCostMatrices
+   struct LQRCosts
+   {
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      Matrix12d Q;
+      Matrix18d augQ;
+      MatrixNd R;
+   };
+
+   // Command from the cascaded outer loop to the inner loop
+   struct CascadeCommand
+   {
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      Vector6d load;  // Nominal load, plus the translational feedback force
+      Vector13d ref;  // Reference state (the inner loop tracks its attitude and angular velocity)
+      bool valid;     // False until the outer loop runs
+   };
+
+   // Matrices that depend on which thrusters are healthy
+   struct ThrusterConfig
+   {
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      VectorNd healthy;      // 1 if the thruster is healthy, 0 otherwise
+      MatrixNx6d allocation; // Weighted pseudo-inverse of the healthy thrusters' coefficients (see ThrustAllocator)
+      Matrix12xNd B;         // Control input matrix (columns of failed thrusters are zero)
+      Matrix18xNd augB;      // Augmented control input matrix
+   };
+
    double mass_, Fg_, Fb_;
-   int numThrusters_, maxThrusters_;
+   int numThrusters_;
    Eigen::Matrix3d inertia_; // Inertia 3x3 matrix
    Matrix62d dragCoeffs_;
-   Matrix58d thrusterData_;
-   Matrix68d thrustCoeffs_;
+   Matrix5xNd thrusterData_;
+   Matrix6xNd thrustCoeffs_;
    Eigen::Vector3d CoB_; // Center of buoyancy position relative to CoM
 
    // LQR Matrices
    Matrix12d A_;      // (Linearized) system matrix
    Matrix18d augA_;   // (Linearized) augmented system matrix
-   Matrix12x8d B_;    // Control input matrix
-   Matrix18x8d augB_; // Augmented control input matrix
-   Matrix8x12d K_;    // Gain matrix
-   Matrix8x18d augK_; // Augmented gain matrix
+   Matrix12xNd B_;    // Control input matrix (all thrusters healthy)
+   Matrix18xNd augB_; // Augmented control input matrix (all thrusters healthy)
+   MatrixNx12d K_;    // Gain matrix
+   MatrixNx18d augK_; // Augmented gain matrix
    Matrix12d Q_;      // State cost matrix
    Matrix18d augQ_;   // Augmented state cost matrix
-   Matrix8d R_;       // Input cost matrix
+   MatrixNd R_;       // Input cost matrix
 
    // LQR Variables
-   Vector8d totalThrust_;
-   Vector8d lqrThrust_;
+   VectorNd totalThrust_;
+   VectorNd lqrThrust_;
    Vector12d error_;
    Vector18d augError_;
    Eigen::Vector3d positionIntegralError_;
    Eigen::Quaterniond qState_, qRef_, qError_, qIntegralError_;
 
+   // Nominal Thrust
+   int nominalThrustSolver_;
+
+   // Thrust Saturation
+   // If enabled, the total thrust is reallocated within the thruster limits (failed thrusters are limited to zero)
+   SaturatedThrustAllocator<N> saturatedAllocator_;
+   VectorNd minThrust_, maxThrust_;
+   bool enableThrustLimits_;
+
+   // Thruster Health
+   // The allocation and input matrices are precomputed for every combination of healthy (enabled) thrusters, indexed by
+   // the health bitmask (bit i is set if thruster i is healthy), so switching configurations does no solver work.
+   // The full-health configuration is computed by the constructor, the rest by the config thread.
+   std::vector<ThrusterConfig, Eigen::aligned_allocator<ThrusterConfig> > thrusterConfigs_;
+   std::atomic<bool> *thrusterConfigReady_;
+   std::atomic<unsigned int> thrusterHealth_;
+   std::thread *configThread_;
+   std::atomic<bool> stopConfigThread_;
+
    // Ceres Problem
+   NominalThrustCostFunction<N> *nominalThrustCost_; // Owned by the problem
    ceres::Problem problemNominalThrust;
    ceres::Solver::Options optionsNominalThrust;
    ceres::Solver::Summary summaryNominalThrust;
-   double nominalThrust_[8];
+   double nominalThrust_[N];
    double quaternion_[4], uvw_[3], pqr_[3], inertialTransAccel_[3], pqrDot_[3];
 
+   // Analytic Jacobian of the dynamics
+   AUVDynamics<double> *dynamics_;
+   int jacobianMethod_;
+
+   // Auto-diff tape for the system matrix
+   // The tape is recorded once. The reference-dependent terms (q0 and the signs of the quadratic drag terms) are
+   // CppAD dynamic parameters, so each tick only evaluates the (sparse) Jacobian.
+   static const int TAPE_DYN_Q0 = 0;     // Index of q0 in the dynamic parameter vector
+   static const int TAPE_DYN_SIGN_U = 1; // Indices 1-3: sign(U), sign(V), sign(W)
+   static const int TAPE_DYN_SIGN_P = 4; // Indices 4-6: sign(P), sign(Q), sign(R)
+   static const int TAPE_NUM_DYN = 7;
+   CppAD::ADFun<double> systemTape_;
+   std::vector<double> tapeX_, tapeDynamic_;
+   CppAD::sparse_rc<std::vector<size_t> > jacPattern_;
+   CppAD::sparse_rcv<std::vector<size_t>, std::vector<double> > jacSubset_;
+   CppAD::sparse_jac_work jacWork_;
+
    // LQR Setup
    // The ct_optcon LQR solver requires these sizes be defined at compile time (unfortunately)
    static const size_t state_dim = 12;
    static const size_t state_dim_aug = 18;
-   static const size_t control_dim = 8;
+   static const size_t control_dim = N;
    ct::optcon::LQR<state_dim, control_dim> lqrSolver_;
    ct::optcon::LQR<state_dim_aug, control_dim> lqrAugSolver_;
+   KleinmanRiccatiSolver<state_dim, control_dim> kleinmanSolver_;
+   KleinmanRiccatiSolver<state_dim_aug, control_dim> kleinmanAugSolver_;
+   DAREDoublingSolver<state_dim, control_dim> dareSolver_;
+   DAREDoublingSolver<state_dim_aug, control_dim> dareAugSolver_;
    bool initLQR_, enableLQRIntegral_;
+   int lqrSolverType_;
+
+   // Live Reconfiguration
+   // New cost matrices wait in pendingCosts_ until the thread that solves for the gains applies them: the gain thread if
+   // it runs (so the control thread keeps the previous gains until the new ones are published), otherwise the control
+   // thread at the start of its next tick. Neither waits on costMutex_. costVersion_ counts the applied changes.
+   std::mutex costMutex_;
+   LQRCosts pendingCosts_;
+   std::atomic<bool> costsPending_;
+   std::atomic<unsigned int> costVersion_;
+
+   // Gain Schedule (if NULL, the gains are computed every tick)
+   GainSchedule *gainSchedule_;
+
+   // Feed-Forward Schedule (if NULL, computeLQRThrust(state, time) returns zero thrust)
+   // The current trajectory's reference, acceleration, and nominal thrust (optionally its gains) at each control tick.
+   // The nominal thrusts (and gains) are only used while the thruster health matches the one they were computed for, and
+   // the gains only while the cost matrices are the ones they were computed with (feedForwardCostsMatch_ at the swap).
+   FeedForwardSchedule *feedForward_;
+   unsigned int feedForwardHealth_, feedForwardCostVersion_;
+   bool feedForwardCostsMatch_;
+   Vector13d feedForwardRef_;
+   Vector6d feedForwardAccel_;
+   VectorNd feedForwardThrust_;
+   MatrixNx12d feedForwardK_;
+   MatrixNx18d feedForwardAugK_;
+
+   // Gain Thread
+   // If running, the gain thread relinearizes and solves for the gains at its own pace, and computeLQRThrust only
+   // applies the most recently published gains. The thread owns A_, K_, and augK_ while it runs.
+   std::thread *gainThread_;
+   std::atomic<bool> stopGainThread_;
+   sem_t gainSignal_; // Posted after new work for the gain thread (sem_post never blocks the control thread)
+   auv_core::TripleBuffer<Vector13d> refBuffer_; // Control thread -> gain thread
+   auv_core::TripleBuffer<LQRGains> gainBuffer_; // Gain thread -> control thread
+
+   // MPC
+   // Linear time-varying MPC about the reference trajectory, an alternative to the LQR (see computeMPCThrust).
+   // The inputs are the thrust deviations from the nominal thrust at each step.
+   LTVMPCSolver<12, N> mpcSolver_;
+   std::vector<VectorNd, Eigen::aligned_allocator<VectorNd> > mpcNominalThrust_;
+   double mpcTimeStep_;
+
+   // Cascaded Control
+   // Decoupled translational (outer loop) and rotational (inner loop) LQR designs, with the loads (forces and moments) as
+   // inputs, each at its own loop period. The outer loop hands its command to the inner loop through a triple buffer, so
+   // the loops can run on separate threads. Only the inner loop thread touches cascadeAllocator_ and cascadeHealth_.
+   Eigen::Matrix<double, 3, 6> outerK_, innerK_;
+   auv_core::TripleBuffer<CascadeCommand> cascadeBuffer_;
+   SaturatedThrustAllocator<N> cascadeAllocator_;
+   unsigned int cascadeHealth_; // Health mask cascadeAllocator_ is configured for
+   bool initCascade_;
+
+   // Latency of each stage of computeLQRThrust [us] (the Jacobian and Riccati stages are timed on the gain thread if it runs)
+   auv_core::LatencyHistogram stageLatency_[NUM_STAGES];
 
    void setThrustCoeffs();
-   void setLinearizedSystemMatrix(const Eigen::Ref<const Vector13d> &ref);
+   void recordSystemTape();
+   void setAutoDiffSystemMatrix(const Eigen::Ref<const Vector13d> &ref);
    void setLinearizedInputMatrix();
+   void setInputCostMatrix(const Eigen::Ref<const Eigen::MatrixXd> &R);
+   void applyPendingCosts();
+   void setThrusterConfig(unsigned int healthMask);
+   void runConfigThread();
+   Vector6d computeNominalLoad(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel);
+   VectorNd solveNominalThrustCeres(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel);
+   void computeLQRGains(const Eigen::Ref<const Vector13d> &ref);
+   ThrustVector computeFeedbackThrust(const Eigen::Ref<const Vector13d> &state,
+                                      const Eigen::Ref<const Vector13d> &ref,
+                                      const Eigen::Ref<const VectorNd> &nominalThrust,
+                                      bool feedForwardGains);
+   void clearGainSchedule();
+   void notifyGainThread();
+   void runGainThread();
 
 public:
    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -115,16 +401,73 @@ public:
             const Eigen::Ref<const Eigen::Vector3d> &CoB,
             const Eigen::Ref<const Eigen::Matrix3d> &inertia,
             const Eigen::Ref<const Matrix62d> &dragCoeffs,
-            const Eigen::Ref<const Matrix58d> &thrusterData,
+            const Eigen::Ref<const Eigen::MatrixXd> &thrusterData,
             int numThrusters);
+   ~AUVModel();
+
+   int getNumThrusters();
+   int getMaxThrusters();
+
+   void setLQRCostMatrices(const Eigen::Ref<const Matrix12d> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R);
+   void setLQRIntegralCostMatrices(const Eigen::Ref<const Matrix18d> &augQ, const Eigen::Ref<const Eigen::MatrixXd> &R);
+   bool reconfigureLQRCostMatrices(const Eigen::Ref<const Eigen::MatrixXd> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R);
+   bool isLQRReconfigurePending();
+   void setNominalThrustSolver(int solver);
+   void setLQRSolver(int solver);
+   void setControlPeriod(double period);
+   void setJacobianMethod(int method);
+   void setThrustLimits(const Eigen::Ref<const Eigen::VectorXd> &minThrust, const Eigen::Ref<const Eigen::VectorXd> &maxThrust, int maxIterations);
+
+   bool buildGainSchedule(const std::vector<std::vector<double> > &breakpoints);
+   bool loadGainSchedule(const std::string &file, const std::vector<std::vector<double> > &breakpoints);
+   bool saveGainSchedule(const std::string &file);
+
+   bool startGainThread();
+   void stopGainThread();
+
+   const auv_core::LatencyHistogram &getStageLatency(int stage);
+   void resetStageLatency();
+
+   bool setThrusterHealth(unsigned int healthMask);
+   unsigned int getThrusterHealth();
+   bool isThrusterHealthReady(unsigned int healthMask);
+
+   VectorNd computeNominalThrust(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel);
+   bool checkNominalThrust(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel, double tolerance);
+
+   void setLinearizedSystemMatrix(const Eigen::Ref<const Vector13d> &ref);
+   Matrix12d getLinearizedSystemMatrix();
+   Matrix12xNd getLinearizedInputMatrix();
+
+   Vector6d getTotalThrustLoad(const Eigen::Ref<const VectorNd> &thrusts);
+   ThrustVector computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
+                                 const Eigen::Ref<const Vector13d> &ref,
+                                 const Eigen::Ref<const Vector6d> &accel);
+
+   bool compileFeedForward(const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                           const Eigen::Ref<const Eigen::MatrixXd> &accels,
+                           double period, bool compileGains);
+   FeedForwardSchedule *buildFeedForward(const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                         const Eigen::Ref<const Eigen::MatrixXd> &accels,
+                                         double period, bool compileGains);
+   FeedForwardSchedule *swapFeedForward(FeedForwardSchedule *schedule);
+   void clearFeedForward();
+   ThrustVector computeLQRThrust(const Eigen::Ref<const Vector13d> &state, double time);
+
+   Vector13d predictState(const Eigen::Ref<const Vector13d> &state, const ThrustVector &thrust, double time);
 
-   void setLQRCostMatrices(const Eigen::Ref<const Matrix12d> &Q, const Eigen::Ref<const Matrix8d> &R);
-   void setLQRIntegralCostMatrices(const Eigen::Ref<const Matrix18d> &augQ, const Eigen::Ref<const Matrix8d> &R);
+   bool setMPCHorizon(int horizon, double timeStep, int maxIterations);
+   int getMPCHorizon();
+   int getMPCIterations();
+   ThrustVector computeMPCThrust(const Eigen::Ref<const Vector13d> &state,
+                                 const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                 const Eigen::Ref<const Eigen::MatrixXd> &accels);
 
-   Vector6d getTotalThrustLoad(const Eigen::Ref<const Vector8d> &thrusts);
-   Vector8d computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
-                             const Eigen::Ref<const Vector13d> &ref,
-                             const Eigen::Ref<const Vector6d> &accel);
+   bool setCascadedControl(double innerPeriod, double outerPeriod);
+   void computeCascadedOuterLoop(const Eigen::Ref<const Vector13d> &state,
+                                 const Eigen::Ref<const Vector13d> &ref,
+                                 const Eigen::Ref<const Vector6d> &accel);
+   ThrustVector computeCascadedInnerLoop(const Eigen::Ref<const Vector13d> &state);
 };
 } // namespace auv_control
 
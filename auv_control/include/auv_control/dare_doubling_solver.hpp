@@ -0,0 +1,221 @@
+#ifndef DARE_DOUBLING_SOLVER
+#define DARE_DOUBLING_SOLVER
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "math.h"
+#include <algorithm>
+
+namespace auv_control
+{
+// DARE Doubling Solver
+// Designs discrete-time LQR gains for a continuous-time system sampled at a fixed control period T (zero-order hold):
+// 1. Discretize: [Ad Bd; 0 I] = exp([A B; 0 0]*T), with a degree-6 Pade approximant and scaling and squaring
+// 2. Solve the discrete-time algebraic Riccati equation (DARE) P = Ad'P Ad - Ad'P Bd(R + Bd'P Bd)^(-1)Bd'P Ad + Q with the
+//    structured doubling algorithm (SDA). Starting from A_0 = Ad, G_0 = Bd R^(-1)Bd', H_0 = Q, each step computes
+//       W = I + G_k H_k
+//       A_(k+1) = A_k W^(-1) A_k,   G_(k+1) = G_k + A_k W^(-1) G_k A_k',   H_(k+1) = H_k + A_k' H_k W^(-1) A_k
+//    and H_k converges quadratically to P (each step doubles the horizon, so ~10 steps are enough for 2^10 samples).
+// 3. K = (R + Bd'P Bd)^(-1) Bd'P Ad, so u_k = -K*e_k
+// Q and R are used as-is: scaling both by T (the sampled equivalent of the continuous cost) does not change K.
+// Everything is fixed-size, so compute() does not allocate.
+template <int N, int M>
+class DAREDoublingSolver
+{
+public:
+   typedef Eigen::Matrix<double, N, N> StateMatrix;
+   typedef Eigen::Matrix<double, N, M> InputMatrix;
+   typedef Eigen::Matrix<double, M, M> ControlMatrix;
+   typedef Eigen::Matrix<double, M, N> GainMatrix;
+   typedef Eigen::Matrix<double, N + M, N + M> ExpMatrix;
+
+private:
+   StateMatrix Ad_, P_;
+   InputMatrix Bd_;
+   double period_, tolerance_;
+   int maxIterations_, iterations_;
+
+   // Doubling variables
+   StateMatrix Ak_, Gk_, Hk_, W_, WinvA_, WinvG_, Hnext_;
+   Eigen::PartialPivLU<StateMatrix> Wlu_;
+   Eigen::LLT<ControlMatrix> Rllt_;
+   Eigen::LDLT<ControlMatrix> Sldlt_;
+
+   // Discretization variables
+   ExpMatrix X_, X2_, Xk_, U_, V_, E_;
+   Eigen::PartialPivLU<ExpMatrix> Vlu_;
+
+   /**
+    * @param A System matrix
+    * @param B Input matrix
+    * \brief Zero-order hold discretization at the control period (sets Ad_ and Bd_)
+    */
+   void discretize(const StateMatrix &A, const InputMatrix &B)
+   {
+      // Pade(6,6) coefficients: exp(X) ~ (V - U)^(-1)(V + U), with the even powers in V and the odd powers in U
+      static const double c[7] = {1.0, 1.0 / 2.0, 5.0 / 44.0, 1.0 / 66.0, 1.0 / 792.0, 1.0 / 15840.0, 1.0 / 665280.0};
+
+      X_.setZero();
+      X_.template topLeftCorner<N, N>() = A * period_;
+      X_.template topRightCorner<N, M>() = B * period_;
+
+      // Scale so |X| <= 0.5, where the approximant is accurate to machine precision
+      double norm = X_.cwiseAbs().rowwise().sum().maxCoeff();
+      int squarings = (norm > 0.5) ? (int)ceil(log2(norm / 0.5)) : 0;
+      X_ *= pow(2.0, -squarings);
+
+      X2_.noalias() = X_ * X_;
+      V_ = c[0] * ExpMatrix::Identity() + c[2] * X2_;
+      U_ = c[1] * ExpMatrix::Identity() + c[3] * X2_;
+      Xk_.noalias() = X2_ * X2_;
+      V_ += c[4] * Xk_;
+      U_ += c[5] * Xk_;
+      E_.noalias() = Xk_ * X2_;
+      Xk_ = E_;
+      V_ += c[6] * Xk_;
+      E_.noalias() = X_ * U_;
+      U_ = E_;
+
+      Vlu_.compute(V_ - U_);
+      E_ = Vlu_.solve(V_ + U_);
+      for (int i = 0; i < squarings; i++)
+      {
+         Xk_.noalias() = E_ * E_;
+         E_ = Xk_;
+      }
+
+      Ad_ = E_.template topLeftCorner<N, N>();
+      Bd_ = E_.template topRightCorner<N, M>();
+   }
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   /**
+    * @param period Control period [s]
+    * @param maxIterations Maximum number of doubling steps per solve
+    * @param tolerance Convergence tolerance, on the change in P relative to its largest element
+    */
+   DAREDoublingSolver(double period = 0.02, int maxIterations = 30, double tolerance = 1e-10)
+   {
+      period_ = std::max(fabs(period), 1e-6);
+      maxIterations_ = std::max(1, maxIterations);
+      tolerance_ = fabs(tolerance);
+      iterations_ = 0;
+      Ad_.setIdentity();
+      Bd_.setZero();
+      P_.setZero();
+   }
+
+   /**
+    * @param period Control period [s]
+    */
+   void setPeriod(double period)
+   {
+      period_ = std::max(fabs(period), 1e-6);
+   }
+
+   double getPeriod()
+   {
+      return period_;
+   }
+
+   /**
+    * \brief Returns the number of doubling steps used by the last call to compute()
+    */
+   int getIterations()
+   {
+      return iterations_;
+   }
+
+   /**
+    * \brief Returns the Riccati solution P of the last successful solve
+    */
+   StateMatrix getRiccatiSolution()
+   {
+      return P_;
+   }
+
+   /**
+    * \brief Returns the discrete-time system matrix of the last solve
+    */
+   StateMatrix getDiscreteSystemMatrix()
+   {
+      return Ad_;
+   }
+
+   /**
+    * \brief Returns the discrete-time input matrix of the last solve
+    */
+   InputMatrix getDiscreteInputMatrix()
+   {
+      return Bd_;
+   }
+
+   /**
+    * @param Q State cost matrix
+    * @param R Input cost matrix
+    * @param A Continuous-time system matrix
+    * @param B Continuous-time input matrix
+    * @param K Discrete-time gain matrix (only modified if successful)
+    * \brief Discretize the system at the control period and solve the DARE. Returns false if the doubling does not
+    * converge (e.g. the system is not stabilizable).
+    */
+   bool compute(const StateMatrix &Q, const ControlMatrix &R, const StateMatrix &A, const InputMatrix &B, GainMatrix &K)
+   {
+      iterations_ = 0;
+      Rllt_.compute(R);
+      if (Rllt_.info() != Eigen::Success)
+         return false;
+
+      DAREDoublingSolver::discretize(A, B);
+
+      Ak_ = Ad_;
+      Gk_.noalias() = Bd_ * Rllt_.solve(Bd_.transpose());
+      Hk_ = Q;
+      for (iterations_ = 1; iterations_ <= maxIterations_; iterations_++)
+      {
+         W_.setIdentity();
+         W_.noalias() += Gk_ * Hk_;
+         Wlu_.compute(W_);
+         WinvA_ = Wlu_.solve(Ak_);
+         WinvG_ = Wlu_.solve(Gk_);
+
+         Hnext_ = Hk_;
+         Hnext_.noalias() += Ak_.transpose() * Hk_ * WinvA_;
+         Hnext_ = 0.5 * (Hnext_ + Hnext_.transpose()).eval();
+         Gk_.noalias() += Ak_ * WinvG_ * Ak_.transpose();
+         Gk_ = 0.5 * (Gk_ + Gk_.transpose()).eval();
+         W_.noalias() = Ak_ * WinvA_;
+         Ak_ = W_;
+
+         if (!Hnext_.allFinite() || !Ak_.allFinite())
+            return false;
+
+         // A_k = (Ad - Bd*K)^(2^k) once converged, so it only vanishes if the closed loop is stable
+         double change = (Hnext_ - Hk_).cwiseAbs().maxCoeff();
+         Hk_ = Hnext_;
+         if (change <= tolerance_ * std::max(1.0, Hk_.cwiseAbs().maxCoeff()) && Ak_.cwiseAbs().maxCoeff() < 1.0)
+         {
+            // K = (R + Bd'P Bd)^(-1) Bd'P Ad
+            GainMatrix BtP = Bd_.transpose() * Hk_;
+            ControlMatrix S = R;
+            S.noalias() += BtP * Bd_;
+            Sldlt_.compute(S);
+            GainMatrix Knew = Sldlt_.solve(BtP * Ad_);
+            if (Sldlt_.info() != Eigen::Success || !Knew.allFinite())
+               return false;
+
+            P_ = Hk_;
+            K = Knew;
+            return true;
+         }
+      }
+
+      iterations_ = maxIterations_;
+      return false;
+   }
+};
+} // namespace auv_control
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FEED_FORWARD_SCHEDULE
+#define FEED_FORWARD_SCHEDULE
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "auv_core/constants.hpp"
+#include "math.h"
+#include <algorithm>
+
+namespace auv_control
+{
+typedef Eigen::Matrix<double, 13, 1> Vector13d;
+typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+// Feed-Forward Schedule
+// Time-indexed table of a trajectory's reference state, feed-forward acceleration, and nominal thrust (optionally also its
+// LQR gains), sampled at a fixed period when the trajectory is created. The reference only depends on time, so the
+// controller interpolates (linearly) from the table instead of evaluating the trajectory and solving for the nominal
+// thrust every tick. Times before the first or after the last sample are clamped to it. The schedule also records the
+// thruster health and cost matrices it was computed for, so it can be built by one AUV model and used by another.
+class FeedForwardSchedule
+{
+private:
+   double period_;
+   int numSamples_, numThrusters_, gainRows_, gainCols_;
+   Eigen::MatrixXd refs_, accels_, thrusts_, gains_; // One column per sample (gain matrices are stored column-major)
+   unsigned int healthMask_;
+   Eigen::MatrixXd Q_, R_;
+
+   int getIndex(double time, double &fraction);
+
+public:
+   FeedForwardSchedule(int numSamples, double period, int numThrusters, int gainRows = 0, int gainCols = 0);
+
+   int getNumSamples();
+   double getPeriod();
+   double getDuration();
+   bool hasGains();
+
+   void setConfig(unsigned int healthMask, const Eigen::Ref<const Eigen::MatrixXd> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R);
+   unsigned int getHealth();
+   bool hasCosts(const Eigen::Ref<const Eigen::MatrixXd> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R);
+
+   void setSample(int index, const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel,
+                  const Eigen::Ref<const Eigen::VectorXd> &thrust);
+   void setGain(int index, const Eigen::Ref<const Eigen::MatrixXd> &K);
+   void interpolate(double time, Vector13d &ref, Vector6d &accel, Eigen::Ref<Eigen::VectorXd> thrust);
+   void interpolateGain(double time, Eigen::Ref<Eigen::MatrixXd> K);
+};
+} // namespace auv_control
+
+#endif
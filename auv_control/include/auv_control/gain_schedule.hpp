@@ -0,0 +1,79 @@
+#ifndef GAIN_SCHEDULE
+#define GAIN_SCHEDULE
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "auv_core/constants.hpp"
+#include "auv_core/rot3d.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace auv_control
+{
+typedef Eigen::Matrix<double, 13, 1> Vector13d;
+typedef Eigen::Matrix<double, 9, 1> Vector9d;
+
+// Gain Schedule
+// Lookup table of LQR gains over a grid of reference states. The linearized system matrix only depends on the reference
+// attitude and body-frame velocities, so the gains are computed once at each grid point and interpolated (multi-linear)
+// at runtime, instead of solving the Riccati equation every tick.
+// Scheduling variables: [roll, pitch, yaw, U, V, W, P, Q, R]. A variable with a single breakpoint is not scheduled.
+// Values outside of the grid are clamped to the nearest breakpoint.
+class GainSchedule
+{
+private:
+   int gainRows_, gainCols_, numPoints_;
+   std::vector<std::vector<double> > breakpoints_;
+   std::vector<int> strides_;
+   std::vector<float> gains_; // Gain matrices (column-major), stored as floats to keep the table compact
+   Eigen::MatrixXd Q_, R_;    // Cost matrices used to compute the gains
+
+   // Interpolation variables (allocated once)
+   std::vector<int> activeVars_, lowerIndex_;
+   std::vector<double> fraction_;
+   Eigen::VectorXd interpGain_;
+
+   static const char FILE_ID[4];
+   static const int32_t FILE_VERSION = 1;
+
+   void initGrid();
+
+public:
+   // Indices of the scheduling variables
+   static const int SCHED_ROLL = 0;
+   static const int SCHED_PITCH = 1;
+   static const int SCHED_YAW = 2;
+   static const int SCHED_U = 3;
+   static const int SCHED_V = 4;
+   static const int SCHED_W = 5;
+   static const int SCHED_P = 6;
+   static const int SCHED_Q = 7;
+   static const int SCHED_R = 8;
+   static const int NUM_SCHED_VARS = 9;
+
+   GainSchedule();
+   GainSchedule(const std::vector<std::vector<double> > &breakpoints,
+                const Eigen::Ref<const Eigen::MatrixXd> &Q,
+                const Eigen::Ref<const Eigen::MatrixXd> &R);
+
+   static Vector9d getScheduleVariables(const Eigen::Ref<const Vector13d> &ref);
+
+   int getNumPoints();
+   std::vector<std::vector<double> > getBreakpoints();
+   Vector13d getReference(int index);
+   Eigen::MatrixXd getGain(int index);
+   void setGain(int index, const Eigen::Ref<const Eigen::MatrixXd> &K);
+   bool isCompatible(const std::vector<std::vector<double> > &breakpoints,
+                     const Eigen::Ref<const Eigen::MatrixXd> &Q,
+                     const Eigen::Ref<const Eigen::MatrixXd> &R);
+   void interpolate(const Eigen::Ref<const Vector13d> &ref, Eigen::Ref<Eigen::MatrixXd> K);
+
+   bool save(const std::string &file);
+   bool load(const std::string &file);
+};
+} // namespace auv_control
+
+#endif
\ No newline at end of file
@@ -0,0 +1,212 @@
+#ifndef KLEINMAN_RICCATI_SOLVER
+#define KLEINMAN_RICCATI_SOLVER
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "eigen3/Eigen/Eigenvalues"
+#include "math.h"
+#include <algorithm>
+
+namespace auv_control
+{
+// Kleinman Riccati Solver
+// Solves the continuous-time algebraic Riccati equation (CARE) A'P + PA - PBR^(-1)B'P + Q = 0 with the Newton-Kleinman
+// iteration, warm-started from the previous solution. Each iteration solves one Lyapunov equation for the closed-loop
+// system (A - BK). Since the linearization changes very little between control ticks, the previous gain is (almost
+// always) stabilizing and close to the new solution, so only one or two iterations are needed.
+// compute() returns false if there is no previous gain, the previous gain no longer stabilizes the system, or the
+// iteration does not converge. The caller is expected to fall back to a cold (Schur-based) solver and call
+// setInitialGain() with its solution.
+template <int N, int M>
+class KleinmanRiccatiSolver
+{
+public:
+   typedef Eigen::Matrix<double, N, N> StateMatrix;
+   typedef Eigen::Matrix<double, N, M> InputMatrix;
+   typedef Eigen::Matrix<double, M, M> ControlMatrix;
+   typedef Eigen::Matrix<double, M, N> GainMatrix;
+
+private:
+   GainMatrix K_;
+   StateMatrix P_;
+   bool init_;
+   int maxIterations_, iterations_;
+   double tolerance_;
+
+   // Lyapunov solver variables
+   Eigen::RealSchur<StateMatrix> schur_;
+   StateMatrix F_, X_;
+   int blockStart_[N], blockSize_[N];
+
+   // Sylvester equations for the Schur blocks are at most 4x4 (allocated on the stack)
+   typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 4, 4> SylvesterMatrix;
+   typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 4, 1> SylvesterVector;
+   Eigen::LLT<ControlMatrix> Rllt_;
+
+   /**
+    * @param Ac Closed-loop system matrix
+    * @param C Right-hand side (symmetric)
+    * @param P Solution
+    * \brief Solve the Lyapunov equation Ac'P + PAc + C = 0 (Bartels-Stewart, with the real Schur form of Ac).
+    * Returns false if Ac is not stable (the solution would not be the stabilizing one).
+    */
+   bool solveLyapunov(const StateMatrix &Ac, const StateMatrix &C, StateMatrix &P)
+   {
+      // Ac = U*T*U', so T'X + XT = -U'CU, where X = U'PU
+      schur_.compute(Ac, true);
+      if (schur_.info() != Eigen::Success)
+         return false;
+
+      const StateMatrix &T = schur_.matrixT();
+      const StateMatrix &U = schur_.matrixU();
+
+      // T is quasi upper-triangular: 1x1 blocks (real eigenvalues) and 2x2 blocks (complex conjugate pairs)
+      int numBlocks = 0;
+      for (int i = 0; i < N; numBlocks++)
+      {
+         blockStart_[numBlocks] = i;
+         blockSize_[numBlocks] = (i + 1 < N && T(i + 1, i) != 0) ? 2 : 1;
+         double realPart = (blockSize_[numBlocks] == 1) ? T(i, i) : 0.5 * (T(i, i) + T(i + 1, i + 1));
+         if (realPart >= 0)
+            return false;
+         i += blockSize_[numBlocks];
+      }
+
+      F_.noalias() = U.transpose() * C * U;
+      F_ = -F_;
+
+      // T' is block lower-triangular and T is block upper-triangular, so solve for X one block at a time
+      // Block (I,J): T_II'X_IJ + X_IJ T_JJ = F_IJ - sum(K<I) T_KI'X_KJ - sum(K<J) X_IK T_KJ
+      for (int bj = 0; bj < numBlocks; bj++)
+      {
+         int j = blockStart_[bj], q = blockSize_[bj];
+         for (int bi = 0; bi < numBlocks; bi++)
+         {
+            int i = blockStart_[bi], p = blockSize_[bi];
+            Eigen::Matrix2d rhs;
+            rhs.topLeftCorner(p, q) = F_.block(i, j, p, q);
+            if (i > 0)
+               rhs.topLeftCorner(p, q) -= T.block(0, i, i, p).transpose() * X_.block(0, j, i, q);
+            if (j > 0)
+               rhs.topLeftCorner(p, q) -= X_.block(i, 0, p, j) * T.block(0, j, j, q);
+
+            // Small Sylvester equation, solved as (I kron T_II' + T_JJ' kron I) vec(X_IJ) = vec(rhs)
+            SylvesterMatrix kron = SylvesterMatrix::Zero(p * q, p * q);
+            SylvesterVector vecRhs(p * q);
+            for (int c = 0; c < q; c++)
+            {
+               kron.block(c * p, c * p, p, p) += T.block(i, i, p, p).transpose();
+               for (int d = 0; d < q; d++)
+                  kron.block(c * p, d * p, p, p).diagonal().array() += T(j + d, j + c);
+               vecRhs.segment(c * p, p) = rhs.block(0, c, p, 1);
+            }
+            SylvesterVector vecX = kron.partialPivLu().solve(vecRhs);
+            for (int c = 0; c < q; c++)
+               X_.block(i, j + c, p, 1) = vecX.segment(c * p, p);
+         }
+      }
+
+      P.noalias() = U * X_ * U.transpose();
+      P = 0.5 * (P + P.transpose()).eval();
+      return true;
+   }
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   /**
+    * @param maxIterations Maximum number of Newton iterations per solve
+    * @param tolerance Convergence tolerance, on the change in the gain relative to its norm
+    */
+   KleinmanRiccatiSolver(int maxIterations = 10, double tolerance = 1e-6)
+   {
+      maxIterations_ = std::max(1, maxIterations);
+      tolerance_ = fabs(tolerance);
+      iterations_ = 0;
+      KleinmanRiccatiSolver::reset();
+   }
+
+   /**
+    * \brief Forget the previous solution (the next call to compute() will fail)
+    */
+   void reset()
+   {
+      K_.setZero();
+      P_.setZero();
+      init_ = false;
+   }
+
+   /**
+    * @param K Stabilizing gain matrix (i.e. the solution from another solver) to warm-start the next solve from
+    */
+   void setInitialGain(const Eigen::Ref<const GainMatrix> &K)
+   {
+      K_ = K;
+      init_ = true;
+   }
+
+   /**
+    * \brief Returns the number of Newton iterations used by the last call to compute()
+    */
+   int getIterations()
+   {
+      return iterations_;
+   }
+
+   /**
+    * \brief Returns the Riccati solution P of the last successful solve
+    */
+   StateMatrix getRiccatiSolution()
+   {
+      return P_;
+   }
+
+   /**
+    * @param Q State cost matrix
+    * @param R Input cost matrix
+    * @param A System matrix
+    * @param B Input matrix
+    * @param K Gain matrix (only modified if successful)
+    * \brief Solve the CARE, warm-started from the previous solution. Returns true if successful.
+    */
+   bool compute(const StateMatrix &Q, const ControlMatrix &R, const StateMatrix &A, const InputMatrix &B, GainMatrix &K)
+   {
+      iterations_ = 0;
+      if (!init_)
+         return false;
+
+      Rllt_.compute(R);
+      if (Rllt_.info() != Eigen::Success)
+         return false;
+
+      GainMatrix Kiter = K_;
+      StateMatrix P, Ac, C;
+      for (iterations_ = 1; iterations_ <= maxIterations_; iterations_++)
+      {
+         // P solves (A - BK)'P + P(A - BK) + Q + K'RK = 0
+         Ac.noalias() = A - B * Kiter;
+         C.noalias() = Q + Kiter.transpose() * R * Kiter;
+         if (!KleinmanRiccatiSolver::solveLyapunov(Ac, C, P))
+            return false;
+
+         // Improved gain: K = R^(-1)B'P
+         GainMatrix Knew = Rllt_.solve(B.transpose() * P);
+         double change = (Knew - Kiter).norm();
+         Kiter = Knew;
+
+         if (change <= tolerance_ * std::max(1.0, Knew.norm()))
+         {
+            K_ = Kiter;
+            P_ = P;
+            K = Kiter;
+            return true;
+         }
+      }
+
+      iterations_ = maxIterations_;
+      return false;
+   }
+};
+} // namespace auv_control
+
+#endif
\ No newline at end of file
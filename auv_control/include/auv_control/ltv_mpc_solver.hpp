@@ -0,0 +1,297 @@
+#ifndef LTV_MPC_SOLVER
+#define LTV_MPC_SOLVER
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "eigen3/Eigen/StdVector"
+#include "math.h"
+#include <algorithm>
+#include <vector>
+
+namespace auv_control
+{
+// LTV MPC Solver
+// Solves the linear time-varying MPC problem over a horizon of H steps:
+//    min sum(k=1..H) e_k'Q e_k + sum(k=0..H-1) u_k'R u_k
+//    subject to e_(k+1) = A_k e_k + B_k u_k, uMin_k <= u_k <= uMax_k, e_0 given
+// Eliminating the states gives a QP in the inputs only, but its Hessian is dense and badly conditioned (the input cost is
+// small compared to the state cost). Instead, the KKT system is kept in its block-banded form and factorized with a
+// Riccati recursion, O(H) instead of O(H^3). The input bounds are handled with ADMM (copy z of the inputs, constrained to
+// the bounds):
+//    1. u = argmin J(u) + rho/2*|u - z + w|^2 (an LQ problem: one backward and one forward sweep with the factorization)
+//    2. z = clamp(u + w)
+//    3. w = w + u - z
+// The factorization only depends on the dynamics, so it is computed once per solve and each iteration only costs a
+// backward and forward substitution.
+// Each solve is warm-started from the previous solution shifted by one step, and is limited to a fixed number of
+// iterations. The returned inputs (z) are always within the bounds. All buffers are allocated by setHorizon(), so
+// solve() does not allocate.
+template <int N, int M>
+class LTVMPCSolver
+{
+public:
+   typedef Eigen::Matrix<double, N, 1> StateVector;
+   typedef Eigen::Matrix<double, M, 1> InputVector;
+   typedef Eigen::Matrix<double, N, N> StateMatrix;
+   typedef Eigen::Matrix<double, N, M> InputMatrix;
+   typedef Eigen::Matrix<double, M, M> ControlMatrix;
+   typedef Eigen::Matrix<double, M, N> GainMatrix;
+
+private:
+   typedef std::vector<StateVector, Eigen::aligned_allocator<StateVector> > StateSequence;
+   typedef std::vector<InputVector, Eigen::aligned_allocator<InputVector> > InputSequence;
+   typedef std::vector<StateMatrix, Eigen::aligned_allocator<StateMatrix> > StateMatrixSequence;
+   typedef std::vector<InputMatrix, Eigen::aligned_allocator<InputMatrix> > InputMatrixSequence;
+   typedef std::vector<ControlMatrix, Eigen::aligned_allocator<ControlMatrix> > ControlMatrixSequence;
+   typedef std::vector<GainMatrix, Eigen::aligned_allocator<GainMatrix> > GainMatrixSequence;
+
+   int horizon_, maxIterations_, iterations_;
+   double rho_, tolerance_;
+   StateMatrix Q_;
+   ControlMatrix R_;
+
+   // Problem data (set by the caller before each solve)
+   StateMatrixSequence A_;
+   InputMatrixSequence B_;
+   InputSequence uMin_, uMax_;
+
+   // Riccati factorization: u_k = -K_k*e_k - Sinv_k*(B_k'p_(k+1) + q_k)/2
+   GainMatrixSequence K_;
+   ControlMatrixSequence Sinv_;
+   StateMatrix P_;
+   Eigen::LLT<ControlMatrix> Sllt_;
+   GainMatrix BtP_;
+
+   // ADMM variables
+   InputSequence u_, z_, w_, zPrev_, q_;
+   StateSequence e_, p_;
+   bool init_;
+
+   /**
+    * \brief Backward Riccati recursion for the LQ subproblem (input cost R + rho/2*I)
+    */
+   void factorize()
+   {
+      P_ = Q_;
+      for (int k = horizon_ - 1; k >= 0; k--)
+      {
+         BtP_.noalias() = B_[k].transpose() * P_;
+         ControlMatrix S = R_;
+         S.diagonal().array() += 0.5 * rho_;
+         S.noalias() += BtP_ * B_[k];
+         Sllt_.compute(S);
+         Sinv_[k] = Sllt_.solve(ControlMatrix::Identity());
+         K_[k].noalias() = Sinv_[k] * (BtP_ * A_[k]);
+
+         // P_k = Q + A'P(A - BK) (no state cost on e_0, it is fixed)
+         StateMatrix Acl = A_[k];
+         Acl.noalias() -= B_[k] * K_[k];
+         StateMatrix Pnext;
+         Pnext.noalias() = A_[k].transpose() * P_ * Acl;
+         P_ = 0.5 * (Pnext + Pnext.transpose());
+         if (k > 0)
+            P_ += Q_;
+      }
+   }
+
+   /**
+    * @param e0 Initial state
+    * \brief Solve the LQ subproblem for the linear input cost q_ (backward sweep), then roll out the inputs (forward sweep)
+    */
+   void solveSubproblem(const StateVector &e0)
+   {
+      p_[horizon_].setZero();
+      for (int k = horizon_ - 1; k >= 0; k--)
+      {
+         InputVector h = q_[k];
+         h.noalias() += B_[k].transpose() * p_[k + 1];
+         p_[k].noalias() = A_[k].transpose() * p_[k + 1];
+         p_[k].noalias() -= K_[k].transpose() * h;
+         u_[k] = h; // Stored until the forward sweep
+      }
+
+      e_[0] = e0;
+      for (int k = 0; k < horizon_; k++)
+      {
+         InputVector h = u_[k];
+         u_[k].noalias() = -K_[k] * e_[k];
+         u_[k].noalias() -= 0.5 * Sinv_[k] * h;
+         e_[k + 1].noalias() = A_[k] * e_[k];
+         e_[k + 1].noalias() += B_[k] * u_[k];
+      }
+   }
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   /**
+    * @param maxIterations Maximum number of ADMM iterations per solve
+    * @param rho ADMM penalty (in the units of the input cost)
+    * @param tolerance Convergence tolerance, on the primal and dual residuals relative to the inputs
+    */
+   LTVMPCSolver(int maxIterations = 50, double rho = 1.0, double tolerance = 1e-4)
+   {
+      maxIterations_ = std::max(1, maxIterations);
+      rho_ = std::max(fabs(rho), 1e-9);
+      tolerance_ = fabs(tolerance);
+      iterations_ = 0;
+      horizon_ = 0;
+      init_ = false;
+      Q_.setIdentity();
+      R_.setIdentity();
+   }
+
+   /**
+    * @param horizon Number of steps in the horizon (allocates the buffers, not for use in the control loop)
+    */
+   void setHorizon(int horizon)
+   {
+      horizon_ = std::max(1, horizon);
+      A_.assign(horizon_, StateMatrix::Identity());
+      B_.assign(horizon_, InputMatrix::Zero());
+      uMin_.assign(horizon_, InputVector::Constant(-INFINITY));
+      uMax_.assign(horizon_, InputVector::Constant(INFINITY));
+      K_.assign(horizon_, GainMatrix::Zero());
+      Sinv_.assign(horizon_, ControlMatrix::Zero());
+      u_.assign(horizon_, InputVector::Zero());
+      z_.assign(horizon_, InputVector::Zero());
+      w_.assign(horizon_, InputVector::Zero());
+      zPrev_.assign(horizon_, InputVector::Zero());
+      q_.assign(horizon_, InputVector::Zero());
+      e_.assign(horizon_ + 1, StateVector::Zero());
+      p_.assign(horizon_ + 1, StateVector::Zero());
+      init_ = false;
+   }
+
+   int getHorizon()
+   {
+      return horizon_;
+   }
+
+   void setMaxIterations(int maxIterations)
+   {
+      maxIterations_ = std::max(1, maxIterations);
+   }
+
+   /**
+    * @param rho ADMM penalty. Convergence is fastest with rho a few times the input cost.
+    */
+   void setPenalty(double rho)
+   {
+      rho_ = std::max(fabs(rho), 1e-9);
+   }
+
+   /**
+    * @param Q State cost matrix
+    * @param R Input cost matrix
+    */
+   void setCostMatrices(const StateMatrix &Q, const ControlMatrix &R)
+   {
+      Q_ = Q;
+      R_ = R;
+   }
+
+   /**
+    * @param k Step in the horizon
+    * @param A Discrete-time system matrix from step k to k+1
+    * @param B Discrete-time input matrix from step k to k+1
+    * @param uMin Minimum input at step k
+    * @param uMax Maximum input at step k
+    */
+   void setStep(int k, const StateMatrix &A, const InputMatrix &B, const InputVector &uMin, const InputVector &uMax)
+   {
+      A_[k] = A;
+      B_[k] = B;
+      uMin_[k] = uMin.cwiseMin(uMax);
+      uMax_[k] = uMax.cwiseMax(uMin);
+   }
+
+   /**
+    * \brief Forget the previous solution (the next solve starts from zero inputs)
+    */
+   void reset()
+   {
+      init_ = false;
+   }
+
+   /**
+    * \brief Returns the number of iterations used by the last call to solve()
+    */
+   int getIterations()
+   {
+      return iterations_;
+   }
+
+   /**
+    * @param k Step in the horizon
+    * \brief Returns the input at step k of the last solution (within the bounds)
+    */
+   const InputVector &getInput(int k)
+   {
+      return z_[k];
+   }
+
+   /**
+    * @param e0 Initial state
+    * \brief Solve the QP, warm-started from the previous solution (shifted by one step). Returns true if it converged
+    * within the iteration limit (the inputs are within their bounds either way).
+    */
+   bool solve(const StateVector &e0)
+   {
+      // Warm start: the previous solution and (scaled) multipliers, one step later
+      if (init_)
+      {
+         for (int k = 0; k + 1 < horizon_; k++)
+         {
+            z_[k] = z_[k + 1];
+            w_[k] = w_[k + 1];
+         }
+      }
+      else
+      {
+         for (int k = 0; k < horizon_; k++)
+         {
+            z_[k].setZero();
+            w_[k].setZero();
+         }
+      }
+      for (int k = 0; k < horizon_; k++)
+         z_[k] = z_[k].cwiseMax(uMin_[k]).cwiseMin(uMax_[k]);
+      init_ = true;
+
+      LTVMPCSolver::factorize();
+
+      bool converged = false;
+      for (iterations_ = 1; iterations_ <= maxIterations_; iterations_++)
+      {
+         // rho/2*|u - (z - w)|^2 adds a linear input cost of -rho*(z - w)
+         for (int k = 0; k < horizon_; k++)
+            q_[k] = -rho_ * (z_[k] - w_[k]);
+         LTVMPCSolver::solveSubproblem(e0);
+
+         double primal = 0, dual = 0, norm = 0;
+         for (int k = 0; k < horizon_; k++)
+         {
+            zPrev_[k] = z_[k];
+            z_[k] = (u_[k] + w_[k]).cwiseMax(uMin_[k]).cwiseMin(uMax_[k]);
+            w_[k] += u_[k] - z_[k];
+            primal += (u_[k] - z_[k]).squaredNorm();
+            dual += (z_[k] - zPrev_[k]).squaredNorm();
+            norm += z_[k].squaredNorm();
+         }
+
+         double tolerance = tolerance_ * tolerance_ * std::max(1.0, norm);
+         if (primal <= tolerance && dual <= tolerance)
+         {
+            converged = true;
+            break;
+         }
+      }
+
+      iterations_ = std::min(iterations_, maxIterations_);
+      return converged;
+   }
+};
+} // namespace auv_control
+
+#endif
@@ -11,15 +11,21 @@ namespace auv_control
 {
 typedef Eigen::Matrix<double, 6, 1> Vector6d;
 typedef Eigen::Matrix<double, 6, 2> Matrix62d;
-typedef Eigen::Matrix<double, 6, 8> Matrix68d;
+
+// Nominal Thrust Solver
+// Residuals of the vehicle dynamics for the N thruster forces (Ceres functor)
+template <int N>
 class NominalThrustSolver
 {
+public:
+   typedef Eigen::Matrix<double, 6, N> Matrix6xNd;
+
 private:
    double mass_, Fg_, Fb_;
    Eigen::Matrix3d inertia_;    // Inertia matrix expressed in B-frame
    Eigen::Vector3d CoB_;        // Center of buoyancy relative to center of mass
    Matrix62d dragCoeffs_;       // 1st and 2nd order drag coefficients for translational and rotational motion
-   Matrix68d thrustCoeffs_;     // Thrust coefficients (effective contributions of each thruster for force and moment)
+   Matrix6xNd thrustCoeffs_;    // Thrust coefficients (effective contributions of each thruster for force and moment)
    double *quaternion_;         // (Pointer) to quaternion for orientation
    double *uvw_;                // (Pointer) Inertial translational velocity expressed in B-frame (U, V, W)
    double *pqr_;                // (Pointer) Angular velocity expressed in B-frame (P, Q, R)
@@ -31,7 +37,7 @@ private:
 public:
    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
    NominalThrustSolver(double Fg, double Fb, const Eigen::Ref<const Eigen::Vector3d> &CoB, const Eigen::Ref<const Eigen::Matrix3d> &inertia,
-                       const Eigen::Ref<const Matrix62d> &dragCoeffs, const Eigen::Ref<const Matrix68d> &thrustCoeffs,
+                       const Eigen::Ref<const Matrix62d> &dragCoeffs, const Eigen::Ref<const Matrix6xNd> &thrustCoeffs,
                        double *quaternion, double *uvw, double *pqr, double *inertialTransAccel, double *pqrDot)
    {
       Fg_ = Fg;
@@ -48,6 +54,14 @@ public:
       pqrDot_ = pqrDot;
    }
 
+   /**
+    * @param thrustCoeffs Thrust coefficients (e.g. with the columns of failed thrusters set to zero)
+    */
+   void setThrustCoeffs(const Eigen::Ref<const Matrix6xNd> &thrustCoeffs)
+   {
+      thrustCoeffs_ = thrustCoeffs;
+   }
+
    template <typename T>
    bool operator()(const T *const nominalForces, T *residuals) const
    {
@@ -56,7 +70,7 @@ public:
 
       // Cast Eigen objects to Jet type
       Eigen::Matrix<T, 6, 2> dragCoeffsT = dragCoeffs_.cast<T>();
-      Eigen::Matrix<T, 6, 8> thrustCoeffsT = thrustCoeffs_.cast<T>();
+      Eigen::Matrix<T, 6, N> thrustCoeffsT = thrustCoeffs_.template cast<T>();
       Eigen::Matrix<T, 3, 3> inertiaT = inertia_.cast<T>();
       Eigen::Matrix<T, 3, 1> CoBT = CoB_.cast<T>();
 
@@ -71,9 +85,9 @@ public:
       }
 
       // Map ceres parameters and residuals to Eigen object with Jet type
-      typedef Eigen::Matrix<T, 8, 1> Vector8T;
+      typedef Eigen::Matrix<T, N, 1> VectorNT;
       typedef Eigen::Matrix<T, 6, 1> Vector6T;
-      Eigen::Map<const Vector8T> nominalForcesT(nominalForces);
+      Eigen::Map<const VectorNT> nominalForcesT(nominalForces);
       Eigen::Map<Vector6T> residualsT(residuals);
 
       // Compute quaternion
@@ -96,7 +110,7 @@ public:
       // Net_F = ma OR
       // 0 = ma - Net_F
       residualsT.template head<3>() = (T(mass_) * inertialTransAccelT) - (quatT.conjugate() * weightT - transDragT +
-                                                                          (thrustCoeffsT.template block<3, 8>(0, 0)) * nominalForcesT);
+                                                                          (thrustCoeffsT.template block<3, N>(0, 0)) * nominalForcesT);
 
       // Rotational Equations
       Eigen::Matrix<T, 3, 1> forceBuoyancyT, rotDragT;
@@ -113,11 +127,59 @@ public:
       // Net_Moment = Iw + w x Iw OR
       // 0 = Iw + w x Iw - Net_Moment
       residualsT.template tail<3>() = inertialRotAccelT - (CoBT.cross(quatT.conjugate() * forceBuoyancyT) - rotDragT +
-                                                           (thrustCoeffsT.template block<3, 8>(3, 0)) * nominalForcesT);
+                                                           (thrustCoeffsT.template block<3, N>(3, 0)) * nominalForcesT);
       return true;
    }
 };
 
+// Nominal Thrust Cost Function
+// The NominalThrustSolver residuals are linear in the thrusts (residuals = ... - thrustCoeffs * thrusts), so the Jacobian
+// is constant and known. This avoids evaluating the residuals with Ceres Jets (ceres::AutoDiffCostFunction).
+template <int N>
+class NominalThrustCostFunction : public ceres::SizedCostFunction<6, N>
+{
+private:
+   NominalThrustSolver<N> *solver_;
+   Eigen::Matrix<double, 6, N, Eigen::RowMajor> jacobian_;
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   /**
+    * @param solver Residual functor (the cost function takes ownership)
+    * @param thrustCoeffs Thrust coefficients (effective contributions of each thruster for force and moment)
+    */
+   NominalThrustCostFunction(NominalThrustSolver<N> *solver, const Eigen::Ref<const Eigen::Matrix<double, 6, N> > &thrustCoeffs)
+   {
+      solver_ = solver;
+      jacobian_ = -thrustCoeffs;
+   }
+
+   virtual ~NominalThrustCostFunction()
+   {
+      delete solver_;
+   }
+
+   /**
+    * @param thrustCoeffs Thrust coefficients, replaces the ones given to the solver and the constructor.
+    * A thruster with a zero column has no effect on the residuals, so Ceres leaves its thrust at the initial value.
+    */
+   void setThrustCoeffs(const Eigen::Ref<const Eigen::Matrix<double, 6, N> > &thrustCoeffs)
+   {
+      solver_->setThrustCoeffs(thrustCoeffs);
+      jacobian_ = -thrustCoeffs;
+   }
+
+   virtual bool Evaluate(double const *const *parameters, double *residuals, double **jacobians) const
+   {
+      if (jacobians != NULL && jacobians[0] != NULL)
+      {
+         Eigen::Map<Eigen::Matrix<double, 6, N, Eigen::RowMajor> > jacobian(jacobians[0]);
+         jacobian = jacobian_;
+      }
+      return (*solver_)(parameters[0], residuals);
+   }
+};
 } // namespace auv_control
 
 #endif
\ No newline at end of file
@@ -0,0 +1,237 @@
+#ifndef SATURATED_THRUST_ALLOCATOR
+#define SATURATED_THRUST_ALLOCATOR
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "math.h"
+#include <algorithm>
+
+namespace auv_control
+{
+// Saturated Thrust Allocator
+// Finds the thrusts, within each thruster's limits, that best produce the load (forces and moments) of a desired thrust:
+//    min |C*(f - fDes)|^2 + eps*|f - fDes|^2   subject to   minThrust <= f <= maxThrust
+// where C is the thrust coefficient matrix. The second term makes the problem strictly convex (C has more columns than
+// rows) and picks the solution closest to the desired thrust. If the desired thrust is within the limits, it is returned.
+// The box-constrained QP is solved with a primal active-set method. The iterate is always feasible and the cost never
+// increases, so if the iteration limit is reached, the current iterate is returned (the budget is hard).
+// The active set is kept between calls (warm start): the same thrusters tend to saturate on consecutive control ticks, so
+// one or two iterations are usually enough. Nothing is allocated on the heap.
+template <int N>
+class SaturatedThrustAllocator
+{
+public:
+   typedef Eigen::Matrix<double, N, 1> VectorNd;
+   typedef Eigen::Matrix<double, N, N> MatrixNd;
+   typedef Eigen::Matrix<double, 6, N> Matrix6xNd;
+
+   // State of each thruster in the active set
+   static const int FREE = 0;
+   static const int AT_MIN = -1;
+   static const int AT_MAX = 1;
+
+private:
+   MatrixNd H_; // Hessian: C'C + eps*I
+   VectorNd minThrust_, maxThrust_;
+   int active_[N]; // FREE, AT_MIN, or AT_MAX (thrusters whose limits are equal are always at their limit)
+   double eps_;
+   int maxIterations_, iterations_;
+
+   // Subproblem variables
+   MatrixNd Hsub_;
+   VectorNd rhs_, target_, x_, grad_;
+   Eigen::LDLT<MatrixNd> ldlt_;
+
+   void resetActiveSet()
+   {
+      for (int i = 0; i < N; i++)
+         active_[i] = (maxThrust_(i) <= minThrust_(i)) ? AT_MIN : FREE;
+   }
+
+   /**
+    * @param fDes Desired thrust
+    * \brief Minimize the cost over the free thrusters, with the others fixed at their limits (target_)
+    */
+   void solveSubproblem(const VectorNd &fDes)
+   {
+      // Gradient of the cost is H*(f - fDes), so the free thrusters solve H_FF*f_F = H_F*fDes - H_FA*f_A.
+      // The fixed rows/columns are replaced with the identity, so the system stays NxN.
+      Hsub_ = H_;
+      rhs_.noalias() = H_ * fDes;
+      for (int i = 0; i < N; i++)
+      {
+         if (active_[i] == FREE)
+            continue;
+         double limit = (active_[i] == AT_MIN) ? minThrust_(i) : maxThrust_(i);
+         rhs_ -= H_.col(i) * limit;
+         Hsub_.row(i).setZero();
+         Hsub_.col(i).setZero();
+         Hsub_(i, i) = 1.0;
+      }
+      for (int i = 0; i < N; i++)
+      {
+         if (active_[i] != FREE)
+            rhs_(i) = (active_[i] == AT_MIN) ? minThrust_(i) : maxThrust_(i);
+      }
+
+      ldlt_.compute(Hsub_);
+      target_ = ldlt_.solve(rhs_);
+   }
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   /**
+    * @param maxIterations Maximum number of active-set iterations per solve
+    * @param eps Weight of the distance to the desired thrust, relative to the load error
+    */
+   SaturatedThrustAllocator(int maxIterations = 2 * N, double eps = 1e-3)
+   {
+      maxIterations_ = std::max(1, maxIterations);
+      eps_ = std::max(fabs(eps), 1e-9);
+      iterations_ = 0;
+      H_ = eps_ * MatrixNd::Identity();
+      minThrust_.setZero();
+      maxThrust_.setZero();
+      SaturatedThrustAllocator::resetActiveSet();
+   }
+
+   /**
+    * @param thrustCoeffs Thrust coefficients (e.g. with the columns of failed thrusters set to zero)
+    */
+   void setThrustCoeffs(const Eigen::Ref<const Matrix6xNd> &thrustCoeffs)
+   {
+      H_.noalias() = thrustCoeffs.transpose() * thrustCoeffs;
+      H_.diagonal().array() += eps_;
+   }
+
+   /**
+    * @param minThrust Minimum thrust of each thruster [N]
+    * @param maxThrust Maximum thrust of each thruster [N] (a thruster with equal limits is held at that thrust)
+    */
+   void setLimits(const Eigen::Ref<const VectorNd> &minThrust, const Eigen::Ref<const VectorNd> &maxThrust)
+   {
+      minThrust_ = minThrust.cwiseMin(maxThrust);
+      maxThrust_ = maxThrust.cwiseMax(minThrust);
+      SaturatedThrustAllocator::resetActiveSet();
+   }
+
+   /**
+    * @param maxIterations Maximum number of active-set iterations per solve
+    */
+   void setMaxIterations(int maxIterations)
+   {
+      maxIterations_ = std::max(1, maxIterations);
+   }
+
+   /**
+    * \brief Returns the number of active-set iterations used by the last call to solve()
+    */
+   int getIterations()
+   {
+      return iterations_;
+   }
+
+   /**
+    * @param fDes Desired thrust [N]
+    * @param f Thrust within the limits that best produces the load of the desired thrust
+    * \brief Solve the QP, warm-started from the previous active set. Returns true if it converged within the iteration
+    * limit (f is within the limits either way).
+    */
+   bool solve(const Eigen::Ref<const VectorNd> &fDes, VectorNd &f)
+   {
+      iterations_ = 0;
+
+      // Nothing to do if the desired thrust is achievable (only the fixed thrusters stay in the active set)
+      if ((fDes.array() >= minThrust_.array()).all() && (fDes.array() <= maxThrust_.array()).all())
+      {
+         SaturatedThrustAllocator::resetActiveSet();
+         f = fDes;
+         return true;
+      }
+
+      // Feasible starting point: clamped desired thrust, with the (warm-started) active set at its limits
+      x_ = fDes.cwiseMax(minThrust_).cwiseMin(maxThrust_);
+      for (int i = 0; i < N; i++)
+      {
+         if (active_[i] == AT_MIN)
+            x_(i) = minThrust_(i);
+         else if (active_[i] == AT_MAX)
+            x_(i) = maxThrust_(i);
+      }
+
+      bool converged = false;
+      for (iterations_ = 1; iterations_ <= maxIterations_; iterations_++)
+      {
+         SaturatedThrustAllocator::solveSubproblem(fDes);
+
+         // Step towards the subproblem solution, stopping at the first limit it crosses
+         double alpha = 1.0;
+         int blocking = -1;
+         for (int i = 0; i < N; i++)
+         {
+            if (active_[i] != FREE)
+               continue;
+            double step = target_(i) - x_(i);
+            if (step < 0 && target_(i) < minThrust_(i))
+            {
+               double a = (minThrust_(i) - x_(i)) / step;
+               if (a < alpha)
+               {
+                  alpha = a;
+                  blocking = i;
+               }
+            }
+            else if (step > 0 && target_(i) > maxThrust_(i))
+            {
+               double a = (maxThrust_(i) - x_(i)) / step;
+               if (a < alpha)
+               {
+                  alpha = a;
+                  blocking = i;
+               }
+            }
+         }
+         x_ += std::max(alpha, 0.0) * (target_ - x_);
+
+         if (blocking >= 0)
+         {
+            active_[blocking] = (target_(blocking) < minThrust_(blocking)) ? AT_MIN : AT_MAX;
+            x_(blocking) = (active_[blocking] == AT_MIN) ? minThrust_(blocking) : maxThrust_(blocking);
+            continue;
+         }
+
+         // Subproblem solution is feasible, so check the multipliers of the active limits.
+         // At the minimum, the gradient must be non-negative (non-positive at the maximum), otherwise release the limit
+         // that most reduces the cost.
+         grad_.noalias() = H_ * (x_ - fDes);
+         int release = -1;
+         double worst = -1e-9 * std::max(1.0, grad_.cwiseAbs().maxCoeff());
+         for (int i = 0; i < N; i++)
+         {
+            if (active_[i] == FREE || maxThrust_(i) <= minThrust_(i))
+               continue;
+            double multiplier = (active_[i] == AT_MIN) ? grad_(i) : -grad_(i);
+            if (multiplier < worst)
+            {
+               worst = multiplier;
+               release = i;
+            }
+         }
+
+         if (release < 0)
+         {
+            converged = true;
+            break;
+         }
+         active_[release] = FREE;
+      }
+
+      iterations_ = std::min(iterations_, maxIterations_);
+      f = x_.cwiseMax(minThrust_).cwiseMin(maxThrust_); // Only removes rounding errors
+      return converged;
+   }
+};
+} // namespace auv_control
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef THRUST_ALLOCATOR
+#define THRUST_ALLOCATOR
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include <stdexcept>
+
+namespace auv_control
+{
+typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+// Thrust Allocator
+// Maps a desired body-frame load (forces and moments) onto the N thrusters. The load is linear in the thruster forces
+// (load = thrustCoeffs * forces), so the minimum (weighted) norm solution is given by a weighted pseudo-inverse of the
+// thrust coefficients. The pseudo-inverse only depends on the thruster layout, so it is computed once.
+// Instantiated for the thruster counts supported by AUVModel (see thrust_allocator.cpp).
+template <int N>
+class ThrustAllocator
+{
+public:
+   typedef Eigen::Matrix<double, N, 1> VectorNd;
+   typedef Eigen::Matrix<double, 6, N> Matrix6xNd;
+   typedef Eigen::Matrix<double, N, 6> MatrixNx6d;
+
+private:
+   Matrix6xNd thrustCoeffs_;     // Thrust coefficients (effective contributions of each thruster for force and moment)
+   VectorNd weights_;            // Relative cost of using each thruster (zero: disabled)
+   MatrixNx6d allocationMatrix_; // Weighted pseudo-inverse of thrustCoeffs_
+
+   void setAllocationMatrix();
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   ThrustAllocator(const Eigen::Ref<const Matrix6xNd> &thrustCoeffs);
+   ThrustAllocator(const Eigen::Ref<const Matrix6xNd> &thrustCoeffs, const Eigen::Ref<const VectorNd> &weights);
+
+   MatrixNx6d getAllocationMatrix();
+   VectorNd allocate(const Eigen::Ref<const Vector6d> &load);
+};
+} // namespace auv_control
+
+#endif
\ No newline at end of file
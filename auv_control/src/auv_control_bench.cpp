@@ -0,0 +1,1223 @@
+#include "auv_control/auv_model.hpp"
+#include "auv_core/realtime_executor.hpp"
+#include "auv_core/rot3d.hpp"
+
+#include <yaml-cpp/yaml.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Microbenchmarks for AUVModel (runs standalone, no ROS master or node needed)
+// Usage: auv_control_bench <path to auv_model.yaml> [iterations] [path to lqr.yaml] [--benchmark_out=<file>]
+// With --benchmark_out, the results are also written to the file as JSON, in Google Benchmark's format.
+// Each benchmark also checks the behavior it times (accuracy, heap allocations on the control thread, limits), and
+// reports every failed check with check(). Returns 1 if any check failed. Running without real-time privileges is not a
+// failure.
+
+// Heap allocation counter
+// The C allocation functions are replaced (glibc), so this counts allocations made by new, Eigen, and any library.
+// Only allocations made by the thread that enabled the counter are counted.
+namespace
+{
+long allocationCount = 0;
+thread_local bool countAllocations = false;
+
+inline void countAllocation()
+{
+   if (countAllocations)
+      allocationCount++;
+}
+} // namespace
+
+extern "C"
+{
+   void *__libc_malloc(size_t size);
+   void *__libc_calloc(size_t num, size_t size);
+   void *__libc_realloc(void *ptr, size_t size);
+   void *__libc_memalign(size_t alignment, size_t size);
+   void __libc_free(void *ptr);
+
+   void *malloc(size_t size)
+   {
+      countAllocation();
+      return __libc_malloc(size);
+   }
+
+   void *calloc(size_t num, size_t size)
+   {
+      countAllocation();
+      return __libc_calloc(num, size);
+   }
+
+   void *realloc(void *ptr, size_t size)
+   {
+      countAllocation();
+      return __libc_realloc(ptr, size);
+   }
+
+   void *memalign(size_t alignment, size_t size)
+   {
+      countAllocation();
+      return __libc_memalign(alignment, size);
+   }
+
+   void *aligned_alloc(size_t alignment, size_t size)
+   {
+      countAllocation();
+      return __libc_memalign(alignment, size);
+   }
+
+   int posix_memalign(void **ptr, size_t alignment, size_t size)
+   {
+      countAllocation();
+      *ptr = __libc_memalign(alignment, size);
+      return (*ptr != NULL) ? 0 : ENOMEM;
+   }
+
+   void free(void *ptr)
+   {
+      __libc_free(ptr);
+   }
+}
+
+namespace
+{
+typedef Eigen::Matrix<CppAD::AD<double>, Eigen::Dynamic, 1> ADVectorXd;
+typedef Eigen::Matrix<CppAD::AD<double>, 3, 1> ADVector3d;
+typedef auv_control::AUVModel<8> AUVModel8; // Same input size as the ct_optcon and Kleinman solvers benchmarked below
+
+struct ModelParams
+{
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+   double Fg, Fb, mass;
+   Eigen::Vector3d CoB;
+   Eigen::Matrix3d inertia;
+   auv_control::Matrix62d dragCoeffs;
+   auv_control::Matrix58d thrusterData;
+   auv_control::Vector8d minThrust, maxThrust;
+   int numThrusters;
+};
+
+/**
+ * @param file Path to the AUV model YAML file
+ * \brief Load the model parameters the same way as GuidanceController::initAUVModel
+ */
+ModelParams loadModelParams(const std::string &file)
+{
+   YAML::Node config = YAML::LoadFile(file);
+   ModelParams params;
+
+   params.Fg = fabs(config["Fg"].as<double>());
+   params.Fb = fabs(config["Fb"].as<double>());
+   params.mass = params.Fg / auv_core::constants::GRAVITY;
+
+   Eigen::Vector3d CoM = Eigen::Vector3d::Zero();
+   for (int i = 0; i < 3; i++)
+   {
+      params.CoB(i) = config["center_of_buoyancy"][i].as<double>();
+      CoM(i) = config["center_of_mass"][i].as<double>();
+   }
+
+   params.inertia.setZero();
+   params.inertia(0, 0) = fabs(config["inertia"]["Ixx"].as<double>());
+   params.inertia(1, 1) = fabs(config["inertia"]["Iyy"].as<double>());
+   params.inertia(2, 2) = fabs(config["inertia"]["Izz"].as<double>());
+   params.inertia(0, 1) = params.inertia(1, 0) = config["inertia"]["Ixy"].as<double>();
+   params.inertia(0, 2) = params.inertia(2, 0) = config["inertia"]["Ixz"].as<double>();
+   params.inertia(1, 2) = params.inertia(2, 1) = config["inertia"]["Iyz"].as<double>();
+
+   params.dragCoeffs.setZero();
+   for (int i = 0; i < 3; i++)
+   {
+      params.dragCoeffs(i, 0) = fabs(config["translational_drag"]["linear"][i].as<double>());
+      params.dragCoeffs(i + 3, 0) = fabs(config["translational_drag"]["quadratic"][i].as<double>());
+      params.dragCoeffs(i, 1) = fabs(config["rotational_drag"]["linear"][i].as<double>());
+      params.dragCoeffs(i + 3, 1) = fabs(config["rotational_drag"]["quadratic"][i].as<double>());
+   }
+
+   params.thrusterData.setZero();
+   params.minThrust.setZero();
+   params.maxThrust.setZero();
+   params.numThrusters = 0;
+   for (int i = 0; i < (int)config["thrusters"].size() && params.numThrusters < 8; i++)
+   {
+      if (!config["thrusters"][i]["enable"].as<bool>())
+         continue;
+      for (int j = 0; j < 5; j++)
+      {
+         params.thrusterData(j, params.numThrusters) = config["thrusters"][i]["pose"][j].as<double>();
+         if (j < 3)
+            params.thrusterData(j, params.numThrusters) -= CoM(j);
+      }
+      params.minThrust(params.numThrusters) = -40.0; // [N], if the thrust limits are not given
+      params.maxThrust(params.numThrusters) = 50.0;
+      if (config["thrusters"][i]["thrust_limits"])
+      {
+         params.minThrust(params.numThrusters) = config["thrusters"][i]["thrust_limits"][0].as<double>();
+         params.maxThrust(params.numThrusters) = config["thrusters"][i]["thrust_limits"][1].as<double>();
+      }
+      params.numThrusters++;
+   }
+   return params;
+}
+
+/**
+ * \brief Generate a random, but realistic, reference state
+ */
+auv_control::Vector13d randomReference()
+{
+   auv_control::Vector13d ref = auv_control::Vector13d::Zero();
+   Eigen::Vector3d rpy = Eigen::Vector3d::Random().cwiseProduct(Eigen::Vector3d(0.3, 0.3, M_PI));
+   Eigen::Quaterniond quat = auv_core::rot3d::rpy2Quat(rpy(0), rpy(1), rpy(2));
+
+   ref.segment<3>(auv_core::constants::STATE_XI) = 5.0 * Eigen::Vector3d::Random();
+   ref.segment<3>(auv_core::constants::STATE_U) = 0.5 * Eigen::Vector3d::Random();
+   ref(auv_core::constants::STATE_Q0) = quat.w();
+   ref(auv_core::constants::STATE_Q1) = quat.x();
+   ref(auv_core::constants::STATE_Q2) = quat.y();
+   ref(auv_core::constants::STATE_Q3) = quat.z();
+   ref.segment<3>(auv_core::constants::STATE_P) = 0.5 * Eigen::Vector3d::Random();
+   return ref;
+}
+
+/**
+ * \brief Linearize the system matrix by recording a new tape every call (the previous AUVModel implementation).
+ */
+auv_control::Matrix12d retapedSystemMatrix(const ModelParams &params, const auv_control::Vector13d &ref)
+{
+   size_t n = 12;
+   ADVectorXd X(n), Xdot(n);
+   CppAD::Independent(X);
+
+   Eigen::Quaternion<CppAD::AD<double> > ADquat(ref(auv_core::constants::STATE_Q0), X[auv_core::constants::ESTATE_Q1], X[auv_core::constants::ESTATE_Q2], X[auv_core::constants::ESTATE_Q3]);
+   Xdot.segment<3>(auv_core::constants::ESTATE_XI) = ADquat * X.segment<3>(auv_core::constants::ESTATE_U);
+
+   Eigen::Vector3d weight = Eigen::Vector3d::Zero();
+   weight(2) = params.Fg - params.Fb;
+   ADVector3d transDrag;
+   for (int i = 0; i < 3; i++)
+   {
+      CppAD::AD<double> vel = X[auv_core::constants::ESTATE_U + i];
+      transDrag(i) = params.dragCoeffs(i, 0) * vel + auv_core::math_lib::sign(ref(auv_core::constants::STATE_U + i)) * params.dragCoeffs(i + 3, 0) * vel * vel;
+   }
+   Xdot.segment<3>(auv_core::constants::ESTATE_U) = ((ADquat.conjugate() * weight) - transDrag - (X.segment<3>(auv_core::constants::ESTATE_P).cross(X.segment<3>(auv_core::constants::ESTATE_U)))) / params.mass;
+
+   Eigen::Matrix<CppAD::AD<double>, 3, 3> qoIdentity;
+   qoIdentity = Eigen::Matrix3d::Identity() * ref(auv_core::constants::STATE_Q0);
+   Xdot.segment<3>(auv_core::constants::ESTATE_Q1) = 0.5 * (qoIdentity * X.segment<3>(auv_core::constants::ESTATE_P) + X.segment<3>(auv_core::constants::ESTATE_Q1).cross(X.segment<3>(auv_core::constants::ESTATE_P)));
+
+   Eigen::Vector3d forceBuoyancy = Eigen::Vector3d::Zero();
+   forceBuoyancy(2) = -params.Fb;
+   ADVector3d rotDrag;
+   for (int i = 0; i < 3; i++)
+   {
+      CppAD::AD<double> angVel = X[auv_core::constants::ESTATE_P + i];
+      rotDrag(i) = params.dragCoeffs(i, 1) * angVel + auv_core::math_lib::sign(ref(auv_core::constants::STATE_P + i)) * params.dragCoeffs(i + 3, 1) * angVel * angVel;
+   }
+   Xdot.segment<3>(auv_core::constants::ESTATE_P) = params.inertia.inverse() * (params.CoB.cross(ADquat.conjugate() * forceBuoyancy) - rotDrag - X.segment<3>(auv_core::constants::ESTATE_P).cross(params.inertia * X.segment<3>(auv_core::constants::ESTATE_P)));
+
+   std::vector<double> x;
+   for (int i = 0; i < 6; i++)
+      x.push_back(ref(i));
+   for (int i = 7; i < 13; i++)
+      x.push_back(ref(i));
+   CppAD::ADFun<double> f(X, Xdot);
+   std::vector<double> jac = f.Jacobian(x);
+
+   auv_control::Matrix12d A;
+   for (int i = 0; i < 12; i++)
+      for (int j = 0; j < 12; j++)
+         A(i, j) = jac[i * 12 + j];
+   return A;
+}
+
+/**
+ * @param ref Previous reference state
+ * \brief Small step along a reference trajectory (roughly what the controller sees between two ticks at 50 Hz)
+ */
+auv_control::Vector13d nextReference(const auv_control::Vector13d &ref)
+{
+   auv_control::Vector13d next = ref;
+   next.segment<3>(auv_core::constants::STATE_U) += 0.01 * Eigen::Vector3d::Random();
+   next.segment<3>(auv_core::constants::STATE_P) += 0.01 * Eigen::Vector3d::Random();
+   next.segment<4>(auv_core::constants::STATE_Q0) += 0.005 * Eigen::Vector4d::Random();
+   next.segment<4>(auv_core::constants::STATE_Q0).normalize();
+   return next;
+}
+
+double elapsedMicros(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * \brief Returns the CPU time used by this thread [us]
+ */
+double threadCPUMicros()
+{
+   struct timespec time;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+   return time.tv_sec * 1e6 + time.tv_nsec * 1e-3;
+}
+
+// Benchmark Timer
+// Wall clock and CPU time (this thread) since construction or the last restart [us]
+struct BenchmarkTimer
+{
+   std::chrono::steady_clock::time_point start;
+   double cpuStart;
+
+   BenchmarkTimer()
+   {
+      restart();
+   }
+
+   void restart()
+   {
+      start = std::chrono::steady_clock::now();
+      cpuStart = threadCPUMicros();
+   }
+
+   double realMicros()
+   {
+      return elapsedMicros(start);
+   }
+
+   double cpuMicros()
+   {
+      return threadCPUMicros() - cpuStart;
+   }
+};
+
+// Benchmark Results
+// Every result printed is also collected here, to be written as JSON in Google Benchmark's format (so its
+// tools/compare.py can diff two runs). Times are per iteration [us]. For latency histograms, the time is the median, and
+// the 99th percentile and maximum are counters.
+struct BenchmarkResult
+{
+   std::string name;
+   long iterations;
+   double realTime, cpuTime;
+   std::vector<std::pair<std::string, double> > counters;
+};
+
+std::vector<BenchmarkResult> benchmarkResults;
+
+/**
+ * @param name Benchmark name, e.g. "computeLQRThrust/kleinman"
+ * @param iterations Number of iterations timed
+ * @param realMicros Total wall clock time [us]
+ * @param cpuMicros Total CPU time [us]
+ * \brief Record a result (counters can be added to the returned result until the next one is recorded)
+ */
+BenchmarkResult &addResult(const std::string &name, long iterations, double realMicros, double cpuMicros)
+{
+   BenchmarkResult result;
+   result.name = name;
+   result.iterations = std::max(1L, iterations);
+   result.realTime = realMicros / result.iterations;
+   result.cpuTime = cpuMicros / result.iterations;
+   benchmarkResults.push_back(result);
+   return benchmarkResults.back();
+}
+
+BenchmarkResult &addResult(const std::string &name, long iterations, BenchmarkTimer &timer)
+{
+   return addResult(name, iterations, timer.realMicros(), timer.cpuMicros());
+}
+
+BenchmarkResult &addResult(const std::string &name, const auv_core::LatencyHistogram &latency)
+{
+   long count = latency.getCount();
+   BenchmarkResult &result = addResult(name, count, count * latency.getPercentile(50), count * latency.getPercentile(50));
+   result.counters.push_back(std::make_pair("p99_us", latency.getPercentile(99)));
+   result.counters.push_back(std::make_pair("max_us", latency.getMax()));
+   return result;
+}
+
+std::string jsonString(const std::string &value)
+{
+   std::string escaped = "\"";
+   for (int i = 0; i < value.size(); i++)
+   {
+      if (value[i] == '"' || value[i] == '\\')
+         escaped += '\\';
+      escaped += value[i];
+   }
+   return escaped + "\"";
+}
+
+/**
+ * @param file Output file
+ * @param executable Path of this executable (argv[0])
+ * \brief Write the results as JSON. Returns false if the file cannot be written.
+ */
+bool writeBenchmarkJSON(const std::string &file, const std::string &executable)
+{
+   std::ofstream out(file.c_str());
+   if (!out)
+      return false;
+
+   char date[64], host[256] = "";
+   time_t now = time(NULL);
+   strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+   gethostname(host, sizeof(host) - 1);
+
+   out << std::setprecision(10);
+   out << "{\n  \"context\": {\n";
+   out << "    \"date\": " << jsonString(date) << ",\n";
+   out << "    \"host_name\": " << jsonString(host) << ",\n";
+   out << "    \"executable\": " << jsonString(executable) << ",\n";
+   out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+   out << "    \"library_build_type\": \"release\"\n";
+#else
+   out << "    \"library_build_type\": \"debug\"\n";
+#endif
+   out << "  },\n  \"benchmarks\": [";
+   for (int i = 0; i < benchmarkResults.size(); i++)
+   {
+      const BenchmarkResult &result = benchmarkResults[i];
+      out << (i > 0 ? "," : "") << "\n    {\n";
+      out << "      \"name\": " << jsonString(result.name) << ",\n";
+      out << "      \"run_name\": " << jsonString(result.name) << ",\n";
+      out << "      \"run_type\": \"iteration\",\n";
+      out << "      \"repetitions\": 1,\n      \"repetition_index\": 0,\n      \"threads\": 1,\n";
+      out << "      \"iterations\": " << result.iterations << ",\n";
+      out << "      \"real_time\": " << (std::isfinite(result.realTime) ? result.realTime : 0.0) << ",\n";
+      out << "      \"cpu_time\": " << (std::isfinite(result.cpuTime) ? result.cpuTime : 0.0) << ",\n";
+      for (int j = 0; j < result.counters.size(); j++)
+      {
+         double value = result.counters[j].second;
+         out << "      " << jsonString(result.counters[j].first) << ": " << (std::isfinite(value) ? value : 0.0) << ",\n";
+      }
+      out << "      \"time_unit\": \"us\"\n    }";
+   }
+   out << "\n  ]\n}\n";
+   return (bool)out;
+}
+
+// Check Reporter
+// Every benchmark checks the behavior it times with check(), which prints and records each failure. main() returns 1 if
+// any check failed.
+std::vector<std::string> failedChecks;
+
+/**
+ * @param name Description of what is checked, e.g. "computeLQRThrust/schur: no heap allocations"
+ * @param passed Result of the check
+ * \brief Record the result of a check, and print it if it failed. Returns passed.
+ */
+bool check(const std::string &name, bool passed)
+{
+   if (!passed)
+   {
+      std::cout << "   FAILED: " << name << std::endl;
+      failedChecks.push_back(name);
+   }
+   return passed;
+}
+
+typedef std::vector<auv_control::Vector13d, Eigen::aligned_allocator<auv_control::Vector13d> > ReferenceList;
+typedef std::vector<auv_control::Matrix12d, Eigen::aligned_allocator<auv_control::Matrix12d> > SystemMatrixList;
+typedef std::vector<auv_control::Matrix8x12d, Eigen::aligned_allocator<auv_control::Matrix8x12d> > GainList;
+
+// Benchmark Context
+// Inputs shared by the benchmarks: the model parameters and cost matrices, a model for the stateless computations, and
+// the linearizations and Schur (ct_optcon) gains the other Riccati solvers are compared with.
+struct BenchmarkContext
+{
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+   ModelParams params;
+   int iterations;
+   auv_control::Matrix12d Q;
+   auv_control::Matrix18d augQ;
+   auv_control::Matrix8d R;
+   AUVModel8 *model;
+
+   ReferenceList refs;  // Random references
+   SystemMatrixList A;  // Linearized along a slowly varying reference
+   auv_control::Matrix12x8d B;
+   GainList K;          // Schur gains for A and B
+   double schurTime;    // Mean time of the Schur solves [us]
+};
+
+/**
+ * \brief Returns a new model with the benchmark's parameters (delete it after use)
+ */
+AUVModel8 *newModel(const BenchmarkContext &context)
+{
+   const ModelParams &params = context.params;
+   return new AUVModel8(params.Fg, params.Fb, params.CoB, params.inertia, params.dragCoeffs, params.thrusterData,
+                        params.numThrusters);
+}
+
+/**
+ * @param file Path to lqr.yaml (empty: identity cost matrices)
+ */
+void loadCostMatrices(BenchmarkContext &context, const std::string &file)
+{
+   context.Q.setIdentity();
+   context.augQ.setIdentity();
+   context.R.setIdentity();
+   if (file.empty())
+      return;
+
+   YAML::Node lqrConfig = YAML::LoadFile(file);
+   for (int i = 0; i < 12; i++)
+      context.Q(i, i) = fabs(lqrConfig["Q_diag"][i].as<double>());
+   for (int i = 0; i < 6; i++)
+      context.augQ(12 + i, 12 + i) = fabs(lqrConfig["Q_diag_integral"][i].as<double>());
+   for (int i = 0; i < 8; i++)
+      context.R(i, i) = fabs(lqrConfig["R_diag"][i].as<double>());
+   context.augQ.block<12, 12>(0, 0) = context.Q;
+}
+
+/**
+ * \brief Construction (records the CppAD tape, solves for the thrust allocation of every thruster health configuration)
+ */
+void benchConstruction(BenchmarkContext &context)
+{
+   int constructions = std::max(1, context.iterations / 100);
+   BenchmarkTimer timer;
+   double constructReal = 0, constructCPU = 0;
+   for (int i = 0; i < constructions; i++)
+   {
+      timer.restart();
+      AUVModel8 *constructed = newModel(context);
+      constructReal += timer.realMicros();
+      constructCPU += timer.cpuMicros();
+      delete constructed;
+   }
+   addResult("AUVModel/construct", constructions, constructReal, constructCPU);
+   std::cout << "AUVModel construction (" << constructions << " iterations): " << constructReal / constructions << " [us]"
+             << std::endl;
+}
+
+/**
+ * \brief Verify the cached tape and the analytic Jacobian agree with CppAD (re-recorded tape), then time them
+ */
+void benchJacobian(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   AUVModel8 *model = context.model;
+   double maxDiff = 0;
+   for (int i = 0; i < iterations; i++)
+   {
+      auv_control::Matrix12d retaped = retapedSystemMatrix(context.params, context.refs[i]);
+      model->setJacobianMethod(AUVModel8::JACOBIAN_AUTODIFF);
+      model->setLinearizedSystemMatrix(context.refs[i]);
+      maxDiff = std::max(maxDiff, (model->getLinearizedSystemMatrix() - retaped).cwiseAbs().maxCoeff());
+      model->setJacobianMethod(AUVModel8::JACOBIAN_ANALYTIC);
+      model->setLinearizedSystemMatrix(context.refs[i]);
+      maxDiff = std::max(maxDiff, (model->getLinearizedSystemMatrix() - retaped).cwiseAbs().maxCoeff());
+   }
+
+   BenchmarkTimer timer;
+   for (int i = 0; i < iterations; i++)
+      retapedSystemMatrix(context.params, context.refs[i]);
+   double retapedTime = addResult("setLinearizedSystemMatrix/retaped", iterations, timer).realTime;
+
+   model->setJacobianMethod(AUVModel8::JACOBIAN_AUTODIFF);
+   timer.restart();
+   for (int i = 0; i < iterations; i++)
+      model->setLinearizedSystemMatrix(context.refs[i]);
+   double cachedTime = addResult("setLinearizedSystemMatrix/cached_tape", iterations, timer).realTime;
+
+   model->setJacobianMethod(AUVModel8::JACOBIAN_ANALYTIC);
+   timer.restart();
+   for (int i = 0; i < iterations; i++)
+      model->setLinearizedSystemMatrix(context.refs[i]);
+   double analyticTime = addResult("setLinearizedSystemMatrix/analytic", iterations, timer).realTime;
+
+   std::cout << "setLinearizedSystemMatrix (" << iterations << " iterations)" << std::endl;
+   std::cout << "   Re-recorded tape:  " << retapedTime << " [us]" << std::endl;
+   std::cout << "   Cached tape:       " << cachedTime << " [us] (" << retapedTime / cachedTime << "x)" << std::endl;
+   std::cout << "   Analytic:          " << analyticTime << " [us] (" << retapedTime / analyticTime << "x)" << std::endl;
+   std::cout << "   Max Jacobian diff: " << maxDiff << std::endl;
+   check("setLinearizedSystemMatrix: cached tape and analytic Jacobian match CppAD", maxDiff < 1e-9);
+}
+
+/**
+ * \brief Nominal thrust solvers and the thrust load, at random realistic references and accelerations
+ */
+void benchNominalThrust(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   AUVModel8 *model = context.model;
+   std::vector<auv_control::Vector6d, Eigen::aligned_allocator<auv_control::Vector6d> > accels;
+   std::vector<auv_control::Vector8d, Eigen::aligned_allocator<auv_control::Vector8d> > thrusts;
+   for (int i = 0; i < iterations; i++)
+   {
+      accels.push_back(0.2 * auv_control::Vector6d::Random());
+      thrusts.push_back(20.0 * auv_control::Vector8d::Random());
+   }
+
+   model->setNominalThrustSolver(AUVModel8::NOMINAL_THRUST_CERES);
+   BenchmarkTimer timer;
+   for (int i = 0; i < iterations; i++)
+      model->computeNominalThrust(context.refs[i], accels[i]);
+   double ceresTime = addResult("computeNominalThrust/ceres", iterations, timer).realTime;
+
+   model->setNominalThrustSolver(AUVModel8::NOMINAL_THRUST_PINV);
+   timer.restart();
+   for (int i = 0; i < iterations; i++)
+      model->computeNominalThrust(context.refs[i], accels[i]);
+   double pinvTime = addResult("computeNominalThrust/pinv", iterations, timer).realTime;
+
+   auv_control::Vector6d totalLoad = auv_control::Vector6d::Zero(); // Used, so the loop is not optimized away
+   timer.restart();
+   for (int i = 0; i < iterations; i++)
+      totalLoad += model->getTotalThrustLoad(thrusts[i]);
+   double loadTime = addResult("getTotalThrustLoad", iterations, timer).realTime;
+
+   std::cout << "Nominal thrust (" << iterations << " iterations)" << std::endl;
+   std::cout << "   Ceres:              " << ceresTime << " [us]" << std::endl;
+   std::cout << "   Pseudo-inverse:     " << pinvTime << " [us]" << std::endl;
+   std::cout << "   getTotalThrustLoad: " << loadTime << " [us] (sum " << totalLoad.norm() << ")" << std::endl;
+}
+
+/**
+ * \brief Continuous-time LQR solvers along a slowly varying reference: ct_optcon (Schur) and warm-started Kleinman.
+ * Keeps the linearizations and the Schur gains for the other benchmarks.
+ */
+void benchRiccatiSolvers(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   auv_control::Vector13d ref = randomReference();
+   context.A.clear();
+   for (int i = 0; i < iterations; i++)
+   {
+      ref = nextReference(ref);
+      context.model->setLinearizedSystemMatrix(ref);
+      context.A.push_back(context.model->getLinearizedSystemMatrix());
+   }
+   context.B = context.model->getLinearizedInputMatrix();
+
+   ct::optcon::LQR<12, 8> lqrSolver;
+   context.K.assign(iterations, auv_control::Matrix8x12d::Zero());
+   BenchmarkTimer timer;
+   for (int i = 0; i < iterations; i++)
+      lqrSolver.compute(context.Q, context.R, context.A[i], context.B, context.K[i]);
+   context.schurTime = addResult("LQRSolver/schur", iterations, timer).realTime;
+
+   auv_control::KleinmanRiccatiSolver<12, 8> kleinmanSolver;
+   kleinmanSolver.setInitialGain(context.K[0]);
+   auv_control::Matrix8x12d Kkleinman;
+   int fallbacks = 0, totalIterations = 0;
+   double maxGainDiff = 0;
+   timer.restart();
+   for (int i = 0; i < iterations; i++)
+   {
+      if (kleinmanSolver.compute(context.Q, context.R, context.A[i], context.B, Kkleinman))
+      {
+         totalIterations += kleinmanSolver.getIterations();
+         maxGainDiff = std::max(maxGainDiff, (Kkleinman - context.K[i]).cwiseAbs().maxCoeff() / context.K[i].cwiseAbs().maxCoeff());
+      }
+      else
+      {
+         fallbacks++;
+         kleinmanSolver.setInitialGain(context.K[i]);
+      }
+   }
+   double kleinmanTime = addResult("LQRSolver/kleinman", iterations, timer).realTime;
+
+   std::cout << "LQR solve (" << iterations << " iterations)" << std::endl;
+   std::cout << "   ct_optcon (Schur):       " << context.schurTime << " [us]" << std::endl;
+   std::cout << "   Kleinman (warm-started): " << kleinmanTime << " [us]" << std::endl;
+   std::cout << "   Speedup:                 " << context.schurTime / kleinmanTime << "x" << std::endl;
+   std::cout << "   Mean Newton iterations:  " << (double)totalIterations / std::max(1, iterations - fallbacks) << std::endl;
+   std::cout << "   Fallbacks:               " << fallbacks << std::endl;
+   std::cout << "   Max relative gain diff:  " << maxGainDiff << std::endl;
+   check("LQRSolver/kleinman: gains match Schur", maxGainDiff < 1e-6);
+}
+
+/**
+ * \brief Discrete-time LQR at the control period (50 Hz): DARE residual, and how far the gains are from the continuous ones
+ */
+void benchDiscreteLQR(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   auv_control::DAREDoublingSolver<12, 8> dareSolver(0.02);
+   auv_control::Matrix8x12d Kdiscrete;
+   int dareFailures = 0, maxDoublings = 0;
+   double maxDAREResidual = 0, maxDiscreteGainDiff = 0;
+   BenchmarkTimer timer;
+   for (int i = 0; i < iterations; i++)
+   {
+      if (!dareSolver.compute(context.Q, context.R, context.A[i], context.B, Kdiscrete))
+      {
+         dareFailures++;
+         continue;
+      }
+      maxDoublings = std::max(maxDoublings, dareSolver.getIterations());
+      maxDiscreteGainDiff = std::max(maxDiscreteGainDiff, (Kdiscrete - context.K[i]).cwiseAbs().maxCoeff() / context.K[i].cwiseAbs().maxCoeff());
+   }
+   double dareTime = addResult("LQRSolver/discrete", iterations, timer).realTime;
+   for (int i = 0; i < iterations; i += std::max(1, iterations / 20))
+   {
+      if (!dareSolver.compute(context.Q, context.R, context.A[i], context.B, Kdiscrete))
+         continue;
+      auv_control::Matrix12d Ad = dareSolver.getDiscreteSystemMatrix();
+      auv_control::Matrix12x8d Bd = dareSolver.getDiscreteInputMatrix();
+      auv_control::Matrix12d P = dareSolver.getRiccatiSolution();
+      auv_control::Matrix12d residual = Ad.transpose() * P * (Ad - Bd * Kdiscrete) + context.Q - P;
+      maxDAREResidual = std::max(maxDAREResidual, residual.cwiseAbs().maxCoeff() / P.cwiseAbs().maxCoeff());
+   }
+
+   std::cout << "Discrete-time LQR solve, 50 Hz (" << iterations << " iterations)" << std::endl;
+   std::cout << "   Doubling (DARE):         " << dareTime << " [us] (" << context.schurTime / dareTime << "x Schur)" << std::endl;
+   std::cout << "   Max doubling steps:      " << maxDoublings << std::endl;
+   std::cout << "   Failures:                " << dareFailures << std::endl;
+   std::cout << "   Max relative residual:   " << maxDAREResidual << std::endl;
+   std::cout << "   Max rel. diff from CARE: " << maxDiscreteGainDiff << std::endl;
+   check("LQRSolver/discrete: every DARE solve converges", dareFailures == 0);
+   check("LQRSolver/discrete: DARE residual", maxDAREResidual < 1e-8);
+}
+
+/**
+ * \brief Heap allocations in computeLQRThrust after the first call (which may allocate), for each LQR solver
+ */
+void benchLQRThrust(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   std::cout << "computeLQRThrust heap allocations after warm-up (" << iterations << " iterations)" << std::endl;
+   const char *modes[] = {"LQR, Schur", "LQR, Kleinman", "LQR, discrete",
+                          "LQR integral, Schur", "LQR integral, Kleinman", "LQR integral, discrete"};
+   const char *modeNames[] = {"schur", "kleinman", "discrete", "integral/schur", "integral/kleinman", "integral/discrete"};
+   const int solvers[] = {AUVModel8::LQR_SOLVER_SCHUR, AUVModel8::LQR_SOLVER_KLEINMAN, AUVModel8::LQR_SOLVER_DISCRETE};
+   BenchmarkTimer timer;
+   for (int mode = 0; mode < 6; mode++)
+   {
+      AUVModel8 *testModel = newModel(context);
+      if (mode < 3)
+         testModel->setLQRCostMatrices(context.Q, context.R);
+      else
+         testModel->setLQRIntegralCostMatrices(context.augQ, context.R);
+      testModel->setLQRSolver(solvers[mode % 3]);
+      testModel->setControlPeriod(0.02);
+
+      auv_control::Vector6d accel = auv_control::Vector6d::Zero();
+      auv_control::Vector13d ref = randomReference();
+      testModel->computeLQRThrust(ref, ref, accel);
+
+      allocationCount = 0;
+      double modeReal = 0, modeCPU = 0;
+      for (int i = 0; i < iterations; i++)
+      {
+         auv_control::Vector13d state = nextReference(ref);
+         ref = nextReference(ref);
+         accel.setRandom();
+         countAllocations = true;
+         timer.restart();
+         testModel->computeLQRThrust(state, ref, accel);
+         modeReal += timer.realMicros();
+         modeCPU += timer.cpuMicros();
+         countAllocations = false;
+      }
+      addResult(std::string("computeLQRThrust/") + modeNames[mode], iterations, modeReal, modeCPU)
+          .counters.push_back(std::make_pair("allocations", (double)allocationCount));
+
+      std::cout << "   " << modes[mode] << ": " << allocationCount << " (" << modeReal / iterations << " [us])" << std::endl;
+      check(std::string("computeLQRThrust/") + modeNames[mode] + ": no heap allocations", allocationCount == 0);
+      for (int i = 0; i < AUVModel8::NUM_STAGES; i++)
+      {
+         const auv_core::LatencyHistogram &latency = testModel->getStageLatency(i);
+         std::cout << "      " << AUVModel8::STAGE_NAMES[i] << ": p50 " << latency.getPercentile(50)
+                   << ", p99 " << latency.getPercentile(99) << ", max " << latency.getMax() << " [us]" << std::endl;
+      }
+      delete testModel;
+   }
+}
+
+/**
+ * \brief Thruster health: time to precompute every configuration, and to switch between them
+ */
+void benchThrusterHealth(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   AUVModel8 *healthModel = newModel(context);
+   unsigned int numConfigs = 1u << healthModel->getNumThrusters();
+   while (!healthModel->isThrusterHealthReady(0))
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+   double configTime = elapsedMicros(start);
+
+   healthModel->setLQRCostMatrices(context.Q, context.R);
+   auv_control::Vector6d accel = auv_control::Vector6d::Zero();
+   auv_control::Vector13d ref = randomReference();
+   double switchTime = 0, maxFailedThrust = 0;
+   for (int i = 0; i < iterations; i++)
+   {
+      unsigned int healthMask = (unsigned int)rand() % numConfigs;
+      start = std::chrono::steady_clock::now();
+      healthModel->setThrusterHealth(healthMask);
+      switchTime += elapsedMicros(start);
+
+      ref = nextReference(ref);
+      accel.setRandom();
+      AUVModel8::ThrustVector thrust = healthModel->computeLQRThrust(nextReference(ref), ref, accel);
+      for (int j = 0; j < healthModel->getNumThrusters(); j++)
+      {
+         if (!(healthMask & (1u << j)))
+            maxFailedThrust = std::max(maxFailedThrust, fabs(thrust(j)));
+      }
+   }
+   delete healthModel;
+
+   std::cout << "Thruster health (" << numConfigs << " configurations)" << std::endl;
+   std::cout << "   Precompute all:        " << configTime << " [us]" << std::endl;
+   std::cout << "   setThrusterHealth:     " << switchTime / iterations << " [us]" << std::endl;
+   std::cout << "   Max failed thrust:     " << maxFailedThrust << std::endl;
+   check("setThrusterHealth: no thrust from failed thrusters", maxFailedThrust == 0);
+}
+
+/**
+ * \brief Thrust saturation: active-set allocation vs. clipping each thruster, along a slowly varying desired thrust that
+ * is mostly beyond the limits
+ */
+void benchThrustSaturation(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   const ModelParams &params = context.params;
+   AUVModel8::Matrix6xNd thrustCoeffs;
+   for (int j = 0; j < 8; j++)
+      thrustCoeffs.col(j) = context.model->getTotalThrustLoad(auv_control::Vector8d::Unit(j));
+   auv_control::SaturatedThrustAllocator<8> saturatedAllocator;
+   saturatedAllocator.setThrustCoeffs(thrustCoeffs);
+   saturatedAllocator.setLimits(params.minThrust, params.maxThrust);
+
+   auv_control::Vector8d desiredThrust = 60.0 * auv_control::Vector8d::Random(), saturatedThrust;
+   double saturatedTime = 0, saturatedCPU = 0, saturatedError = 0, clippedError = 0, maxViolation = 0;
+   int maxSaturatedIterations = 0, notConverged = 0;
+   BenchmarkTimer timer;
+   allocationCount = 0;
+   for (int i = 0; i < iterations; i++)
+   {
+      desiredThrust += 2.0 * auv_control::Vector8d::Random();
+      countAllocations = true;
+      timer.restart();
+      if (!saturatedAllocator.solve(desiredThrust, saturatedThrust))
+         notConverged++;
+      saturatedTime += timer.realMicros();
+      saturatedCPU += timer.cpuMicros();
+      countAllocations = false;
+
+      auv_control::Vector8d clippedThrust = desiredThrust.cwiseMax(params.minThrust).cwiseMin(params.maxThrust);
+      saturatedError += (thrustCoeffs * (saturatedThrust - desiredThrust)).norm();
+      clippedError += (thrustCoeffs * (clippedThrust - desiredThrust)).norm();
+      maxViolation = std::max(maxViolation, (params.minThrust - saturatedThrust).maxCoeff());
+      maxViolation = std::max(maxViolation, (saturatedThrust - params.maxThrust).maxCoeff());
+      maxSaturatedIterations = std::max(maxSaturatedIterations, saturatedAllocator.getIterations());
+   }
+
+   std::cout << "Thrust saturation (" << iterations << " iterations)" << std::endl;
+   std::cout << "   Active-set solve:      " << saturatedTime / iterations << " [us]" << std::endl;
+   std::cout << "   Max iterations:        " << maxSaturatedIterations << " (" << notConverged << " not converged)" << std::endl;
+   std::cout << "   Mean load error:       " << saturatedError / iterations << " (clipped: " << clippedError / iterations << ")" << std::endl;
+   std::cout << "   Heap allocations:      " << allocationCount << std::endl;
+   addResult("SaturatedThrustAllocator/solve", iterations, saturatedTime, saturatedCPU);
+   check("SaturatedThrustAllocator: thrust within the limits", maxViolation <= 0);
+   check("SaturatedThrustAllocator: no heap allocations", allocationCount == 0);
+}
+
+/**
+ * \brief MPC: solve time against horizon length, along a slowly varying reference (50 Hz), with the thrust limits
+ */
+void benchMPC(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   std::cout << "computeMPCThrust (" << iterations << " iterations)" << std::endl;
+   const int horizons[] = {10, 20, 30, 40};
+   for (int h = 0; h < 4; h++)
+   {
+      AUVModel8 *mpcModel = newModel(context);
+      mpcModel->setLQRCostMatrices(context.Q, context.R);
+      mpcModel->setThrustLimits(context.params.minThrust, context.params.maxThrust, 16);
+      mpcModel->setMPCHorizon(horizons[h], 0.02, 50);
+
+      Eigen::MatrixXd refs(13, horizons[h]), accels = Eigen::MatrixXd::Zero(6, horizons[h]);
+      refs.col(0) = randomReference();
+      for (int k = 1; k < horizons[h]; k++)
+         refs.col(k) = nextReference(refs.col(k - 1));
+      auv_control::Vector13d state = nextReference(refs.col(0));
+      mpcModel->computeMPCThrust(state, refs, accels);
+      mpcModel->resetStageLatency();
+
+      int maxMPCIterations = 0;
+      allocationCount = 0;
+      for (int i = 0; i < iterations; i++)
+      {
+         // Shift the horizon by one step
+         for (int k = 0; k + 1 < horizons[h]; k++)
+            refs.col(k) = refs.col(k + 1);
+         refs.col(horizons[h] - 1) = nextReference(refs.col(horizons[h] - 2));
+         state = nextReference(refs.col(0));
+
+         countAllocations = true;
+         mpcModel->computeMPCThrust(state, refs, accels);
+         countAllocations = false;
+         maxMPCIterations = std::max(maxMPCIterations, mpcModel->getMPCIterations());
+      }
+
+      std::string name = "computeMPCThrust/horizon_" + std::to_string(horizons[h]);
+      const auv_core::LatencyHistogram &total = mpcModel->getStageLatency(AUVModel8::STAGE_TOTAL);
+      const auv_core::LatencyHistogram &qp = mpcModel->getStageLatency(AUVModel8::STAGE_RICCATI);
+      addResult(name, total);
+      std::cout << "   Horizon " << horizons[h] << ": total p50 " << total.getPercentile(50) << ", p99 " << total.getPercentile(99)
+                << ", max " << total.getMax() << " [us], QP p50 " << qp.getPercentile(50) << " [us], max iterations "
+                << maxMPCIterations << ", heap allocations " << allocationCount << std::endl;
+      check(name + ": no heap allocations", allocationCount == 0);
+      delete mpcModel;
+   }
+}
+
+/**
+ * \brief Cascaded control: inner (attitude) loop at 250 Hz, outer (translational) loop at 50 Hz, interleaved on one thread
+ */
+void benchCascaded(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   AUVModel8 *cascadeModel = newModel(context);
+   cascadeModel->setLQRCostMatrices(context.Q, context.R);
+   bool cascadeInit = cascadeModel->setCascadedControl(1.0 / 250.0, 1.0 / 50.0);
+   auv_core::LatencyHistogram innerLatency, outerLatency;
+   auv_control::Vector6d accel = auv_control::Vector6d::Zero();
+   auv_control::Vector13d ref = randomReference();
+   cascadeModel->computeCascadedOuterLoop(ref, ref, accel);
+   cascadeModel->computeCascadedInnerLoop(ref);
+
+   // Without errors, the thrust only produces the nominal load
+   auv_control::Vector8d cascadeThrust = cascadeModel->computeCascadedInnerLoop(ref);
+   auv_control::Vector8d nominalThrust = cascadeModel->computeNominalThrust(ref, accel);
+   double maxLoadError = (cascadeModel->getTotalThrustLoad(cascadeThrust) -
+                          cascadeModel->getTotalThrustLoad(nominalThrust)).cwiseAbs().maxCoeff();
+
+   allocationCount = 0;
+   for (int i = 0; i < 5 * iterations; i++)
+   {
+      auv_control::Vector13d state = nextReference(ref);
+      countAllocations = true;
+      if (i % 5 == 0)
+      {
+         ref = nextReference(ref);
+         accel.setRandom();
+         auv_core::ScopedTimer timer(outerLatency);
+         cascadeModel->computeCascadedOuterLoop(state, ref, accel);
+      }
+      {
+         auv_core::ScopedTimer timer(innerLatency);
+         cascadeModel->computeCascadedInnerLoop(state);
+      }
+      countAllocations = false;
+   }
+   delete cascadeModel;
+   addResult("cascaded/outer_loop", outerLatency);
+   addResult("cascaded/inner_loop", innerLatency);
+
+   std::cout << "Cascaded control (" << 5 * iterations << " inner loop iterations)" << std::endl;
+   std::cout << "   Gains designed:        " << (cascadeInit ? "yes" : "no") << std::endl;
+   std::cout << "   Outer loop (50 Hz):    p50 " << outerLatency.getPercentile(50) << ", p99 " << outerLatency.getPercentile(99)
+             << ", max " << outerLatency.getMax() << " [us]" << std::endl;
+   std::cout << "   Inner loop (250 Hz):   p50 " << innerLatency.getPercentile(50) << ", p99 " << innerLatency.getPercentile(99)
+             << ", max " << innerLatency.getMax() << " [us]" << std::endl;
+   std::cout << "   Max load error at ref: " << maxLoadError << std::endl;
+   std::cout << "   Heap allocations:      " << allocationCount << std::endl;
+   check("cascaded: gains designed", cascadeInit);
+   check("cascaded: nominal load at the reference", maxLoadError < 1e-6);
+   check("cascaded: no heap allocations", allocationCount == 0);
+}
+
+/**
+ * \brief Feed-forward schedule: a 30 s trajectory at 50 Hz, compiled once (Ceres nominal thrust and gains at every
+ * sample), then interpolated every tick. Compared with solving for both every tick.
+ */
+void benchFeedForward(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   const int ffSamples = 1500;
+   const double ffPeriod = 0.02;
+   AUVModel8 *ffModel = newModel(context);
+   ffModel->setLQRCostMatrices(context.Q, context.R);
+   ffModel->setLQRSolver(AUVModel8::LQR_SOLVER_KLEINMAN);
+   ffModel->setNominalThrustSolver(AUVModel8::NOMINAL_THRUST_CERES);
+   Eigen::MatrixXd ffRefs(13, ffSamples), ffAccels = 0.2 * Eigen::MatrixXd::Random(6, ffSamples);
+   ffRefs.col(0) = randomReference();
+   for (int k = 1; k < ffSamples; k++)
+      ffRefs.col(k) = nextReference(ffRefs.col(k - 1));
+
+   BenchmarkTimer timer;
+   bool ffCompiled = ffModel->compileFeedForward(ffRefs, ffAccels, ffPeriod, true);
+   double ffCompileTime = addResult("compileFeedForward/1500_samples", 1, timer).realTime;
+
+   // Without errors, the thrust at each sample is the nominal thrust
+   double maxFeedForwardError = 0;
+   for (int k = 0; k < ffSamples; k += 10)
+   {
+      auv_control::Vector8d ffThrust = ffModel->computeLQRThrust(ffRefs.col(k), k * ffPeriod);
+      auv_control::Vector8d ffNominal = ffModel->computeNominalThrust(ffRefs.col(k), ffAccels.col(k));
+      maxFeedForwardError = std::max(maxFeedForwardError, (ffThrust - ffNominal).cwiseAbs().maxCoeff());
+   }
+
+   // Ticks fall between the samples
+   ffModel->resetStageLatency();
+   allocationCount = 0;
+   for (int i = 0; i < iterations; i++)
+   {
+      int k = i % (ffSamples - 1);
+      auv_control::Vector13d state = nextReference(ffRefs.col(k));
+      countAllocations = true;
+      ffModel->computeLQRThrust(state, (k + 0.5) * ffPeriod);
+      countAllocations = false;
+   }
+   long feedForwardAllocations = allocationCount;
+   const auv_core::LatencyHistogram &ffLatency = ffModel->getStageLatency(AUVModel8::STAGE_TOTAL); // Reused below
+   double ffP50 = ffLatency.getPercentile(50), ffP99 = ffLatency.getPercentile(99), ffMax = ffLatency.getMax();
+   addResult("computeLQRThrust/feed_forward", ffLatency);
+
+   ffModel->resetStageLatency();
+   for (int i = 0; i < iterations; i++)
+   {
+      int k = i % ffSamples;
+      ffModel->computeLQRThrust(nextReference(ffRefs.col(k)), ffRefs.col(k), ffAccels.col(k));
+   }
+
+   std::cout << "Feed-forward schedule (" << ffSamples << " samples, " << iterations << " iterations)" << std::endl;
+   std::cout << "   Compile (Ceres, gains): " << ffCompileTime / 1000.0 << " [ms]" << std::endl;
+   std::cout << "   Interpolated tick:      p50 " << ffP50 << ", p99 " << ffP99 << ", max " << ffMax << " [us]" << std::endl;
+   std::cout << "   Solved tick:            p50 " << ffLatency.getPercentile(50) << ", p99 " << ffLatency.getPercentile(99)
+             << ", max " << ffLatency.getMax() << " [us]" << std::endl;
+   std::cout << "   Max error at samples:   " << maxFeedForwardError << std::endl;
+   std::cout << "   Heap allocations:       " << feedForwardAllocations << std::endl;
+   delete ffModel;
+   check("compileFeedForward: schedule compiled", ffCompiled);
+   check("computeLQRThrust/feed_forward: nominal thrust at the samples", maxFeedForwardError < 1e-6);
+   check("computeLQRThrust/feed_forward: no heap allocations", feedForwardAllocations == 0);
+}
+
+/**
+ * \brief State prediction (latency compensation): 50 ms horizon. Under the nominal thrust for a constant velocity (accel
+ * and pqr zero), the state must not drift. The fixed steps are compared with 1 ms steps.
+ */
+void benchPrediction(BenchmarkContext &context)
+{
+   int iterations = context.iterations;
+   AUVModel8 *model = context.model;
+   const double predictionTime = 0.05;
+   double maxDrift = 0, maxPredictionError = 0, predictionTotal = 0, predictionCPU = 0;
+   BenchmarkTimer timer;
+   allocationCount = 0;
+   for (int i = 0; i < iterations; i++)
+   {
+      auv_control::Vector13d state = randomReference();
+      state.segment<3>(auv_core::constants::STATE_P).setZero();
+      AUVModel8::ThrustVector thrust = model->computeNominalThrust(state, auv_control::Vector6d::Zero());
+      Eigen::Quaterniond quat(state(auv_core::constants::STATE_Q0), state(auv_core::constants::STATE_Q1),
+                              state(auv_core::constants::STATE_Q2), state(auv_core::constants::STATE_Q3));
+      auv_control::Vector13d steady = state;
+      steady.segment<3>(auv_core::constants::STATE_XI) += predictionTime * (quat * state.segment<3>(auv_core::constants::STATE_U));
+      maxDrift = std::max(maxDrift, (model->predictState(state, thrust, predictionTime) - steady).cwiseAbs().maxCoeff());
+
+      state = randomReference();
+      thrust = 20.0 * auv_control::Vector8d::Random();
+      countAllocations = true;
+      timer.restart();
+      auv_control::Vector13d predicted = model->predictState(state, thrust, predictionTime);
+      predictionTotal += timer.realMicros();
+      predictionCPU += timer.cpuMicros();
+      countAllocations = false;
+
+      for (int k = 0; k < 50; k++)
+         state = model->predictState(state, thrust, predictionTime / 50);
+      maxPredictionError = std::max(maxPredictionError, (predicted - state).cwiseAbs().maxCoeff());
+   }
+   addResult("predictState/50ms", iterations, predictionTotal, predictionCPU);
+
+   std::cout << "predictState, RK4 over " << predictionTime * 1000 << " ms (" << iterations << " iterations)" << std::endl;
+   std::cout << "   Time:                   " << predictionTotal / iterations << " [us] ("
+             << (int)ceil(predictionTime / AUVModel8::PREDICTION_STEP) << " steps)" << std::endl;
+   std::cout << "   Max error (1 ms steps): " << maxPredictionError << std::endl;
+   std::cout << "   Max drift at nominal:   " << maxDrift << std::endl;
+   std::cout << "   Heap allocations:       " << allocationCount << std::endl;
+   check("predictState: matches 1 ms steps", maxPredictionError < 1e-6);
+   check("predictState: no drift under the nominal thrust", maxDrift < 1e-9);
+   check("predictState: no heap allocations", allocationCount == 0);
+}
+
+/**
+ * \brief Live LQR reconfiguration: the gain thread solves for the new gains while the control loop keeps running (50 Hz
+ * ticks, timed back to back), then swaps them in. Invalid cost matrices must be rejected.
+ */
+void benchReconfiguration(BenchmarkContext &context)
+{
+   const auv_control::Matrix12d &Q = context.Q;
+   const auv_control::Matrix8d &R = context.R;
+   AUVModel8 *tuneModel = newModel(context);
+   tuneModel->setLQRCostMatrices(Q, R);
+   tuneModel->setLQRSolver(AUVModel8::LQR_SOLVER_KLEINMAN);
+   tuneModel->startGainThread();
+   auv_control::Vector13d ref = randomReference();
+   auv_control::Vector13d tuneState = nextReference(ref);
+   auv_control::Vector6d tuneAccel = auv_control::Vector6d::Zero();
+   for (int i = 0; i < 10; i++)
+   {
+      tuneModel->computeLQRThrust(tuneState, ref, tuneAccel);
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   }
+   auv_control::Vector8d oldThrust = tuneModel->computeLQRThrust(tuneState, ref, tuneAccel);
+
+   Eigen::MatrixXd badQ = Q;
+   badQ(0, 1) = 1.0; // Not symmetric
+   Eigen::MatrixXd negativeQ = Q;
+   negativeQ(0, 0) = -1.0;
+   int rejected = !tuneModel->reconfigureLQRCostMatrices(badQ, R) + !tuneModel->reconfigureLQRCostMatrices(negativeQ, R) +
+                  !tuneModel->reconfigureLQRCostMatrices(Q, Eigen::MatrixXd::Zero(8, 8)) +
+                  !tuneModel->reconfigureLQRCostMatrices(context.augQ, R); // Integral not enabled
+
+   tuneModel->resetStageLatency();
+   bool reconfigured = tuneModel->reconfigureLQRCostMatrices(Q, 100.0 * R);
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   double swapTime = -1;
+   auv_control::Vector8d newThrust = oldThrust;
+   allocationCount = 0;
+   for (int i = 0; reconfigured && i < 500 && swapTime < 0; i++)
+   {
+      countAllocations = true;
+      newThrust = tuneModel->computeLQRThrust(tuneState, ref, tuneAccel);
+      countAllocations = false;
+      if ((newThrust - oldThrust).cwiseAbs().maxCoeff() > 1e-9)
+         swapTime = elapsedMicros(start);
+      else
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   const auv_core::LatencyHistogram &tuneLatency = tuneModel->getStageLatency(AUVModel8::STAGE_TOTAL);
+   addResult("computeLQRThrust/reconfiguring", tuneLatency);
+
+   // More expensive thrust, so less feedback
+   auv_control::Vector8d tuneNominal = tuneModel->computeNominalThrust(ref, tuneAccel);
+   bool gainsChanged = (swapTime >= 0) && ((newThrust - tuneNominal).norm() < (oldThrust - tuneNominal).norm());
+
+   std::cout << "Live LQR reconfiguration (R x100, gain thread, Kleinman)" << std::endl;
+   std::cout << "   Invalid costs rejected: " << rejected << " of 4" << std::endl;
+   std::cout << "   Time to new gains:      " << swapTime / 1000.0 << " [ms]" << std::endl;
+   std::cout << "   Tick while solving:     p50 " << tuneLatency.getPercentile(50) << ", p99 " << tuneLatency.getPercentile(99)
+             << ", max " << tuneLatency.getMax() << " [us]" << std::endl;
+   std::cout << "   Less feedback:          " << (gainsChanged ? "yes" : "no") << std::endl;
+   std::cout << "   Heap allocations:       " << allocationCount << std::endl;
+   check("reconfigureLQRCostMatrices: invalid costs rejected", rejected == 4);
+   check("reconfigureLQRCostMatrices: valid costs accepted", reconfigured);
+   check("reconfigureLQRCostMatrices: new gains swapped in", gainsChanged);
+   check("computeLQRThrust/reconfiguring: no heap allocations", allocationCount == 0);
+   tuneModel->stopGainThread();
+   delete tuneModel;
+}
+
+/**
+ * \brief Real-time executor: computeLQRThrust (gain thread, Kleinman) at 500 Hz for 1 s, pinned to CPU 0 and SCHED_FIFO
+ * if permitted
+ */
+void benchExecutor(BenchmarkContext &context)
+{
+   AUVModel8 *rtModel = newModel(context);
+   rtModel->setLQRCostMatrices(context.Q, context.R);
+   rtModel->setLQRSolver(AUVModel8::LQR_SOLVER_KLEINMAN);
+   rtModel->startGainThread();
+   auv_control::Vector13d ref = randomReference();
+   auv_control::Vector6d rtAccel = auv_control::Vector6d::Zero();
+   rtModel->computeLQRThrust(nextReference(ref), ref, rtAccel);
+
+   auv_core::RealTimeExecutor executor(0.002, 0, 80);
+   allocationCount = 0;
+   executor.start([&]() {
+      auv_control::Vector13d rtState = nextReference(ref);
+      countAllocations = true;
+      rtModel->computeLQRThrust(rtState, ref, rtAccel);
+      countAllocations = false;
+   });
+   std::this_thread::sleep_for(std::chrono::seconds(1));
+   executor.stop();
+   rtModel->stopGainThread();
+   delete rtModel;
+
+   const auv_core::LatencyHistogram &jitter = executor.getJitter(), &execution = executor.getExecutionTime();
+   std::cout << "Real-time executor (500 Hz, 1 s)" << std::endl;
+   std::cout << "   SCHED_FIFO: " << (executor.isRealTime() ? "yes" : "no") << ", pinned: " << (executor.isPinned() ? "yes" : "no")
+             << std::endl;
+   std::cout << "   Cycles:           " << executor.getCycles() << std::endl;
+   std::cout << "   Overruns:         " << executor.getOverruns() << std::endl;
+   std::cout << "   Wake-up jitter:   p50 " << jitter.getPercentile(50) << ", p99 " << jitter.getPercentile(99) << ", max "
+             << jitter.getMax() << " [us]" << std::endl;
+   std::cout << "   Execution:        p50 " << execution.getPercentile(50) << ", p99 " << execution.getPercentile(99)
+             << ", max " << execution.getMax() << " [us]" << std::endl;
+   std::cout << "   Heap allocations: " << allocationCount << std::endl;
+   addResult("RealTimeExecutor/jitter", jitter).counters.push_back(std::make_pair("overruns", (double)executor.getOverruns()));
+   addResult("RealTimeExecutor/execution", execution);
+   check("RealTimeExecutor: task runs", executor.getCycles() > 0);
+   check("RealTimeExecutor: no heap allocations in the task", allocationCount == 0);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+   // Flags may be anywhere, the remaining arguments are positional
+   std::vector<std::string> args;
+   std::string jsonFile;
+   for (int i = 1; i < argc; i++)
+   {
+      std::string arg(argv[i]);
+      if (arg.compare(0, 16, "--benchmark_out=") == 0)
+         jsonFile = arg.substr(16);
+      else if (arg.compare(0, 2, "--") != 0)
+         args.push_back(arg);
+   }
+   if (args.empty())
+   {
+      std::cout << "Usage: auv_control_bench <path to auv_model.yaml> [iterations] [path to lqr.yaml] [--benchmark_out=<file>]"
+                << std::endl;
+      return 1;
+   }
+
+   BenchmarkContext context;
+   context.iterations = (args.size() > 1) ? std::max(1, atoi(args[1].c_str())) : 1000;
+   context.params = loadModelParams(args[0]);
+   loadCostMatrices(context, (args.size() > 2) ? args[2] : std::string());
+
+   benchConstruction(context);
+   context.model = newModel(context);
+   for (int i = 0; i < context.iterations; i++)
+      context.refs.push_back(randomReference());
+
+   benchJacobian(context);
+   benchNominalThrust(context);
+   benchRiccatiSolvers(context);
+   benchDiscreteLQR(context);
+   benchLQRThrust(context);
+   benchThrusterHealth(context);
+   benchThrustSaturation(context);
+   benchMPC(context);
+   benchCascaded(context);
+   benchFeedForward(context);
+   benchPrediction(context);
+   benchReconfiguration(context);
+   benchExecutor(context);
+   delete context.model;
+
+   if (!jsonFile.empty() && !writeBenchmarkJSON(jsonFile, argv[0]))
+   {
+      std::cout << "Unable to write " << jsonFile << std::endl;
+      return 1;
+   }
+
+   std::cout << failedChecks.size() << " checks failed" << std::endl;
+   for (int i = 0; i < failedChecks.size(); i++)
+      std::cout << "   " << failedChecks[i] << std::endl;
+   return failedChecks.empty() ? 0 : 1;
+}
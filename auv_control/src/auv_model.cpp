@@ -2,12 +2,49 @@
 
 namespace auv_control
 {
-AUVModel::AUVModel(double Fg, double Fb,
-                   const Eigen::Ref<const Eigen::Vector3d> &CoB,
-                   const Eigen::Ref<const Eigen::Matrix3d> &inertia,
-                   const Eigen::Ref<const Matrix62d> &dragCoeffs,
-                   const Eigen::Ref<const Matrix58d> &thrusterData,
-                   int numThrusters)
+const int AbstractAUVModel::THRUSTER_SIZES[AbstractAUVModel::NUM_THRUSTER_SIZES] = {6, 8, 10};
+const char *const AbstractAUVModel::STAGE_NAMES[AbstractAUVModel::NUM_STAGES] = {"nominal_thrust", "jacobian", "riccati", "gain_multiply", "saturation", "total"};
+const double AbstractAUVModel::PREDICTION_STEP = 0.005;
+
+/**
+ * @param Fg Weight [N]
+ * @param Fb Buoyant force [N]
+ * @param CoB Center of buoyancy relative to the center of mass [m]
+ * @param inertia 3x3 inertia matrix [kg-m^2]
+ * @param dragCoeffs Linear and quadratic drag coefficients (column 0: translational, column 1: rotational)
+ * @param thrusterData Each COLUMN contains an enabled thruster's data (x, y, z, yaw, pitch)
+ * @param numThrusters Number of enabled thrusters (columns of thrusterData)
+ * \brief Instantiate the smallest AUVModel (THRUSTER_SIZES) that fits the thrusters. Returns NULL if there are more
+ * than MAX_THRUSTERS.
+ */
+AbstractAUVModel *AbstractAUVModel::create(double Fg, double Fb,
+                                           const Eigen::Ref<const Eigen::Vector3d> &CoB,
+                                           const Eigen::Ref<const Eigen::Matrix3d> &inertia,
+                                           const Eigen::Ref<const Matrix62d> &dragCoeffs,
+                                           const Eigen::Ref<const Eigen::MatrixXd> &thrusterData,
+                                           int numThrusters)
+{
+   numThrusters = std::min(numThrusters, (int)thrusterData.cols());
+   if (numThrusters <= 6)
+      return new AUVModel<6>(Fg, Fb, CoB, inertia, dragCoeffs, thrusterData, numThrusters);
+   else if (numThrusters <= 8)
+      return new AUVModel<8>(Fg, Fb, CoB, inertia, dragCoeffs, thrusterData, numThrusters);
+   else if (numThrusters <= 10)
+      return new AUVModel<10>(Fg, Fb, CoB, inertia, dragCoeffs, thrusterData, numThrusters);
+   return NULL;
+}
+
+/**
+ * @param thrusterData Each COLUMN contains a thruster's data (x, y, z, yaw, pitch), only the first numThrusters are used
+ * @param numThrusters Number of (enabled) thrusters, at most N
+ */
+template <int N>
+AUVModel<N>::AUVModel(double Fg, double Fb,
+                      const Eigen::Ref<const Eigen::Vector3d> &CoB,
+                      const Eigen::Ref<const Eigen::Matrix3d> &inertia,
+                      const Eigen::Ref<const Matrix62d> &dragCoeffs,
+                      const Eigen::Ref<const Eigen::MatrixXd> &thrusterData,
+                      int numThrusters)
 {
    // Vehicle Properties
    Fg_ = Fg;                                   // [N]
@@ -16,9 +53,9 @@ AUVModel::AUVModel(double Fg, double Fb,
    CoB_ = CoB;                                 // Center of buoyancy relative to center of mass (X [m], Y [m], Z [m])
    inertia_ = inertia;                         // 3x3 inertia matrix [kg-m^2]
    dragCoeffs_ = dragCoeffs;
-   thrusterData_ = thrusterData;
-   maxThrusters_ = 8;
-   numThrusters_ = std::min(numThrusters, maxThrusters_);
+   numThrusters_ = std::max(0, std::min(std::min(numThrusters, N), (int)thrusterData.cols()));
+   thrusterData_.setZero();
+   thrusterData_.leftCols(numThrusters_) = thrusterData.block(0, 0, 5, numThrusters_);
 
    // LQR variables
    A_.setZero();
@@ -41,9 +78,29 @@ AUVModel::AUVModel(double Fg, double Fb,
 
    initLQR_ = false;
    enableLQRIntegral_ = false;
+   pendingCosts_.Q.setZero();
+   pendingCosts_.augQ.setZero();
+   pendingCosts_.R.setZero();
+   costsPending_ = false;
+   costVersion_ = 0;
+   gainSchedule_ = NULL;
+   feedForward_ = NULL;
+   feedForwardHealth_ = 0;
+   feedForwardCostVersion_ = 0;
+   feedForwardCostsMatch_ = false;
+   feedForwardRef_.setZero();
+   feedForwardAccel_.setZero();
+   feedForwardThrust_.setZero();
+   feedForwardK_.setZero();
+   feedForwardAugK_.setZero();
+   gainThread_ = NULL;
+   stopGainThread_ = false;
+   sem_init(&gainSignal_, 0, 0);
+   lqrSolverType_ = AUVModel::LQR_SOLVER_SCHUR;
+   jacobianMethod_ = AUVModel::JACOBIAN_ANALYTIC;
 
    // Initialize arrays
-   for (int i = 0; i < maxThrusters_; i++)
+   for (int i = 0; i < N; i++)
       nominalThrust_[i] = 0;
 
    for (int i = 0; i < 3; i++)
@@ -58,20 +115,67 @@ AUVModel::AUVModel(double Fg, double Fb,
 
    AUVModel::setThrustCoeffs();
    AUVModel::setLinearizedInputMatrix();
+   AUVModel::recordSystemTape();
+   dynamics_ = new AUVDynamics<double>(Fg_, Fb_, CoB_, inertia_, dragCoeffs_);
+   nominalThrustSolver_ = AUVModel::NOMINAL_THRUST_PINV;
+   minThrust_.setZero();
+   maxThrust_.setZero();
+   enableThrustLimits_ = false;
+   saturatedAllocator_.setThrustCoeffs(thrustCoeffs_);
+   mpcTimeStep_ = 0;
+
+   outerK_.setZero();
+   innerK_.setZero();
+   CascadeCommand command;
+   command.load.setZero();
+   command.ref.setZero();
+   command.valid = false;
+   cascadeBuffer_.reset(command);
+   cascadeHealth_ = ~0u;
+   initCascade_ = false;
 
-   // Initialize ceres problem
-   problemNominalThrust.AddResidualBlock(
-       new ceres::AutoDiffCostFunction<NominalThrustSolver, 6, 8>(new NominalThrustSolver(Fg_, Fb_, CoB_, inertia_, dragCoeffs_, thrustCoeffs_,
-                                                                                          quaternion_, uvw_, pqr_, inertialTransAccel_, pqrDot_)),
-       NULL, nominalThrust_);
+   // Initialize ceres problem (the residuals are linear in the thrusts, so the cost function provides the Jacobian)
+   nominalThrustCost_ = new NominalThrustCostFunction<N>(new NominalThrustSolver<N>(Fg_, Fb_, CoB_, inertia_, dragCoeffs_, thrustCoeffs_,
+                                                                                    quaternion_, uvw_, pqr_, inertialTransAccel_, pqrDot_),
+                                                         thrustCoeffs_);
+   problemNominalThrust.AddResidualBlock(nominalThrustCost_, NULL, nominalThrust_);
    optionsNominalThrust.max_num_iterations = 100;
    optionsNominalThrust.linear_solver_type = ceres::DENSE_QR;
+
+   // Thruster configurations (the allocation matrices only depend on the thruster layout, so they are computed once)
+   // All thrusters start healthy. The other configurations are computed in the background, since there are 2^numThrusters.
+   unsigned int numConfigs = 1u << numThrusters_;
+   thrusterConfigs_.resize(numConfigs);
+   thrusterConfigReady_ = new std::atomic<bool>[numConfigs];
+   for (unsigned int i = 0; i < numConfigs; i++)
+      thrusterConfigReady_[i] = false;
+   thrusterHealth_ = numConfigs - 1;
+   AUVModel::setThrusterConfig(numConfigs - 1);
+
+   stopConfigThread_ = false;
+   configThread_ = new std::thread(&AUVModel::runConfigThread, this);
+}
+
+template <int N>
+AUVModel<N>::~AUVModel()
+{
+   AUVModel::stopGainThread();
+   AUVModel::clearGainSchedule();
+   AUVModel::clearFeedForward();
+
+   stopConfigThread_ = true;
+   configThread_->join();
+   delete configThread_;
+   delete[] thrusterConfigReady_;
+   delete dynamics_;
+   sem_destroy(&gainSignal_);
 }
 
 // Set the thruster coefficients. Each column corresponds to a single thruster.
 // Rows 1,2,3: force contribution in the body-frame X, Y, and Z axes, respectively (range from 0-1)
 // Rows 4,5,6: effective moment arms about body-frame the X, Y, and Z axes, respectively
-void AUVModel::setThrustCoeffs()
+template <int N>
+void AUVModel<N>::setThrustCoeffs()
 {
    thrustCoeffs_.setZero();
 
@@ -84,51 +188,513 @@ void AUVModel::setThrustCoeffs()
       thrustCoeffs_(2, i) = -sin(theta);           // -sin(theta)
 
       // Cross-product
-      thrustCoeffs_.block<3, 1>(3, i) = thrusterData_.block<3, 1>(0, i).cross(thrustCoeffs_.block<3, 1>(0, i));
+      thrustCoeffs_.template block<3, 1>(3, i) = thrusterData_.template block<3, 1>(0, i).cross(thrustCoeffs_.template block<3, 1>(0, i));
    }
 }
 
+template <int N>
+int AUVModel<N>::getNumThrusters()
+{
+   return numThrusters_;
+}
+
+/**
+ * \brief Returns the number of thrusters the model is sized for (N), the size of the thrust vectors
+ */
+template <int N>
+int AUVModel<N>::getMaxThrusters()
+{
+   return N;
+}
+
+/**
+ * @param R LQR input cost matrix, NxN (or smaller)
+ * \brief Set the input cost matrix. If R is smaller than NxN (i.e. only covers the enabled thrusters), the remaining
+ * inputs are weighted by the identity (they have no effect on the vehicle, so their gains are zero regardless).
+ */
+template <int N>
+void AUVModel<N>::setInputCostMatrix(const Eigen::Ref<const Eigen::MatrixXd> &R)
+{
+   int size = std::min(N, (int)std::min(R.rows(), R.cols()));
+   R_.setIdentity();
+   R_.topLeftCorner(size, size) = R.topLeftCorner(size, size);
+}
+
 /**
  * @param Q LQR state cost matrix
- * @param R LQR input cost matrix
+ * @param R LQR input cost matrix (see setInputCostMatrix)
  */
-void AUVModel::setLQRCostMatrices(const Eigen::Ref<const Matrix12d> &Q, const Eigen::Ref<const Matrix8d> &R)
+template <int N>
+void AUVModel<N>::setLQRCostMatrices(const Eigen::Ref<const Matrix12d> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R)
 {
+   bool restartGainThread = (gainThread_ != NULL);
+   AUVModel::stopGainThread();
+
    Q_ = Q;
-   R_ = R;
+   AUVModel::setInputCostMatrix(R);
+   costsPending_ = false; // Replaces any pending reconfiguration
    initLQR_ = true;
+   AUVModel::clearGainSchedule(); // Gains no longer correspond to the cost matrices
+   AUVModel::clearFeedForward();
+
+   if (restartGainThread)
+      AUVModel::startGainThread();
 }
 
 /**
  * @param Q LQR state cost matrix, for the augmented matrix (includes integral action)
- * @param R LQR input cost matrix
+ * @param R LQR input cost matrix (see setInputCostMatrix)
  */
-void AUVModel::setLQRIntegralCostMatrices(const Eigen::Ref<const Matrix18d> &augQ, const Eigen::Ref<const Matrix8d> &R)
+template <int N>
+void AUVModel<N>::setLQRIntegralCostMatrices(const Eigen::Ref<const Matrix18d> &augQ, const Eigen::Ref<const Eigen::MatrixXd> &R)
 {
+   bool restartGainThread = (gainThread_ != NULL);
+   AUVModel::stopGainThread();
+
    augQ_ = augQ;
-   R_ = R;
+   AUVModel::setInputCostMatrix(R);
+   costsPending_ = false; // Replaces any pending reconfiguration
    initLQR_ = true;
    enableLQRIntegral_ = true;
+   AUVModel::clearGainSchedule(); // Gains no longer correspond to the cost matrices
+   AUVModel::clearFeedForward();
+
+   if (restartGainThread)
+      AUVModel::startGainThread();
 }
 
 /**
- * \param state Reference state for a given time instance
- * \brief Compute the Jacobian of the 12x12 system matrix
+ * @param Q LQR state cost matrix, 12x12 (or the 18x18 augmented matrix if the integral is enabled)
+ * @param R LQR input cost matrix (see setInputCostMatrix)
+ * \brief Change the cost matrices while the controller runs, without stopping the gain thread or waiting on a solve.
+ * If the gain thread runs, it recomputes the gains (warm-started from the current ones with the Kleinman solver) and
+ * publishes them atomically, until then the control thread keeps the previous gains. Otherwise the control thread
+ * applies the new costs at the start of its next tick. Returns false (nothing changes) if the matrices are the wrong
+ * size, not symmetric, Q is not positive semi-definite, or R is not positive definite, or if the gains do not depend on
+ * the cost matrices at runtime (gain schedule or cascaded control).
+ */
+template <int N>
+bool AUVModel<N>::reconfigureLQRCostMatrices(const Eigen::Ref<const Eigen::MatrixXd> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R)
+{
+   int stateSize = enableLQRIntegral_ ? state_dim_aug : state_dim;
+   if (!initLQR_ || gainSchedule_ != NULL || initCascade_)
+      return false;
+   if (Q.rows() != stateSize || Q.cols() != stateSize || R.rows() < 1 || R.rows() != R.cols())
+      return false;
+   if (!Q.allFinite() || !R.allFinite() || !Q.isApprox(Q.transpose()) || !R.isApprox(R.transpose()))
+      return false;
+
+   Eigen::LDLT<Eigen::MatrixXd> Qldlt(Q);
+   Eigen::LLT<Eigen::MatrixXd> Rllt(R);
+   double tolerance = 1e-12 * std::max(1.0, Q.cwiseAbs().maxCoeff());
+   if (Qldlt.info() != Eigen::Success || Qldlt.vectorD().minCoeff() < -tolerance || Rllt.info() != Eigen::Success)
+      return false;
+
+   std::unique_lock<std::mutex> lock(costMutex_);
+   if (!enableLQRIntegral_)
+      pendingCosts_.Q = Q;
+   else
+      pendingCosts_.augQ = Q;
+   int size = std::min(N, (int)R.rows());
+   pendingCosts_.R.setIdentity();
+   pendingCosts_.R.topLeftCorner(size, size) = R.topLeftCorner(size, size);
+   costsPending_ = true;
+   lock.unlock();
+   AUVModel::notifyGainThread();
+   return true;
+}
+
+/**
+ * \brief Returns true if cost matrices passed to reconfigureLQRCostMatrices have not been applied yet
+ */
+template <int N>
+bool AUVModel<N>::isLQRReconfigurePending()
+{
+   return costsPending_;
+}
+
+/**
+ * \brief Apply the cost matrices passed to reconfigureLQRCostMatrices, if any. Only called by the thread that solves for
+ * the gains. It does not wait if the lock is taken, the costs are applied on its next call instead.
+ */
+template <int N>
+void AUVModel<N>::applyPendingCosts()
+{
+   if (!costsPending_)
+      return;
+   std::unique_lock<std::mutex> lock(costMutex_, std::try_to_lock);
+   if (!lock.owns_lock())
+      return;
+
+   if (!enableLQRIntegral_)
+      Q_ = pendingCosts_.Q;
+   else
+      augQ_ = pendingCosts_.augQ;
+   R_ = pendingCosts_.R;
+   costsPending_ = false;
+   costVersion_++;
+}
+
+/**
+ * @param solver Nominal thrust solver, either NOMINAL_THRUST_PINV or NOMINAL_THRUST_CERES
+ */
+template <int N>
+void AUVModel<N>::setNominalThrustSolver(int solver)
+{
+   if (solver == AUVModel::NOMINAL_THRUST_CERES)
+      nominalThrustSolver_ = AUVModel::NOMINAL_THRUST_CERES;
+   else
+      nominalThrustSolver_ = AUVModel::NOMINAL_THRUST_PINV;
+}
+
+/**
+ * @param solver LQR solver, either LQR_SOLVER_SCHUR, LQR_SOLVER_KLEINMAN, or LQR_SOLVER_DISCRETE
+ */
+template <int N>
+void AUVModel<N>::setLQRSolver(int solver)
+{
+   if (solver == AUVModel::LQR_SOLVER_KLEINMAN)
+      lqrSolverType_ = AUVModel::LQR_SOLVER_KLEINMAN;
+   else if (solver == AUVModel::LQR_SOLVER_DISCRETE)
+      lqrSolverType_ = AUVModel::LQR_SOLVER_DISCRETE;
+   else
+      lqrSolverType_ = AUVModel::LQR_SOLVER_SCHUR;
+}
+
+/**
+ * @param period Control period [s], the discrete-time LQR (LQR_SOLVER_DISCRETE) is designed for this sample time
+ */
+template <int N>
+void AUVModel<N>::setControlPeriod(double period)
+{
+   dareSolver_.setPeriod(period);
+   dareAugSolver_.setPeriod(period);
+}
+
+/**
+ * @param minThrust Minimum thrust of each (enabled) thruster [N]
+ * @param maxThrust Maximum thrust of each (enabled) thruster [N]
+ * @param maxIterations Maximum number of active-set iterations per control tick (bounds the allocation time)
+ * \brief Keep the total thrust within the thruster limits. Instead of clipping each thruster, which distorts the load on
+ * the vehicle, the thrust is reallocated to best produce the desired load (see SaturatedThrustAllocator).
+ */
+template <int N>
+void AUVModel<N>::setThrustLimits(const Eigen::Ref<const Eigen::VectorXd> &minThrust, const Eigen::Ref<const Eigen::VectorXd> &maxThrust, int maxIterations)
+{
+   int size = std::min(numThrusters_, (int)std::min(minThrust.size(), maxThrust.size()));
+   minThrust_.setZero();
+   maxThrust_.setZero();
+   minThrust_.head(size) = minThrust.head(size);
+   maxThrust_.head(size) = maxThrust.head(size);
+
+   const VectorNd &healthy = thrusterConfigs_[thrusterHealth_].healthy;
+   saturatedAllocator_.setLimits(healthy.asDiagonal() * minThrust_, healthy.asDiagonal() * maxThrust_);
+   saturatedAllocator_.setMaxIterations(maxIterations);
+   cascadeAllocator_.setMaxIterations(maxIterations);
+   cascadeHealth_ = ~0u; // The cascaded inner loop sets its allocator's limits on its next tick
+   enableThrustLimits_ = true;
+}
+
+/**
+ * @param breakpoints Breakpoints of each scheduling variable (see GainSchedule)
+ * \brief Compute the LQR gains over a grid of reference states. Once built, computeLQRThrust interpolates the gains
+ * instead of solving the Riccati equation every tick (the gain thread is stopped, it is no longer needed).
+ * The cost matrices must be set first. Returns true if successful.
  */
-void AUVModel::setLinearizedSystemMatrix(const Eigen::Ref<const Vector13d> &ref)
+template <int N>
+bool AUVModel<N>::buildGainSchedule(const std::vector<std::vector<double> > &breakpoints)
+{
+   if (!initLQR_)
+      return false;
+   AUVModel::stopGainThread();
+   AUVModel::clearGainSchedule();
+
+   GainSchedule *schedule;
+   if (!enableLQRIntegral_)
+      schedule = new GainSchedule(breakpoints, Q_, R_);
+   else
+      schedule = new GainSchedule(breakpoints, augQ_, R_);
+
+   for (int i = 0; i < schedule->getNumPoints(); i++)
+   {
+      AUVModel::computeLQRGains(schedule->getReference(i));
+      if (!enableLQRIntegral_)
+         schedule->setGain(i, K_);
+      else
+         schedule->setGain(i, augK_);
+   }
+
+   gainSchedule_ = schedule;
+   AUVModel::resetStageLatency(); // Building the schedule is not representative of the control loop
+   return true;
+}
+
+/**
+ * @param file Path to the gain schedule file
+ * @param breakpoints Expected breakpoints of each scheduling variable
+ * \brief Load a gain schedule previously written by saveGainSchedule. The schedule is rejected (returns false) if it was
+ * computed over a different grid, with different cost matrices, or for a different vehicle model.
+ */
+template <int N>
+bool AUVModel<N>::loadGainSchedule(const std::string &file, const std::vector<std::vector<double> > &breakpoints)
+{
+   if (!initLQR_)
+      return false;
+   AUVModel::stopGainThread();
+   AUVModel::clearGainSchedule();
+
+   GainSchedule *schedule = new GainSchedule();
+   bool compatible = schedule->load(file);
+   if (compatible && !enableLQRIntegral_)
+      compatible = schedule->isCompatible(breakpoints, Q_, R_);
+   else if (compatible)
+      compatible = schedule->isCompatible(breakpoints, augQ_, R_);
+
+   // The gains also depend on the vehicle model, so spot-check the first grid point
+   if (compatible)
+   {
+      AUVModel::computeLQRGains(schedule->getReference(0));
+      Eigen::MatrixXd K;
+      if (!enableLQRIntegral_)
+         K = K_;
+      else
+         K = augK_;
+      double maxError = (schedule->getGain(0) - K).cwiseAbs().maxCoeff();
+      compatible = (maxError <= 1e-4 * std::max(1.0, K.cwiseAbs().maxCoeff()));
+   }
+
+   if (!compatible)
+   {
+      delete schedule;
+      return false;
+   }
+   gainSchedule_ = schedule;
+   return true;
+}
+
+/**
+ * @param file Path to the gain schedule file
+ * \brief Write the current gain schedule to a binary file. Returns true if successful.
+ */
+template <int N>
+bool AUVModel<N>::saveGainSchedule(const std::string &file)
+{
+   if (gainSchedule_ == NULL)
+      return false;
+   return gainSchedule_->save(file);
+}
+
+template <int N>
+void AUVModel<N>::clearGainSchedule()
+{
+   if (gainSchedule_ != NULL)
+      delete gainSchedule_;
+   gainSchedule_ = NULL;
+}
+
+/**
+ * \brief Start computing the LQR gains on a separate thread, so computeLQRThrust never waits on the Riccati solver.
+ * The initial gains are computed (here) about a level, stationary reference. The cost matrices must be set first, and
+ * the thread is not needed (returns false) if a gain schedule is in use.
+ */
+template <int N>
+bool AUVModel<N>::startGainThread()
+{
+   if (!initLQR_ || gainSchedule_ != NULL || gainThread_ != NULL)
+      return false;
+
+   Vector13d ref = Vector13d::Zero();
+   ref(auv_core::constants::STATE_Q0) = 1;
+   AUVModel::computeLQRGains(ref);
+
+   LQRGains gains;
+   gains.K = K_;
+   gains.augK = augK_;
+   gainBuffer_.reset(gains);
+   refBuffer_.reset(ref);
+
+   stopGainThread_ = false;
+   gainThread_ = new std::thread(&AUVModel::runGainThread, this);
+   return true;
+}
+
+template <int N>
+void AUVModel<N>::stopGainThread()
+{
+   if (gainThread_ == NULL)
+      return;
+
+   stopGainThread_ = true;
+   AUVModel::notifyGainThread();
+   gainThread_->join();
+   delete gainThread_;
+   gainThread_ = NULL;
+}
+
+/**
+ * @param stage Stage of computeLQRThrust (STAGE_*)
+ * \brief Returns the latency histogram of the stage [us]
+ */
+template <int N>
+const auv_core::LatencyHistogram &AUVModel<N>::getStageLatency(int stage)
+{
+   return stageLatency_[std::min(std::max(stage, 0), AUVModel::NUM_STAGES - 1)];
+}
+
+/**
+ * \brief Clear the latency histograms of all stages
+ */
+template <int N>
+void AUVModel<N>::resetStageLatency()
+{
+   for (int i = 0; i < AUVModel::NUM_STAGES; i++)
+      stageLatency_[i].reset();
+}
+
+/**
+ * @param healthMask Bit i is set if thruster i is healthy
+ * \brief Compute the allocation and input matrices for a combination of healthy thrusters. Failed thrusters get zero
+ * weight in the allocation and zero columns in the input matrices, so neither the nominal thrust nor the LQR uses them.
+ */
+template <int N>
+void AUVModel<N>::setThrusterConfig(unsigned int healthMask)
+{
+   ThrusterConfig &config = thrusterConfigs_[healthMask];
+   for (int i = 0; i < N; i++)
+      config.healthy(i) = (i < numThrusters_ && (healthMask & (1u << i))) ? 1.0 : 0.0;
+
+   ThrustAllocator<N> allocator(thrustCoeffs_, config.healthy);
+   config.allocation = allocator.getAllocationMatrix();
+   config.B = B_ * config.healthy.asDiagonal();
+   config.augB = augB_ * config.healthy.asDiagonal();
+   thrusterConfigReady_[healthMask].store(true, std::memory_order_release);
+}
+
+/**
+ * \brief Config thread: compute the remaining thruster configurations, fewest failed thrusters first (most likely needed)
+ */
+template <int N>
+void AUVModel<N>::runConfigThread()
+{
+   unsigned int numConfigs = thrusterConfigs_.size();
+   for (int numFailed = 1; numFailed <= numThrusters_; numFailed++)
+   {
+      for (unsigned int mask = 0; mask < numConfigs; mask++)
+      {
+         if (stopConfigThread_)
+            return;
+
+         int numHealthy = 0;
+         for (int i = 0; i < numThrusters_; i++)
+            numHealthy += (mask >> i) & 1u;
+         if (numThrusters_ - numHealthy == numFailed)
+            AUVModel::setThrusterConfig(mask);
+      }
+   }
+}
+
+/**
+ * @param healthMask Bit i is set if (enabled) thruster i is healthy. Bits beyond the number of thrusters are ignored.
+ * \brief Switch to the precomputed configuration for the healthy thrusters (O(1), no solver work). The nominal thrust and
+ * the LQR gains stop using the failed thrusters, and they are commanded zero thrust. Returns false, and keeps the
+ * current configuration, if this one has not been computed yet (see isThrusterHealthReady).
+ * Call from the control thread (the same one calling computeLQRThrust).
+ */
+template <int N>
+bool AUVModel<N>::setThrusterHealth(unsigned int healthMask)
+{
+   healthMask &= (unsigned int)thrusterConfigs_.size() - 1;
+   if (!thrusterConfigReady_[healthMask].load(std::memory_order_acquire))
+      return false;
+   if (healthMask == thrusterHealth_)
+      return true;
+
+   const VectorNd &healthy = thrusterConfigs_[healthMask].healthy;
+   nominalThrustCost_->setThrustCoeffs(thrustCoeffs_ * healthy.asDiagonal());
+   saturatedAllocator_.setThrustCoeffs(thrustCoeffs_ * healthy.asDiagonal());
+   saturatedAllocator_.setLimits(healthy.asDiagonal() * minThrust_, healthy.asDiagonal() * maxThrust_);
+   thrusterHealth_ = healthMask;
+   return true;
+}
+
+/**
+ * \brief Returns the current thruster health bitmask (bit i is set if thruster i is healthy)
+ */
+template <int N>
+unsigned int AUVModel<N>::getThrusterHealth()
+{
+   return thrusterHealth_;
+}
+
+/**
+ * @param healthMask Bit i is set if thruster i is healthy
+ * \brief Returns true if the configuration for the healthy thrusters has been computed (setThrusterHealth will succeed)
+ */
+template <int N>
+bool AUVModel<N>::isThrusterHealthReady(unsigned int healthMask)
+{
+   healthMask &= (unsigned int)thrusterConfigs_.size() - 1;
+   return thrusterConfigReady_[healthMask].load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Wake up the gain thread after publishing a reference, staging costs, or stopping it. Posting the semaphore is a
+ * single syscall that never blocks or takes a lock, so the control thread can not wait on the gain thread (no priority
+ * inversion). The work is published before the post, so the gain thread sees it when it wakes up.
+ */
+template <int N>
+void AUVModel<N>::notifyGainThread()
+{
+   sem_post(&gainSignal_);
+}
+
+/**
+ * \brief Gain thread: wait for a new reference, relinearize and solve for the gains, then publish them
+ */
+template <int N>
+void AUVModel<N>::runGainThread()
+{
+   while (!stopGainThread_)
+   {
+      if (sem_wait(&gainSignal_) != 0 && errno == EINTR)
+         continue;
+      while (sem_trywait(&gainSignal_) == 0) // Posted every tick while solving: one solve covers them all
+         ;
+      if (stopGainThread_ || !(refBuffer_.hasNewData() || costsPending_))
+         continue;
+
+      // New cost matrices are solved for at the latest reference, even if it has not changed
+      AUVModel::applyPendingCosts();
+      AUVModel::computeLQRGains(refBuffer_.read());
+
+      LQRGains &gains = gainBuffer_.getWriteBuffer();
+      gains.K = K_;
+      gains.augK = augK_;
+      gainBuffer_.publish();
+   }
+}
+
+/**
+ * \brief Record the auto-diff tape of the 12-state dynamics used to linearize the system matrix.
+ * The reference-dependent terms (q0 and the signs of the quadratic drag terms) are recorded as dynamic parameters,
+ * so the tape is valid for any reference and only needs to be recorded once.
+ */
+template <int N>
+void AUVModel<N>::recordSystemTape()
 {
    // Variables for Auto Diff.
-   size_t n = 12, m = 3;
-   ADVectorXd X(n), Xdot(n);
-   std::vector<double> jac(n * n); // Create nxn elements to represent a Jacobian matrix ()
+   size_t n = 12;
+   ADVectorXd X(n), Xdot(n), dynamic(AUVModel::TAPE_NUM_DYN);
+   X.setZero();
+   dynamic.setOnes();
 
    // MUST set X to contain INDEPENDENT variables
-   CppAD::Independent(X); // Begin recording sequence
+   CppAD::Independent(X, 0, false, dynamic); // Begin recording sequence
 
    // Using Eigen::Quaternion: quaternion * vector = vector rotated thru the axis-angle encoded within the quaternion
    // So: B-frame vector = quaternion.conjugate() * I-frame vector
    // So: I-frame vector = quaternion * B-frame vector
-   Eigen::Quaternion<CppAD::AD<double>> ADquat(ref(auv_core::constants::STATE_Q0), X[auv_core::constants::ESTATE_Q1], X[auv_core::constants::ESTATE_Q2], X[auv_core::constants::ESTATE_Q3]);
+   Eigen::Quaternion<CppAD::AD<double>> ADquat(dynamic[AUVModel::TAPE_DYN_Q0], X[auv_core::constants::ESTATE_Q1], X[auv_core::constants::ESTATE_Q2], X[auv_core::constants::ESTATE_Q3]);
 
    // Translational States
    // 1. Time derivatives of: xI, yI, zI (expressed in I-frame)
@@ -138,75 +704,188 @@ void AUVModel::setLinearizedSystemMatrix(const Eigen::Ref<const Vector13d> &ref)
    Eigen::Vector3d weight = Eigen::Vector3d::Zero();
    weight(2) = Fg_ - Fb_;
    ADVector3d transDrag; // Translation drag accel
-   transDrag(0) = dragCoeffs_(0, 0) * X[auv_core::constants::ESTATE_U] + auv_core::math_lib::sign(ref(auv_core::constants::STATE_U)) * dragCoeffs_(3, 0) * X[auv_core::constants::ESTATE_U] * X[auv_core::constants::ESTATE_U];
-   transDrag(1) = dragCoeffs_(1, 0) * X[auv_core::constants::ESTATE_V] + auv_core::math_lib::sign(ref(auv_core::constants::STATE_V)) * dragCoeffs_(4, 0) * X[auv_core::constants::ESTATE_V] * X[auv_core::constants::ESTATE_V];
-   transDrag(2) = dragCoeffs_(2, 0) * X[auv_core::constants::ESTATE_W] + auv_core::math_lib::sign(ref(auv_core::constants::STATE_W)) * dragCoeffs_(5, 0) * X[auv_core::constants::ESTATE_W] * X[auv_core::constants::ESTATE_W];
+   for (int i = 0; i < 3; i++)
+   {
+      CppAD::AD<double> vel = X[auv_core::constants::ESTATE_U + i];
+      transDrag(i) = dragCoeffs_(i, 0) * vel + dynamic[AUVModel::TAPE_DYN_SIGN_U + i] * dragCoeffs_(i + 3, 0) * vel * vel;
+   }
    Xdot.segment<3>(auv_core::constants::ESTATE_U) = ((ADquat.conjugate() * weight) - transDrag - (X.segment<3>(auv_core::constants::ESTATE_P).cross(X.segment<3>(auv_core::constants::ESTATE_U)))) / mass_;
 
    // Rotational States
    // 3. Time Derivatives of: q1, q2, q3 (remember, quaternion represents the B-frame orientation wrt to the I-frame)
-   ADMatrix3d qoIdentity;
-   Eigen::Matrix3d identity = Eigen::Matrix3d::Identity();
-   qoIdentity = identity * ref(auv_core::constants::STATE_Q0);
-   Xdot.segment<3>(auv_core::constants::ESTATE_Q1) = 0.5 * (qoIdentity * X.segment<3>(auv_core::constants::ESTATE_P) + X.segment<3>(auv_core::constants::ESTATE_Q1).cross(X.segment<3>(auv_core::constants::ESTATE_P)));
+   Xdot.segment<3>(auv_core::constants::ESTATE_Q1) = 0.5 * (dynamic[AUVModel::TAPE_DYN_Q0] * X.segment<3>(auv_core::constants::ESTATE_P) + X.segment<3>(auv_core::constants::ESTATE_Q1).cross(X.segment<3>(auv_core::constants::ESTATE_P)));
 
    // 4. Time Derivatives of: P, Q, R (expressed in B-frame)
    Eigen::Vector3d forceBuoyancy = Eigen::Vector3d::Zero();
    forceBuoyancy(2) = -Fb_;
    ADVector3d rotDrag; // Rotational drag accel
-   rotDrag(0) = dragCoeffs_(0, 1) * X[auv_core::constants::ESTATE_P] + auv_core::math_lib::sign(ref(auv_core::constants::STATE_P)) * dragCoeffs_(3, 1) * X[auv_core::constants::ESTATE_P] * X[auv_core::constants::ESTATE_P];
-   rotDrag(1) = dragCoeffs_(1, 1) * X[auv_core::constants::ESTATE_Q] + auv_core::math_lib::sign(ref(auv_core::constants::STATE_Q)) * dragCoeffs_(4, 1) * X[auv_core::constants::ESTATE_Q] * X[auv_core::constants::ESTATE_Q];
-   rotDrag(2) = dragCoeffs_(2, 1) * X[auv_core::constants::ESTATE_R] + auv_core::math_lib::sign(ref(auv_core::constants::STATE_R)) * dragCoeffs_(5, 1) * X[auv_core::constants::ESTATE_R] * X[auv_core::constants::ESTATE_R];
+   for (int i = 0; i < 3; i++)
+   {
+      CppAD::AD<double> angVel = X[auv_core::constants::ESTATE_P + i];
+      rotDrag(i) = dragCoeffs_(i, 1) * angVel + dynamic[AUVModel::TAPE_DYN_SIGN_P + i] * dragCoeffs_(i + 3, 1) * angVel * angVel;
+   }
    Xdot.segment<3>(auv_core::constants::ESTATE_P) = inertia_.inverse() * (CoB_.cross(ADquat.conjugate() * forceBuoyancy) - rotDrag - X.segment<3>(auv_core::constants::ESTATE_P).cross(inertia_ * X.segment<3>(auv_core::constants::ESTATE_P)));
 
+   // Stop recording and optimize the operation sequence
+   systemTape_.Dependent(X, Xdot);
+   systemTape_.optimize();
+
+   // Sparsity pattern of the Jacobian (holds for all values of the dynamic parameters)
+   CppAD::sparse_rc<std::vector<size_t> > identity(n, n, n);
+   for (size_t k = 0; k < n; k++)
+      identity.set(k, k, k);
+   systemTape_.for_jac_sparsity(identity, false, false, false, jacPattern_);
+   jacSubset_ = CppAD::sparse_rcv<std::vector<size_t>, std::vector<double> >(jacPattern_);
+
+   tapeX_.assign(n, 0.0);
+   tapeDynamic_.assign(AUVModel::TAPE_NUM_DYN, 0.0);
+}
+
+/**
+ * @param method Method used to compute the system matrix, either JACOBIAN_ANALYTIC or JACOBIAN_AUTODIFF
+ */
+template <int N>
+void AUVModel<N>::setJacobianMethod(int method)
+{
+   if (method == AUVModel::JACOBIAN_AUTODIFF)
+      jacobianMethod_ = AUVModel::JACOBIAN_AUTODIFF;
+   else
+      jacobianMethod_ = AUVModel::JACOBIAN_ANALYTIC;
+}
+
+/**
+ * \param state Reference state for a given time instance
+ * \brief Compute the Jacobian of the 12x12 system matrix
+ */
+template <int N>
+void AUVModel<N>::setLinearizedSystemMatrix(const Eigen::Ref<const Vector13d> &ref)
+{
+   if (jacobianMethod_ == AUVModel::JACOBIAN_ANALYTIC)
+      dynamics_->computeSystemMatrix(ref, A_);
+   else
+      AUVModel::setAutoDiffSystemMatrix(ref);
+
+   if (enableLQRIntegral_)
+   {
+      augA_.setZero();
+      augA_.block<12, 12>(0, 0) = A_;
+
+      // Integral states: time derivatives of the position and quaternion integral errors are the errors themselves
+      augA_.block<3, 3>(12, auv_core::constants::ESTATE_XI).setIdentity();
+      augA_.block<3, 3>(15, auv_core::constants::ESTATE_Q1).setIdentity();
+   }
+}
+
+/**
+ * \param state Reference state for a given time instance
+ * \brief Compute the Jacobian of the 12x12 system matrix by evaluating the auto-diff tape
+ */
+template <int N>
+void AUVModel<N>::setAutoDiffSystemMatrix(const Eigen::Ref<const Vector13d> &ref)
+{
+   // Update dynamic parameters
+   tapeDynamic_[AUVModel::TAPE_DYN_Q0] = ref(auv_core::constants::STATE_Q0);
+   for (int i = 0; i < 3; i++)
+   {
+      tapeDynamic_[AUVModel::TAPE_DYN_SIGN_U + i] = auv_core::math_lib::sign(ref(auv_core::constants::STATE_U + i));
+      tapeDynamic_[AUVModel::TAPE_DYN_SIGN_P + i] = auv_core::math_lib::sign(ref(auv_core::constants::STATE_P + i));
+   }
+   systemTape_.new_dynamic(tapeDynamic_);
+
    // Evaluated reference state (excludes q0)
-   Vector12d evalRef;
-   evalRef.head<6>() = ref.head<6>();
-   evalRef.tail<6>() = ref.tail<6>();
-
-   // Compute Jacobian
-   std::vector<double> x;
-   for (int i = 0; i < 12; i++)
-      x.push_back(evalRef(i));
-   CppAD::ADFun<double> f(X, Xdot);
-   jac = f.Jacobian(x);
-
-   // Put jacobien elements into matrix format from vector
-   A_.setZero();
-   augA_.setZero();
-   for (int i = 0; i < 12; i++)
+   for (int i = 0; i < 6; i++)
    {
-      for (int j = 0; j < 12; j++)
-      {
-         if (!enableLQRIntegral_)
-            A_(i, j) = (float)jac[i * 12 + j];
-         else
-            augA_(i, j) = (float)jac[i * 12 + j];
-      }
+      tapeX_[i] = ref(i);
+      tapeX_[i + 6] = ref(i + 7);
    }
+
+   // Compute Jacobian (only the structurally non-zero elements)
+   systemTape_.sparse_jac_for(12, tapeX_, jacSubset_, jacPattern_, "cppad", jacWork_);
+
+   // Put jacobien elements into matrix format
+   const std::vector<size_t> &row = jacSubset_.row();
+   const std::vector<size_t> &col = jacSubset_.col();
+   const std::vector<double> &val = jacSubset_.val();
+
+   A_.setZero();
+   for (size_t k = 0; k < jacSubset_.nnz(); k++)
+      A_(row[k], col[k]) = val[k];
+}
+
+/**
+ * \brief Returns the most recent linearized (12x12) system matrix
+ */
+template <int N>
+Matrix12d AUVModel<N>::getLinearizedSystemMatrix()
+{
+   return A_;
 }
 
 /**
  * \brief Set the control input matrix.
+ * Both the regular and augmented matrices are set, since this is called before the LQR mode is known.
+ */
+template <int N>
+void AUVModel<N>::setLinearizedInputMatrix()
+{
+   B_.setZero();
+   augB_.setZero();
+   B_.template block<3, N>(auv_core::constants::ESTATE_U, 0) = thrustCoeffs_.template block<3, N>(0, 0);                      // Force contributions
+   B_.template block<3, N>(auv_core::constants::ESTATE_P, 0) = inertia_.inverse() * thrustCoeffs_.template block<3, N>(3, 0); // Moment contributions
+   augB_.template block<12, N>(0, 0) = B_;                                                                                     // Integral states are not actuated
+}
+
+template <int N>
+typename AUVModel<N>::Matrix12xNd AUVModel<N>::getLinearizedInputMatrix()
+{
+   return B_;
+}
+
+/**
+ * @param ref Reference state
+ * \brief Linearize the system about the reference state and solve for the LQR gains
  */
-void AUVModel::setLinearizedInputMatrix()
+template <int N>
+void AUVModel<N>::computeLQRGains(const Eigen::Ref<const Vector13d> &ref)
 {
+   {
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_JACOBIAN]);
+      AUVModel::setLinearizedSystemMatrix(ref);
+   }
+   auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_RICCATI]);
+
+   // Failed thrusters have zero columns in the input matrix, so their gains are zero.
+   // The Kleinman solver fails if it has no previous solution or does not converge, so use ct_optcon instead.
+   // Either way, the Kleinman solver is warm-started from the latest gains.
+   // The discrete-time solver only fails if the sampled system is not stabilizable, then the continuous gains are used.
+   const ThrusterConfig &config = thrusterConfigs_[thrusterHealth_];
    if (!enableLQRIntegral_)
    {
-      B_.block<3, 8>(auv_core::constants::ESTATE_U, 0) = thrustCoeffs_.block<3, 8>(0, 0);                      // Force contributions
-      B_.block<3, 8>(auv_core::constants::ESTATE_P, 0) = inertia_.inverse() * thrustCoeffs_.block<3, 8>(3, 0); // Moment contributions
+      if (lqrSolverType_ == AUVModel::LQR_SOLVER_DISCRETE && dareSolver_.compute(Q_, R_, A_, config.B, K_))
+         return;
+      if (lqrSolverType_ != AUVModel::LQR_SOLVER_KLEINMAN || !kleinmanSolver_.compute(Q_, R_, A_, config.B, K_))
+      {
+         lqrSolver_.compute(Q_, R_, A_, config.B, K_);
+         kleinmanSolver_.setInitialGain(K_);
+      }
    }
    else
    {
-      augB_.block<3, 8>(auv_core::constants::ESTATE_U, 0) = thrustCoeffs_.block<3, 8>(0, 0);                      // Force contributions
-      augB_.block<3, 8>(auv_core::constants::ESTATE_P, 0) = inertia_.inverse() * thrustCoeffs_.block<3, 8>(3, 0); // Moment contributions
+      if (lqrSolverType_ == AUVModel::LQR_SOLVER_DISCRETE && dareAugSolver_.compute(augQ_, R_, augA_, config.augB, augK_))
+         return;
+      if (lqrSolverType_ != AUVModel::LQR_SOLVER_KLEINMAN || !kleinmanAugSolver_.compute(augQ_, R_, augA_, config.augB, augK_))
+      {
+         lqrAugSolver_.compute(augQ_, R_, augA_, config.augB, augK_);
+         kleinmanAugSolver_.setInitialGain(augK_);
+      }
    }
 }
 
 // Get total thruster forces/moments as expressed in the B-frame
 // Parameters:
 //      thrusts = VectorXf of force exerted on vehicle by each thruster
-Vector6d AUVModel::getTotalThrustLoad(const Eigen::Ref<const Vector8d> &thrusts)
+template <int N>
+Vector6d AUVModel<N>::getTotalThrustLoad(const Eigen::Ref<const VectorNd> &thrusts)
 {
    Vector6d thrustLoad;
    thrustLoad.setZero();
@@ -217,17 +896,47 @@ Vector6d AUVModel::getTotalThrustLoad(const Eigen::Ref<const Vector8d> &thrusts)
    return thrustLoad;
 }
 
-Vector8d AUVModel::computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
-                                    const Eigen::Ref<const Vector13d> &ref,
-                                    const Eigen::Ref<const Vector6d> &accel)
+/**
+ * @param ref Reference state
+ * @param accel Reference inertial translational acceleration and time-derivative of angular velocity, both expressed in B-frame
+ * \brief Compute the load (forces and moments expressed in the B-frame) the thrusters must provide to follow the reference.
+ * This is the same dynamics balance used by NominalThrustSolver, with the thrust contribution moved to the left-hand side.
+ */
+template <int N>
+Vector6d AUVModel<N>::computeNominalLoad(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel)
 {
-   lqrThrust_.setZero();
-   totalThrust_.setZero();
+   Eigen::Quaterniond quat(ref(auv_core::constants::STATE_Q0), ref(auv_core::constants::STATE_Q1), ref(auv_core::constants::STATE_Q2), ref(auv_core::constants::STATE_Q3));
+   Eigen::Vector3d uvw = ref.segment<3>(auv_core::constants::STATE_U);
+   Eigen::Vector3d pqr = ref.segment<3>(auv_core::constants::STATE_P);
+   Vector6d load = Vector6d::Zero();
 
-   qState_ = Eigen::Quaterniond(state(auv_core::constants::STATE_Q0), state(auv_core::constants::STATE_Q1), state(auv_core::constants::STATE_Q2), state(auv_core::constants::STATE_Q3));
-   qRef_ = Eigen::Quaterniond(ref(auv_core::constants::STATE_Q0), ref(auv_core::constants::STATE_Q1), ref(auv_core::constants::STATE_Q2), ref(auv_core::constants::STATE_Q3));
-   qError_ = qRef_ * qState_.conjugate(); //qState * qRef.conjugate(); // Want quaternion error relative to Inertial-frame (is it qRef * qState.conjugate()?)
+   // Translational Equations: thrust = ma - weight + drag
+   Eigen::Vector3d weight = Eigen::Vector3d::Zero();
+   weight(2) = Fg_ - Fb_;
+   Eigen::Vector3d transDrag = Eigen::Vector3d::Zero();
+   for (int i = 0; i < 3; i++)
+      transDrag(i) = dragCoeffs_(i, 0) * uvw(i) + auv_core::math_lib::sign(uvw(i)) * dragCoeffs_(i + 3, 0) * uvw(i) * uvw(i);
+   load.head<3>() = mass_ * accel.head<3>() - quat.conjugate() * weight + transDrag;
+
+   // Rotational Equations: thrust moment = I*wDot + w x I*w - buoyancy moment + drag
+   Eigen::Vector3d forceBuoyancy = Eigen::Vector3d::Zero();
+   forceBuoyancy(2) = -Fb_;
+   Eigen::Vector3d rotDrag = Eigen::Vector3d::Zero();
+   for (int i = 0; i < 3; i++)
+      rotDrag(i) = dragCoeffs_(i, 1) * pqr(i) + auv_core::math_lib::sign(pqr(i)) * dragCoeffs_(i + 3, 1) * pqr(i) * pqr(i);
+   load.tail<3>() = inertia_ * accel.tail<3>() + pqr.cross(inertia_ * pqr) - CoB_.cross(quat.conjugate() * forceBuoyancy) + rotDrag;
+
+   return load;
+}
 
+/**
+ * @param ref Reference state
+ * @param accel Reference inertial translational acceleration and time-derivative of angular velocity, both expressed in B-frame
+ * \brief Solve for the nominal thrust with the Ceres problem (NominalThrustSolver)
+ */
+template <int N>
+typename AUVModel<N>::VectorNd AUVModel<N>::solveNominalThrustCeres(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel)
+{
    // Set variables for nominal thrust solver
    quaternion_[0] = ref(auv_core::constants::STATE_Q0);
    quaternion_[1] = ref(auv_core::constants::STATE_Q1);
@@ -240,23 +949,269 @@ Vector8d AUVModel::computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
    Eigen::Map<Eigen::Vector3d>(&pqrDot_[0], 3, 1) = accel.tail<3>();
 
    // Initialize nominal forces to zero (this doesn't make too much of a difference)
-   for (int i = 0; i < maxThrusters_; i++)
+   for (int i = 0; i < N; i++)
       nominalThrust_[i] = 0;
 
+   ceres::Solve(optionsNominalThrust, &problemNominalThrust, &summaryNominalThrust);
+   return Eigen::Map<VectorNd>(nominalThrust_);
+}
+
+/**
+ * @param ref Reference state
+ * @param accel Reference inertial translational acceleration and time-derivative of angular velocity, both expressed in B-frame
+ * \brief Compute the thrust needed to follow the reference (feed-forward term of the controller)
+ */
+template <int N>
+typename AUVModel<N>::VectorNd AUVModel<N>::computeNominalThrust(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel)
+{
+   if (nominalThrustSolver_ == AUVModel::NOMINAL_THRUST_CERES)
+      return AUVModel::solveNominalThrustCeres(ref, accel);
+   return thrusterConfigs_[thrusterHealth_].allocation * AUVModel::computeNominalLoad(ref, accel);
+}
+
+/**
+ * @param ref Reference state
+ * @param accel Reference inertial translational acceleration and time-derivative of angular velocity, both expressed in B-frame
+ * @param tolerance Maximum allowed difference between the loads produced by both solutions [N] or [N-m]
+ * \brief Returns true if the closed-form and Ceres nominal thrusts produce the same load on the vehicle.
+ * The thrust problem is under-determined, so the loads are compared rather than the individual thrusts.
+ */
+template <int N>
+bool AUVModel<N>::checkNominalThrust(const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel, double tolerance)
+{
+   VectorNd pinvThrust = thrusterConfigs_[thrusterHealth_].allocation * AUVModel::computeNominalLoad(ref, accel);
+   VectorNd ceresThrust = AUVModel::solveNominalThrustCeres(ref, accel);
+
+   Vector6d loadDiff = AUVModel::getTotalThrustLoad(pinvThrust) - AUVModel::getTotalThrustLoad(ceresThrust);
+   return (loadDiff.cwiseAbs().maxCoeff() <= fabs(tolerance));
+}
+
+/**
+ * @param state Current state
+ * @param ref Reference state
+ * @param accel Reference inertial translational acceleration and time-derivative of angular velocity, both expressed in B-frame
+ * \brief Compute the total (nominal + LQR) thrust, within the thruster limits if set (see setThrustLimits).
+ * After the first call, this does not allocate any memory on the heap,
+ * unless the Ceres nominal thrust solver or the auto-diff Jacobian is used (checked by auv_control_bench).
+ */
+template <int N>
+AbstractAUVModel::ThrustVector AUVModel<N>::computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
+                                                             const Eigen::Ref<const Vector13d> &ref,
+                                                             const Eigen::Ref<const Vector6d> &accel)
+{
+   auv_core::ScopedTimer totalTimer(stageLatency_[AUVModel::STAGE_TOTAL]);
+   if (gainThread_ == NULL)
+      AUVModel::applyPendingCosts();
    if (initLQR_)
    {
-      ceres::Solve(optionsNominalThrust, &problemNominalThrust, &summaryNominalThrust);
-      Eigen::Map<Vector8d> nominalThrust(nominalThrust_);
-      AUVModel::setLinearizedSystemMatrix(ref);
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_NOMINAL_THRUST]);
+      feedForwardThrust_ = AUVModel::computeNominalThrust(ref, accel);
+   }
+   return AUVModel::computeFeedbackThrust(state, ref, feedForwardThrust_, false);
+}
+
+/**
+ * @param refs Reference state at each sample (one column per sample, the first is at time zero)
+ * @param accels Reference acceleration at each sample (see computeLQRThrust)
+ * @param period Time between samples [s], normally the control period
+ * @param compileGains Also solve for the LQR gains at each sample (ignored if the gain thread is running)
+ * \brief Compute the nominal thrust (and optionally the LQR gains) along a trajectory sampled at a fixed period, so
+ * computeLQRThrust(state, time) only interpolates. Replaces the previous trajectory's schedule. The cost matrices must be
+ * set first. Returns false if there are no samples or the period is not positive.
+ */
+template <int N>
+bool AUVModel<N>::compileFeedForward(const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                     const Eigen::Ref<const Eigen::MatrixXd> &accels,
+                                     double period, bool compileGains)
+{
+   AUVModel::clearFeedForward();
+   FeedForwardSchedule *schedule = AUVModel::buildFeedForward(refs, accels, period, compileGains);
+   if (schedule == NULL)
+      return false;
+
+   AUVModel::swapFeedForward(schedule);
+   AUVModel::resetStageLatency(); // Compiling the schedule is not representative of the control loop
+   return true;
+}
+
+/**
+ * @param refs Reference state at each sample (one column per sample, the first is at time zero)
+ * @param accels Reference acceleration at each sample (see computeLQRThrust)
+ * @param period Time between samples [s], normally the control period
+ * @param compileGains Also solve for the LQR gains at each sample (ignored if the gain thread is running)
+ * \brief Build a feed-forward schedule (see compileFeedForward) without installing it, at the current thruster health.
+ * The schedule can be installed in this model or in another one with the same parameters (swapFeedForward), so a model
+ * owned by another thread can build it while this one keeps controlling. Returns NULL if there are no samples or the
+ * period is not positive, otherwise the caller owns the schedule.
+ */
+template <int N>
+FeedForwardSchedule *AUVModel<N>::buildFeedForward(const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                                   const Eigen::Ref<const Eigen::MatrixXd> &accels,
+                                                   double period, bool compileGains)
+{
+   if (gainThread_ == NULL)
+      AUVModel::applyPendingCosts();
+   int numSamples = std::min(refs.cols(), accels.cols());
+   if (!initLQR_ || numSamples < 1 || refs.rows() != 13 || accels.rows() != 6 || period <= 0)
+      return NULL;
+
+   // The gain thread owns K_ and augK_ while it runs
+   compileGains = compileGains && (gainThread_ == NULL);
+   int gainCols = enableLQRIntegral_ ? state_dim_aug : state_dim;
+   FeedForwardSchedule *schedule = new FeedForwardSchedule(numSamples, period, N, compileGains ? N : 0, compileGains ? gainCols : 0);
+   if (!enableLQRIntegral_)
+      schedule->setConfig(thrusterHealth_, Q_, R_);
+   else
+      schedule->setConfig(thrusterHealth_, augQ_, R_);
+
+   for (int i = 0; i < numSamples; i++)
+   {
+      Vector13d ref = refs.col(i);
+      Vector6d accel = accels.col(i);
+      schedule->setSample(i, ref, accel, AUVModel::computeNominalThrust(ref, accel));
+      if (compileGains)
+      {
+         AUVModel::computeLQRGains(ref); // Warm-started from the previous sample with the Kleinman solver
+         if (!enableLQRIntegral_)
+            schedule->setGain(i, K_);
+         else
+            schedule->setGain(i, augK_);
+      }
+   }
+   return schedule;
+}
+
+/**
+ * @param schedule Feed-forward schedule to follow (see buildFeedForward), or NULL to stop. This model takes ownership.
+ * \brief Install a new feed-forward schedule and return the previous one, which the caller deletes (O(1) besides
+ * comparing the cost matrices, so it can be called between control ticks). Its gains are only used if it was built
+ * with this model's current cost matrices.
+ */
+template <int N>
+FeedForwardSchedule *AUVModel<N>::swapFeedForward(FeedForwardSchedule *schedule)
+{
+   FeedForwardSchedule *previous = feedForward_;
+   feedForward_ = schedule;
+   if (schedule == NULL)
+      return previous;
+
+   // The gain thread owns the cost matrices while it runs, and the schedule has no gains then
+   feedForwardHealth_ = schedule->getHealth();
+   feedForwardCostVersion_ = costVersion_;
+   feedForwardCostsMatch_ = schedule->hasGains() && (gainThread_ == NULL);
+   if (feedForwardCostsMatch_ && !enableLQRIntegral_)
+      feedForwardCostsMatch_ = schedule->hasCosts(Q_, R_);
+   else if (feedForwardCostsMatch_)
+      feedForwardCostsMatch_ = schedule->hasCosts(augQ_, R_);
+   return previous;
+}
+
+template <int N>
+void AUVModel<N>::clearFeedForward()
+{
+   if (feedForward_ != NULL)
+      delete feedForward_;
+   feedForward_ = NULL;
+}
+
+/**
+ * @param state Current state
+ * @param time Time since the start of the trajectory [s]
+ * \brief Compute the total (nominal + LQR) thrust along the trajectory given to compileFeedForward. The reference and
+ * nominal thrust (and the gains, if compiled) are interpolated from the feed-forward schedule, so unlike
+ * computeLQRThrust(state, ref, accel), nothing is solved for. If the thruster health changed since the schedule was
+ * compiled, the nominal thrust is recomputed from the interpolated reference and the gains are computed as usual.
+ */
+template <int N>
+AbstractAUVModel::ThrustVector AUVModel<N>::computeLQRThrust(const Eigen::Ref<const Vector13d> &state, double time)
+{
+   auv_core::ScopedTimer totalTimer(stageLatency_[AUVModel::STAGE_TOTAL]);
+   if (feedForward_ == NULL)
+   {
+      totalThrust_.setZero();
+      return totalThrust_;
+   }
+
+   bool current = (feedForwardHealth_ == thrusterHealth_);
+   {
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_NOMINAL_THRUST]);
+      feedForward_->interpolate(time, feedForwardRef_, feedForwardAccel_, feedForwardThrust_);
+      if (!current)
+         feedForwardThrust_ = AUVModel::computeNominalThrust(feedForwardRef_, feedForwardAccel_);
+   }
 
+   // The compiled gains are only valid for the cost matrices they were computed with
+   if (gainThread_ == NULL)
+      AUVModel::applyPendingCosts();
+   bool feedForwardGains = current && feedForwardCostsMatch_ && (feedForwardCostVersion_ == costVersion_);
+   if (feedForwardGains)
+   {
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_RICCATI]);
+      if (!enableLQRIntegral_)
+         feedForward_->interpolateGain(time, feedForwardK_);
+      else
+         feedForward_->interpolateGain(time, feedForwardAugK_);
+   }
+   return AUVModel::computeFeedbackThrust(state, feedForwardRef_, feedForwardThrust_, feedForwardGains);
+}
+
+/**
+ * @param state Current state
+ * @param ref Reference state
+ * @param nominalThrust Nominal (feed-forward) thrust at the reference
+ * @param feedForwardGains If true, use the gains interpolated from the feed-forward schedule
+ * \brief Add the LQR feedback to the nominal thrust, and keep the total within the thruster limits if set (both
+ * computeLQRThrust overloads). Unless feedForwardGains is set, the gains are either computed by the gain thread,
+ * interpolated from the gain schedule, or solved for at the reference.
+ */
+template <int N>
+AbstractAUVModel::ThrustVector AUVModel<N>::computeFeedbackThrust(const Eigen::Ref<const Vector13d> &state,
+                                                                  const Eigen::Ref<const Vector13d> &ref,
+                                                                  const Eigen::Ref<const VectorNd> &nominalThrust,
+                                                                  bool feedForwardGains)
+{
+   lqrThrust_.setZero();
+   totalThrust_.setZero();
+
+   qState_ = Eigen::Quaterniond(state(auv_core::constants::STATE_Q0), state(auv_core::constants::STATE_Q1), state(auv_core::constants::STATE_Q2), state(auv_core::constants::STATE_Q3));
+   qRef_ = Eigen::Quaterniond(ref(auv_core::constants::STATE_Q0), ref(auv_core::constants::STATE_Q1), ref(auv_core::constants::STATE_Q2), ref(auv_core::constants::STATE_Q3));
+   qError_ = qRef_ * qState_.conjugate(); //qState * qRef.conjugate(); // Want quaternion error relative to Inertial-frame (is it qRef * qState.conjugate()?)
+
+   if (initLQR_)
+   {
+      const MatrixNx12d *K = &K_;
+      const MatrixNx18d *augK = &augK_;
+      if (feedForwardGains)
+      {
+         K = &feedForwardK_;
+         augK = &feedForwardAugK_;
+      }
+      else if (gainThread_ != NULL)
+      {
+         refBuffer_.write(ref);
+         AUVModel::notifyGainThread();
+         const LQRGains &gains = gainBuffer_.read(); // Most recently published gains
+         K = &gains.K;
+         augK = &gains.augK;
+      }
+      else if (gainSchedule_ == NULL)
+         AUVModel::computeLQRGains(ref);
+      else
+      {
+         auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_RICCATI]);
+         if (!enableLQRIntegral_)
+            gainSchedule_->interpolate(ref, K_);
+         else
+            gainSchedule_->interpolate(ref, augK_);
+      }
+
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_GAIN_MULTIPLY]);
       if (!enableLQRIntegral_)
       {
          error_.head<6>() = state.head<6>() - ref.head<6>();
          error_.tail<6>() = state.tail<6>() - ref.tail<6>();
          error_.segment<3>(auv_core::constants::ESTATE_Q1) = -qError_.vec(); // Set quaternion error, negate vector part for calculation of input vector
-         //std::cout << "LQR error: " << error << std::endl;
-         lqrSolver_.compute(Q_, R_, A_, B_, K_);
-         lqrThrust_ = -K_ * error_; // U = -K*(state-ref)
+         lqrThrust_ = -(*K) * error_; // U = -K*(state-ref)
       }
       else
       {
@@ -268,21 +1223,292 @@ Vector8d AUVModel::computeLQRThrust(const Eigen::Ref<const Vector13d> &state,
          augError_.segment<3>(12) = positionIntegralError_;
          augError_.segment<3>(15) = -qIntegralError_.vec();
 
-         lqrAugSolver_.compute(augQ_, R_, augA_, augB_, augK_);
-         lqrThrust_ = -augK_ * augError_; // U = -K*(state-ref)
-                                          // Add integral error !!!!!!!!!!!
+         lqrThrust_ = -(*augK) * augError_; // U = -K*(state-ref)
       }
 
-      //std::cout << "Solve LQR, A matrix: " << std::endl << A_ << std::endl;
-      //std::cout << "Solve LQR, B matrix: " << std::endl << B_ << std::endl;
-      //std::cout << "Reference state: " << std::endl << ref << std::endl;
-      //std::cout << "Accel state: " << std::endl << accel << std::endl;
-      //std::cout << "LQR gain K: " << K_ << std::endl;
-      //std::cout << "Nominal Thrust: " << std::endl << nominalThrust << std::endl;
-      std::cout << "LQR thrust: " << lqrThrust_ << std::endl;
+      // Gains from the gain schedule, or published before the last thruster health change, may still use failed thrusters
+      totalThrust_ = thrusterConfigs_[thrusterHealth_].healthy.asDiagonal() * (nominalThrust + lqrThrust_);
+   }
 
-      totalThrust_ = nominalThrust + lqrThrust_;
+   if (initLQR_ && enableThrustLimits_)
+   {
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_SATURATION]);
+      VectorNd desiredThrust = totalThrust_;
+      saturatedAllocator_.solve(desiredThrust, totalThrust_);
    }
    return totalThrust_;
 }
+
+/**
+ * @param state Current state
+ * @param thrust Thrust applied over the horizon (normally the previously commanded thrust)
+ * @param time Prediction horizon [s]
+ * \brief Predict the state after time by integrating the nonlinear dynamics with fixed RK4 steps (of at most
+ * PREDICTION_STEP), e.g. to compensate for the age of the state and the actuation delay. Does not allocate.
+ */
+template <int N>
+Vector13d AUVModel<N>::predictState(const Eigen::Ref<const Vector13d> &state, const ThrustVector &thrust, double time)
+{
+   Vector13d predicted = state;
+   if (!(time > 0) || thrust.size() != N)
+      return predicted;
+
+   Vector6d load = thrustCoeffs_ * thrust.head<N>();
+   int steps = (int)ceil(time / AUVModel::PREDICTION_STEP);
+   dynamics_->predictState(predicted, load, time, steps);
+   return predicted;
+}
+
+/**
+ * @param horizon Number of steps in the MPC horizon
+ * @param timeStep Time between steps [s], normally the control period
+ * @param maxIterations Maximum number of QP solver iterations per control tick
+ * \brief Set up the MPC (allocates the buffers, so call before the control loop). Returns false if the horizon or time
+ * step are not positive.
+ */
+template <int N>
+bool AUVModel<N>::setMPCHorizon(int horizon, double timeStep, int maxIterations)
+{
+   if (horizon <= 0 || timeStep <= 0)
+      return false;
+
+   mpcTimeStep_ = timeStep;
+   mpcSolver_.setHorizon(horizon);
+   mpcSolver_.setMaxIterations(maxIterations);
+   mpcNominalThrust_.assign(horizon, VectorNd::Zero());
+   return true;
+}
+
+/**
+ * \brief Returns the number of steps in the MPC horizon (zero if the MPC is not set up)
+ */
+template <int N>
+int AUVModel<N>::getMPCHorizon()
+{
+   return (mpcTimeStep_ > 0) ? mpcSolver_.getHorizon() : 0;
+}
+
+/**
+ * \brief Returns the number of QP solver iterations used by the last call to computeMPCThrust
+ */
+template <int N>
+int AUVModel<N>::getMPCIterations()
+{
+   return mpcSolver_.getIterations();
+}
+
+/**
+ * @param state Current state
+ * @param refs Reference state at each step of the horizon (13 x horizon), starting now
+ * @param accels Reference accelerations at each step of the horizon (6 x horizon), see computeLQRThrust
+ * \brief Compute the total thrust with linear time-varying MPC, an alternative to computeLQRThrust.
+ * The dynamics are linearized about the reference at every step of the horizon (analytic Jacobian), and discretized
+ * at the MPC time step. The QP minimizes the same costs as the LQR (Q and R, the non-integral part of the augmented Q
+ * in integral mode) over the deviations from the nominal thrust, within the thrust limits if set (see setThrustLimits).
+ * Only the first input is applied. After the first call, this does not allocate any memory on the heap.
+ */
+template <int N>
+AbstractAUVModel::ThrustVector AUVModel<N>::computeMPCThrust(const Eigen::Ref<const Vector13d> &state,
+                                                             const Eigen::Ref<const Eigen::MatrixXd> &refs,
+                                                             const Eigen::Ref<const Eigen::MatrixXd> &accels)
+{
+   auv_core::ScopedTimer totalTimer(stageLatency_[AUVModel::STAGE_TOTAL]);
+   totalThrust_.setZero();
+   if (gainThread_ == NULL)
+      AUVModel::applyPendingCosts();
+
+   int horizon = AUVModel::getMPCHorizon();
+   if (!initLQR_ || horizon == 0 || refs.rows() != 13 || accels.rows() != 6 || refs.cols() < horizon || accels.cols() < horizon)
+      return totalThrust_;
+
+   const VectorNd &healthy = thrusterConfigs_[thrusterHealth_].healthy;
+   {
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_NOMINAL_THRUST]);
+      for (int k = 0; k < horizon; k++)
+         mpcNominalThrust_[k] = AUVModel::computeNominalThrust(refs.col(k), accels.col(k));
+   }
+
+   {
+      // Discretize each linearization (second-order Taylor series of the matrix exponential)
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_JACOBIAN]);
+      const Matrix12xNd &B = thrusterConfigs_[thrusterHealth_].B;
+      double dt = mpcTimeStep_;
+      Vector13d ref;
+      Matrix12d A, Ad, Bdt;
+      Matrix12xNd Bd;
+      VectorNd minThrust, maxThrust;
+      for (int k = 0; k < horizon; k++)
+      {
+         ref = refs.col(k);
+         dynamics_->computeSystemMatrix(ref, A);
+         Bdt = dt * Matrix12d::Identity() + (0.5 * dt * dt) * A;
+         Ad.noalias() = A * Bdt;
+         Ad.diagonal().array() += 1.0;
+         Bd.noalias() = Bdt * B;
+
+         // Failed thrusters are held at zero
+         if (enableThrustLimits_)
+         {
+            minThrust = minThrust_;
+            maxThrust = maxThrust_;
+         }
+         else
+         {
+            minThrust.setConstant(-INFINITY);
+            maxThrust.setConstant(INFINITY);
+         }
+         minThrust = (healthy.array() > 0).select(minThrust, VectorNd::Zero()) - mpcNominalThrust_[k];
+         maxThrust = (healthy.array() > 0).select(maxThrust, VectorNd::Zero()) - mpcNominalThrust_[k];
+         mpcSolver_.setStep(k, Ad, Bd, minThrust, maxThrust);
+      }
+   }
+
+   {
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_GAIN_MULTIPLY]);
+      qState_ = Eigen::Quaterniond(state(auv_core::constants::STATE_Q0), state(auv_core::constants::STATE_Q1), state(auv_core::constants::STATE_Q2), state(auv_core::constants::STATE_Q3));
+      qRef_ = Eigen::Quaterniond(refs(auv_core::constants::STATE_Q0, 0), refs(auv_core::constants::STATE_Q1, 0), refs(auv_core::constants::STATE_Q2, 0), refs(auv_core::constants::STATE_Q3, 0));
+      qError_ = qRef_ * qState_.conjugate();
+      error_.head<6>() = state.head<6>() - refs.col(0).head<6>();
+      error_.tail<6>() = state.tail<6>() - refs.col(0).tail<6>();
+      error_.segment<3>(auv_core::constants::ESTATE_Q1) = -qError_.vec(); // Same error as the LQR
+   }
+
+   {
+      // The ADMM penalty works best at a few times the input cost
+      auv_core::ScopedTimer timer(stageLatency_[AUVModel::STAGE_RICCATI]);
+      if (!enableLQRIntegral_)
+         mpcSolver_.setCostMatrices(Q_, R_);
+      else
+         mpcSolver_.setCostMatrices(augQ_.template block<12, 12>(0, 0), R_);
+      mpcSolver_.setPenalty(3.0 * R_.diagonal().head(std::max(numThrusters_, 1)).mean());
+      mpcSolver_.solve(error_);
+   }
+
+   totalThrust_ = healthy.asDiagonal() * (mpcNominalThrust_[0] + mpcSolver_.getInput(0));
+   return totalThrust_;
+}
+
+/**
+ * @param innerPeriod Period of the inner (attitude) loop [s]
+ * @param outerPeriod Period of the outer (translational) loop [s]
+ * \brief Set up cascaded control, an alternative to computeLQRThrust that splits the LQR into two loops running at
+ * different rates: the outer loop (computeCascadedOuterLoop) controls the position and velocity with the forces, and
+ * the inner loop (computeCascadedInnerLoop) controls the attitude and angular velocity with the moments.
+ * Both gains are discrete-time LQR gains at their loop period, designed once for the linearization at rest (level, zero
+ * velocity), with the state costs from the matching blocks of Q (the integral states are not used), and the input costs
+ * of the loads allocated to the healthy thrusters. Returns false if the cost matrices are not set, a period is not
+ * positive, or a design fails.
+ */
+template <int N>
+bool AUVModel<N>::setCascadedControl(double innerPeriod, double outerPeriod)
+{
+   if (!initLQR_ || !(innerPeriod > 0) || !(outerPeriod > 0))
+      return false;
+
+   Vector13d rest = Vector13d::Zero();
+   rest(auv_core::constants::STATE_Q0) = 1.0;
+   Matrix12d A;
+   dynamics_->computeSystemMatrix(rest, A);
+
+   // Loads as inputs: B*allocation maps the forces to the translational states and the moments to the rotational states
+   const ThrusterConfig &config = thrusterConfigs_[thrusterHealth_];
+   Eigen::Matrix<double, 12, 6> loadB = config.B * config.allocation;
+   Matrix6d loadR = config.allocation.transpose() * R_ * config.allocation;
+   Matrix12d Q = enableLQRIntegral_ ? Matrix12d(augQ_.template block<12, 12>(0, 0)) : Q_;
+
+   DAREDoublingSolver<6, 3> outerSolver(outerPeriod), innerSolver(innerPeriod);
+   Eigen::Matrix<double, 3, 6> outerK, innerK;
+   if (!outerSolver.compute(Q.block<6, 6>(auv_core::constants::ESTATE_XI, auv_core::constants::ESTATE_XI),
+                            loadR.block<3, 3>(0, 0),
+                            A.block<6, 6>(auv_core::constants::ESTATE_XI, auv_core::constants::ESTATE_XI),
+                            loadB.block<6, 3>(auv_core::constants::ESTATE_XI, 0), outerK))
+      return false;
+   if (!innerSolver.compute(Q.block<6, 6>(auv_core::constants::ESTATE_Q1, auv_core::constants::ESTATE_Q1),
+                            loadR.block<3, 3>(3, 3),
+                            A.block<6, 6>(auv_core::constants::ESTATE_Q1, auv_core::constants::ESTATE_Q1),
+                            loadB.block<6, 3>(auv_core::constants::ESTATE_Q1, 3), innerK))
+      return false;
+
+   outerK_ = outerK;
+   innerK_ = innerK;
+   initCascade_ = true;
+   return true;
+}
+
+/**
+ * @param state Current state
+ * @param ref Reference state
+ * @param accel Reference inertial translational acceleration and time-derivative of angular velocity, both expressed in B-frame
+ * \brief Cascaded outer loop: compute the nominal load and the translational feedback force, and hand them to the inner
+ * loop (lock-free, the inner loop may run on another thread). The position error is expressed in the B-frame, like
+ * the velocity error, so the gains do not depend on the attitude. Only one thread may call this.
+ * This does not allocate any memory on the heap.
+ */
+template <int N>
+void AUVModel<N>::computeCascadedOuterLoop(const Eigen::Ref<const Vector13d> &state,
+                                          const Eigen::Ref<const Vector13d> &ref,
+                                          const Eigen::Ref<const Vector6d> &accel)
+{
+   if (!initCascade_)
+      return;
+
+   Eigen::Quaterniond qState(state(auv_core::constants::STATE_Q0), state(auv_core::constants::STATE_Q1), state(auv_core::constants::STATE_Q2), state(auv_core::constants::STATE_Q3));
+   Vector6d error;
+   error.head<3>() = qState.conjugate() * (state.segment<3>(auv_core::constants::STATE_XI) - ref.segment<3>(auv_core::constants::STATE_XI));
+   error.tail<3>() = state.segment<3>(auv_core::constants::STATE_U) - ref.segment<3>(auv_core::constants::STATE_U);
+
+   CascadeCommand &command = cascadeBuffer_.getWriteBuffer();
+   command.load = AUVModel::computeNominalLoad(ref, accel);
+   command.load.template head<3>().noalias() -= outerK_ * error;
+   command.ref = ref;
+   command.valid = true;
+   cascadeBuffer_.publish();
+}
+
+/**
+ * @param state Current state
+ * \brief Cascaded inner loop: add the rotational feedback moment to the latest outer loop command, and allocate the
+ * load to the healthy thrusters (within the thrust limits if set). Returns zero thrust until the outer loop has run.
+ * May run on a different thread than the outer loop (but only one thread may call this).
+ * This does not allocate any memory on the heap.
+ */
+template <int N>
+AbstractAUVModel::ThrustVector AUVModel<N>::computeCascadedInnerLoop(const Eigen::Ref<const Vector13d> &state)
+{
+   const CascadeCommand &command = cascadeBuffer_.read();
+   VectorNd thrust = VectorNd::Zero();
+   if (!initCascade_ || !command.valid)
+      return thrust;
+
+   Eigen::Quaterniond qState(state(auv_core::constants::STATE_Q0), state(auv_core::constants::STATE_Q1), state(auv_core::constants::STATE_Q2), state(auv_core::constants::STATE_Q3));
+   Eigen::Quaterniond qRef(command.ref(auv_core::constants::STATE_Q0), command.ref(auv_core::constants::STATE_Q1), command.ref(auv_core::constants::STATE_Q2), command.ref(auv_core::constants::STATE_Q3));
+   Vector6d error;
+   error.head<3>() = -(qRef * qState.conjugate()).vec(); // Same quaternion error as the LQR
+   error.tail<3>() = state.segment<3>(auv_core::constants::STATE_P) - command.ref.template segment<3>(auv_core::constants::STATE_P);
+
+   Vector6d load = command.load;
+   load.tail<3>().noalias() -= innerK_ * error;
+
+   unsigned int health = thrusterHealth_;
+   const ThrusterConfig &config = thrusterConfigs_[health];
+   thrust = config.healthy.asDiagonal() * (config.allocation * load);
+
+   if (enableThrustLimits_)
+   {
+      if (health != cascadeHealth_)
+      {
+         cascadeAllocator_.setThrustCoeffs(thrustCoeffs_ * config.healthy.asDiagonal());
+         cascadeAllocator_.setLimits(config.healthy.asDiagonal() * minThrust_, config.healthy.asDiagonal() * maxThrust_);
+         cascadeHealth_ = health;
+      }
+      VectorNd desiredThrust = thrust;
+      cascadeAllocator_.solve(desiredThrust, thrust);
+   }
+   return thrust;
+}
+
+// Thruster counts supported by AbstractAUVModel::create (THRUSTER_SIZES)
+template class AUVModel<6>;
+template class AUVModel<8>;
+template class AUVModel<10>;
 } // namespace auv_control
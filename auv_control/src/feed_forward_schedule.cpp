@@ -0,0 +1,157 @@
+#include "auv_control/feed_forward_schedule.hpp"
+
+namespace auv_control
+{
+/**
+ * @param numSamples Number of samples (at least one)
+ * @param period Time between samples [s]
+ * @param numThrusters Size of the nominal thrust vector
+ * @param gainRows Rows of the LQR gain matrix (zero if the gains are not stored)
+ * @param gainCols Columns of the LQR gain matrix (zero if the gains are not stored)
+ */
+FeedForwardSchedule::FeedForwardSchedule(int numSamples, double period, int numThrusters, int gainRows, int gainCols)
+{
+   numSamples_ = std::max(1, numSamples);
+   period_ = std::max(fabs(period), 1e-6);
+   numThrusters_ = std::max(0, numThrusters);
+   gainRows_ = std::max(0, gainRows);
+   gainCols_ = std::max(0, gainCols);
+
+   refs_ = Eigen::MatrixXd::Zero(13, numSamples_);
+   refs_.row(auv_core::constants::STATE_Q0).setOnes();
+   accels_ = Eigen::MatrixXd::Zero(6, numSamples_);
+   thrusts_ = Eigen::MatrixXd::Zero(numThrusters_, numSamples_);
+   gains_ = Eigen::MatrixXd::Zero(gainRows_ * gainCols_, (gainRows_ * gainCols_ > 0) ? numSamples_ : 0);
+   healthMask_ = 0;
+}
+
+/**
+ * @param time Time since the first sample [s]
+ * @param fraction Position between the returned sample and the next one (0 to 1)
+ * \brief Returns the index of the last sample at or before the time, clamped to the table
+ */
+int FeedForwardSchedule::getIndex(double time, double &fraction)
+{
+   double position = std::min(std::max(time / period_, 0.0), (double)(numSamples_ - 1));
+   int index = std::min((int)position, numSamples_ - 1);
+   fraction = position - index;
+   return index;
+}
+
+int FeedForwardSchedule::getNumSamples()
+{
+   return numSamples_;
+}
+
+double FeedForwardSchedule::getPeriod()
+{
+   return period_;
+}
+
+/**
+ * \brief Returns the time of the last sample [s]
+ */
+double FeedForwardSchedule::getDuration()
+{
+   return (numSamples_ - 1) * period_;
+}
+
+bool FeedForwardSchedule::hasGains()
+{
+   return (gains_.cols() > 0);
+}
+
+/**
+ * @param healthMask Thruster health the nominal thrusts (and gains) are computed for (see AUVModel::setThrusterHealth)
+ * @param Q State cost matrix the gains are computed with
+ * @param R Input cost matrix the gains are computed with
+ */
+void FeedForwardSchedule::setConfig(unsigned int healthMask, const Eigen::Ref<const Eigen::MatrixXd> &Q,
+                                    const Eigen::Ref<const Eigen::MatrixXd> &R)
+{
+   healthMask_ = healthMask;
+   Q_ = Q;
+   R_ = R;
+}
+
+unsigned int FeedForwardSchedule::getHealth()
+{
+   return healthMask_;
+}
+
+/**
+ * \brief Returns true if the gains were computed with these cost matrices (see setConfig)
+ */
+bool FeedForwardSchedule::hasCosts(const Eigen::Ref<const Eigen::MatrixXd> &Q, const Eigen::Ref<const Eigen::MatrixXd> &R)
+{
+   if (Q.rows() != Q_.rows() || Q.cols() != Q_.cols() || R.rows() != R_.rows() || R.cols() != R_.cols())
+      return false;
+   return (Q == Q_) && (R == R_);
+}
+
+/**
+ * @param index Sample index (the sample's time is index * period)
+ * @param ref Reference state
+ * @param accel Reference acceleration (see AUVModel::computeLQRThrust)
+ * @param thrust Nominal thrust
+ */
+void FeedForwardSchedule::setSample(int index, const Eigen::Ref<const Vector13d> &ref, const Eigen::Ref<const Vector6d> &accel,
+                                    const Eigen::Ref<const Eigen::VectorXd> &thrust)
+{
+   if (index < 0 || index >= numSamples_ || thrust.size() != numThrusters_)
+      return;
+   refs_.col(index) = ref;
+   accels_.col(index) = accel;
+   thrusts_.col(index) = thrust;
+}
+
+/**
+ * @param index Sample index
+ * @param K LQR gain matrix computed at the sample's reference state
+ */
+void FeedForwardSchedule::setGain(int index, const Eigen::Ref<const Eigen::MatrixXd> &K)
+{
+   if (index < 0 || index >= numSamples_ || !FeedForwardSchedule::hasGains() || K.rows() != gainRows_ || K.cols() != gainCols_)
+      return;
+   Eigen::Map<Eigen::MatrixXd>(gains_.col(index).data(), gainRows_, gainCols_) = K;
+}
+
+/**
+ * @param time Time since the first sample [s]
+ * @param ref Interpolated reference state (the quaternion is renormalized)
+ * @param accel Interpolated reference acceleration
+ * @param thrust Interpolated nominal thrust (must have numThrusters elements)
+ * \brief Linear interpolation between the two samples around the time (does not allocate)
+ */
+void FeedForwardSchedule::interpolate(double time, Vector13d &ref, Vector6d &accel, Eigen::Ref<Eigen::VectorXd> thrust)
+{
+   double fraction;
+   int i = FeedForwardSchedule::getIndex(time, fraction);
+   int j = std::min(i + 1, numSamples_ - 1);
+
+   ref.noalias() = (1.0 - fraction) * refs_.col(i) + fraction * refs_.col(j);
+   accel.noalias() = (1.0 - fraction) * accels_.col(i) + fraction * accels_.col(j);
+   thrust.noalias() = (1.0 - fraction) * thrusts_.col(i) + fraction * thrusts_.col(j);
+
+   // q and -q are the same attitude, so interpolate toward the one closest to the first sample
+   if (refs_.col(i).segment<4>(auv_core::constants::STATE_Q0).dot(refs_.col(j).segment<4>(auv_core::constants::STATE_Q0)) < 0)
+      ref.segment<4>(auv_core::constants::STATE_Q0) -= 2.0 * fraction * refs_.col(j).segment<4>(auv_core::constants::STATE_Q0);
+   ref.segment<4>(auv_core::constants::STATE_Q0).normalize();
+}
+
+/**
+ * @param time Time since the first sample [s]
+ * @param K Interpolated LQR gain matrix (unchanged if the gains are not stored)
+ */
+void FeedForwardSchedule::interpolateGain(double time, Eigen::Ref<Eigen::MatrixXd> K)
+{
+   if (!FeedForwardSchedule::hasGains() || K.rows() != gainRows_ || K.cols() != gainCols_)
+      return;
+
+   double fraction;
+   int i = FeedForwardSchedule::getIndex(time, fraction);
+   int j = std::min(i + 1, numSamples_ - 1);
+   K.noalias() = (1.0 - fraction) * Eigen::Map<const Eigen::MatrixXd>(gains_.col(i).data(), gainRows_, gainCols_) +
+                 fraction * Eigen::Map<const Eigen::MatrixXd>(gains_.col(j).data(), gainRows_, gainCols_);
+}
+} // namespace auv_control
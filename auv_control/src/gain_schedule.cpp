@@ -0,0 +1,281 @@
+#include "auv_control/gain_schedule.hpp"
+
+namespace auv_control
+{
+// Binary file layout (native byte order):
+// "AUVG", version, gain rows, gain cols, number of scheduling variables,
+// for each scheduling variable: number of breakpoints, breakpoints (double),
+// Q (double, column-major), R (double, column-major),
+// gains (float, column-major, one gain matrix per grid point)
+const char GainSchedule::FILE_ID[4] = {'A', 'U', 'V', 'G'};
+
+GainSchedule::GainSchedule()
+{
+   gainRows_ = 0;
+   gainCols_ = 0;
+   breakpoints_.assign(GainSchedule::NUM_SCHED_VARS, std::vector<double>(1, 0.0));
+   GainSchedule::initGrid();
+}
+
+/**
+ * @param breakpoints Breakpoints of each scheduling variable (a missing or empty list is treated as a single breakpoint at zero)
+ * @param Q LQR state cost matrix
+ * @param R LQR input cost matrix
+ */
+GainSchedule::GainSchedule(const std::vector<std::vector<double> > &breakpoints,
+                           const Eigen::Ref<const Eigen::MatrixXd> &Q,
+                           const Eigen::Ref<const Eigen::MatrixXd> &R)
+{
+   Q_ = Q;
+   R_ = R;
+   gainRows_ = R.rows();
+   gainCols_ = Q.rows();
+
+   breakpoints_.clear();
+   for (int i = 0; i < GainSchedule::NUM_SCHED_VARS; i++)
+   {
+      std::vector<double> bp;
+      if (i < breakpoints.size())
+         bp = breakpoints[i];
+      if (bp.empty())
+         bp.push_back(0.0);
+
+      std::sort(bp.begin(), bp.end());
+      bp.erase(std::unique(bp.begin(), bp.end()), bp.end());
+      breakpoints_.push_back(bp);
+   }
+   GainSchedule::initGrid();
+}
+
+/**
+ * \brief Compute the grid strides and allocate the gain table and interpolation variables
+ */
+void GainSchedule::initGrid()
+{
+   strides_.assign(GainSchedule::NUM_SCHED_VARS, 1);
+   activeVars_.clear();
+   numPoints_ = 1;
+   for (int i = 0; i < GainSchedule::NUM_SCHED_VARS; i++)
+   {
+      strides_[i] = numPoints_;
+      numPoints_ *= breakpoints_[i].size();
+      if (breakpoints_[i].size() > 1)
+         activeVars_.push_back(i);
+   }
+
+   gains_.assign(numPoints_ * gainRows_ * gainCols_, 0.0f);
+   lowerIndex_.assign(GainSchedule::NUM_SCHED_VARS, 0);
+   fraction_.assign(GainSchedule::NUM_SCHED_VARS, 0.0);
+   interpGain_ = Eigen::VectorXd::Zero(gainRows_ * gainCols_);
+}
+
+/**
+ * @param ref Reference state
+ * \brief Returns the scheduling variables of the reference state: [roll, pitch, yaw, U, V, W, P, Q, R]
+ */
+Vector9d GainSchedule::getScheduleVariables(const Eigen::Ref<const Vector13d> &ref)
+{
+   Eigen::Quaterniond quat(ref(auv_core::constants::STATE_Q0), ref(auv_core::constants::STATE_Q1), ref(auv_core::constants::STATE_Q2), ref(auv_core::constants::STATE_Q3));
+
+   Vector9d vars;
+   vars.head<3>() = auv_core::rot3d::quat2RPY(quat);
+   vars.segment<3>(GainSchedule::SCHED_U) = ref.segment<3>(auv_core::constants::STATE_U);
+   vars.segment<3>(GainSchedule::SCHED_P) = ref.segment<3>(auv_core::constants::STATE_P);
+   return vars;
+}
+
+int GainSchedule::getNumPoints()
+{
+   return numPoints_;
+}
+
+std::vector<std::vector<double> > GainSchedule::getBreakpoints()
+{
+   return breakpoints_;
+}
+
+/**
+ * @param index Grid point index
+ * \brief Returns the reference state at the grid point (position is zero, it does not affect the gains)
+ */
+Vector13d GainSchedule::getReference(int index)
+{
+   Vector9d vars;
+   for (int i = 0; i < GainSchedule::NUM_SCHED_VARS; i++)
+      vars(i) = breakpoints_[i][(index / strides_[i]) % breakpoints_[i].size()];
+
+   Eigen::Quaterniond quat = auv_core::rot3d::rpy2Quat(vars(GainSchedule::SCHED_ROLL), vars(GainSchedule::SCHED_PITCH), vars(GainSchedule::SCHED_YAW));
+
+   Vector13d ref = Vector13d::Zero();
+   ref.segment<3>(auv_core::constants::STATE_U) = vars.segment<3>(GainSchedule::SCHED_U);
+   ref(auv_core::constants::STATE_Q0) = quat.w();
+   ref(auv_core::constants::STATE_Q1) = quat.x();
+   ref(auv_core::constants::STATE_Q2) = quat.y();
+   ref(auv_core::constants::STATE_Q3) = quat.z();
+   ref.segment<3>(auv_core::constants::STATE_P) = vars.segment<3>(GainSchedule::SCHED_P);
+   return ref;
+}
+
+/**
+ * @param index Grid point index
+ * \brief Returns the gain matrix stored at the grid point
+ */
+Eigen::MatrixXd GainSchedule::getGain(int index)
+{
+   return Eigen::Map<const Eigen::MatrixXf>(&gains_[index * gainRows_ * gainCols_], gainRows_, gainCols_).cast<double>();
+}
+
+/**
+ * @param index Grid point index
+ * @param K Gain matrix computed at the grid point's reference state
+ */
+void GainSchedule::setGain(int index, const Eigen::Ref<const Eigen::MatrixXd> &K)
+{
+   if (index < 0 || index >= numPoints_ || K.rows() != gainRows_ || K.cols() != gainCols_)
+      return;
+   Eigen::Map<Eigen::MatrixXf>(&gains_[index * gainRows_ * gainCols_], gainRows_, gainCols_) = K.cast<float>();
+}
+
+/**
+ * @param breakpoints Breakpoints of each scheduling variable
+ * @param Q LQR state cost matrix
+ * @param R LQR input cost matrix
+ * \brief Returns true if the schedule was computed over the same grid and with the same cost matrices
+ */
+bool GainSchedule::isCompatible(const std::vector<std::vector<double> > &breakpoints,
+                                const Eigen::Ref<const Eigen::MatrixXd> &Q,
+                                const Eigen::Ref<const Eigen::MatrixXd> &R)
+{
+   if (Q.rows() != gainCols_ || Q.cols() != gainCols_ || R.rows() != gainRows_ || R.cols() != gainRows_)
+      return false;
+   if (!Q_.isApprox(Q) || !R_.isApprox(R))
+      return false;
+
+   GainSchedule grid(breakpoints, Q, R);
+   return (grid.getBreakpoints() == breakpoints_);
+}
+
+/**
+ * @param ref Reference state
+ * @param K Interpolated gain matrix
+ * \brief Multi-linear interpolation of the gains at the reference state. Only the scheduled variables are interpolated,
+ * so the cost is 2^(number of scheduled variables) table lookups.
+ */
+void GainSchedule::interpolate(const Eigen::Ref<const Vector13d> &ref, Eigen::Ref<Eigen::MatrixXd> K)
+{
+   Vector9d vars = GainSchedule::getScheduleVariables(ref);
+   int numActive = activeVars_.size();
+   int gainSize = gainRows_ * gainCols_;
+
+   // Locate the grid cell containing the reference
+   for (int a = 0; a < numActive; a++)
+   {
+      const std::vector<double> &bp = breakpoints_[activeVars_[a]];
+      double x = std::min(std::max(vars(activeVars_[a]), bp.front()), bp.back());
+      int j = std::upper_bound(bp.begin(), bp.end() - 1, x) - bp.begin() - 1;
+      lowerIndex_[a] = j;
+      fraction_[a] = (x - bp[j]) / (bp[j + 1] - bp[j]);
+   }
+
+   // Weighted sum of the gains at the corners of the cell
+   interpGain_.setZero();
+   for (int corner = 0; corner < (1 << numActive); corner++)
+   {
+      double weight = 1.0;
+      int index = 0;
+      for (int a = 0; a < numActive; a++)
+      {
+         int bit = (corner >> a) & 1;
+         weight *= (bit ? fraction_[a] : 1.0 - fraction_[a]);
+         index += (lowerIndex_[a] + bit) * strides_[activeVars_[a]];
+      }
+
+      if (weight > 0)
+         interpGain_ += weight * Eigen::Map<const Eigen::VectorXf>(&gains_[index * gainSize], gainSize).cast<double>();
+   }
+
+   K = Eigen::Map<const Eigen::MatrixXd>(interpGain_.data(), gainRows_, gainCols_);
+}
+
+/**
+ * @param file Path to the gain schedule file
+ * \brief Write the gain schedule to a binary file. Returns true if successful.
+ */
+bool GainSchedule::save(const std::string &file)
+{
+   std::ofstream out(file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+   if (!out.is_open())
+      return false;
+
+   int32_t header[4] = {GainSchedule::FILE_VERSION, gainRows_, gainCols_, GainSchedule::NUM_SCHED_VARS};
+   out.write(GainSchedule::FILE_ID, sizeof(GainSchedule::FILE_ID));
+   out.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+   for (int i = 0; i < GainSchedule::NUM_SCHED_VARS; i++)
+   {
+      int32_t numBreakpoints = breakpoints_[i].size();
+      out.write(reinterpret_cast<const char *>(&numBreakpoints), sizeof(numBreakpoints));
+      out.write(reinterpret_cast<const char *>(&breakpoints_[i][0]), numBreakpoints * sizeof(double));
+   }
+
+   out.write(reinterpret_cast<const char *>(Q_.data()), Q_.size() * sizeof(double));
+   out.write(reinterpret_cast<const char *>(R_.data()), R_.size() * sizeof(double));
+   out.write(reinterpret_cast<const char *>(&gains_[0]), gains_.size() * sizeof(float));
+   return out.good();
+}
+
+/**
+ * @param file Path to the gain schedule file
+ * \brief Read the gain schedule from a binary file. Returns true if successful, otherwise the schedule is unchanged.
+ */
+bool GainSchedule::load(const std::string &file)
+{
+   std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+   if (!in.is_open())
+      return false;
+
+   char id[4];
+   int32_t header[4];
+   in.read(id, sizeof(id));
+   in.read(reinterpret_cast<char *>(header), sizeof(header));
+   if (!in.good() || !std::equal(id, id + 4, GainSchedule::FILE_ID) || header[0] != GainSchedule::FILE_VERSION ||
+       header[1] <= 0 || header[2] <= 0 || header[3] != GainSchedule::NUM_SCHED_VARS)
+      return false;
+   int gainRows = header[1], gainCols = header[2];
+
+   std::vector<std::vector<double> > breakpoints;
+   size_t numPoints = 1;
+   for (int i = 0; i < GainSchedule::NUM_SCHED_VARS; i++)
+   {
+      int32_t numBreakpoints = 0;
+      in.read(reinterpret_cast<char *>(&numBreakpoints), sizeof(numBreakpoints));
+      if (!in.good() || numBreakpoints <= 0 || numBreakpoints > 100000)
+         return false;
+
+      std::vector<double> bp(numBreakpoints);
+      in.read(reinterpret_cast<char *>(&bp[0]), numBreakpoints * sizeof(double));
+      for (int j = 1; j < numBreakpoints; j++)
+         if (!(bp[j] > bp[j - 1]))
+            return false;
+      breakpoints.push_back(bp);
+      numPoints *= numBreakpoints;
+   }
+
+   Eigen::MatrixXd Q(gainCols, gainCols), R(gainRows, gainRows);
+   std::vector<float> gains(numPoints * gainRows * gainCols);
+   in.read(reinterpret_cast<char *>(Q.data()), Q.size() * sizeof(double));
+   in.read(reinterpret_cast<char *>(R.data()), R.size() * sizeof(double));
+   in.read(reinterpret_cast<char *>(&gains[0]), gains.size() * sizeof(float));
+   if (!in.good())
+      return false;
+
+   Q_ = Q;
+   R_ = R;
+   gainRows_ = gainRows;
+   gainCols_ = gainCols;
+   breakpoints_ = breakpoints;
+   GainSchedule::initGrid();
+   gains_.swap(gains);
+   return true;
+}
+} // namespace auv_control
\ No newline at end of file
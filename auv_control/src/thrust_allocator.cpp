@@ -0,0 +1,75 @@
+#include "auv_control/thrust_allocator.hpp"
+
+namespace auv_control
+{
+/**
+ * @param thrustCoeffs Thrust coefficients (effective contributions of each thruster for force and moment)
+ * \brief All thrusters are weighted equally, so the allocation is the minimum norm solution
+ */
+template <int N>
+ThrustAllocator<N>::ThrustAllocator(const Eigen::Ref<const Matrix6xNd> &thrustCoeffs)
+{
+   thrustCoeffs_ = thrustCoeffs;
+   weights_.setOnes();
+   ThrustAllocator::setAllocationMatrix();
+}
+
+/**
+ * @param thrustCoeffs Thrust coefficients (effective contributions of each thruster for force and moment)
+ * @param weights Relative cost of using each thruster. A zero weight disables the thruster (it is allocated zero thrust),
+ * as for failed thrusters. Throws std::invalid_argument if a weight is negative or not finite.
+ */
+template <int N>
+ThrustAllocator<N>::ThrustAllocator(const Eigen::Ref<const Matrix6xNd> &thrustCoeffs, const Eigen::Ref<const VectorNd> &weights)
+{
+   if (!weights.allFinite() || weights.minCoeff() < 0)
+      throw std::invalid_argument("ThrustAllocator: thruster weights must be non-negative (zero disables the thruster)");
+
+   thrustCoeffs_ = thrustCoeffs;
+   weights_ = weights;
+   ThrustAllocator::setAllocationMatrix();
+}
+
+/**
+ * \brief Compute the weighted pseudo-inverse of the thrust coefficients.
+ * Solves: min f'*W*f subject to thrustCoeffs*f = load, where W = diag(weights).
+ * With S = W^(-1/2), the solution is f = S * pinv(thrustCoeffs * S) * load. Disabled (zero weight) thrusters get a zero
+ * column in thrustCoeffs * S and a zero row in S, so they are never allocated thrust.
+ */
+template <int N>
+void ThrustAllocator<N>::setAllocationMatrix()
+{
+   VectorNd scale = VectorNd::Zero();
+   for (int i = 0; i < N; i++)
+   {
+      if (weights_(i) > 0)
+         scale(i) = 1.0 / sqrt(weights_(i));
+   }
+
+   // Complete orthogonal decomposition handles disabled (zero) thruster columns and rank-deficient layouts
+   Matrix6xNd scaledCoeffs = thrustCoeffs_ * scale.asDiagonal();
+   Eigen::CompleteOrthogonalDecomposition<Matrix6xNd> cod(scaledCoeffs);
+   allocationMatrix_ = scale.asDiagonal() * cod.pseudoInverse();
+}
+
+template <int N>
+typename ThrustAllocator<N>::MatrixNx6d ThrustAllocator<N>::getAllocationMatrix()
+{
+   return allocationMatrix_;
+}
+
+/**
+ * @param load Desired forces and moments acting on the vehicle, expressed in the B-frame
+ * \brief Returns the thruster forces that produce the desired load
+ */
+template <int N>
+typename ThrustAllocator<N>::VectorNd ThrustAllocator<N>::allocate(const Eigen::Ref<const Vector6d> &load)
+{
+   return allocationMatrix_ * load;
+}
+
+// Thruster counts supported by AUVModel
+template class ThrustAllocator<6>;
+template class ThrustAllocator<8>;
+template class ThrustAllocator<10>;
+} // namespace auv_control
\ No newline at end of file
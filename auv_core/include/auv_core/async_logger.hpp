@@ -0,0 +1,157 @@
+#ifndef ASYNC_LOGGER
+#define ASYNC_LOGGER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Log a printf-style message without blocking, e.g. AUV_LOG(auv_core::AsyncLogger::LEVEL_INFO, "duration: %f", t)
+#define AUV_LOG(level, ...) auv_core::AsyncLogger::getInstance().log(level, __VA_ARGS__)
+
+// Same as AUV_LOG, but logs at most once per period [s] from this call site (e.g. for messages from the control loop)
+#define AUV_LOG_THROTTLE(period, level, ...)                            \
+   do                                                                   \
+   {                                                                    \
+      static auv_core::LogThrottle auvLogThrottle;                      \
+      if (auvLogThrottle.allow(period))                                 \
+         auv_core::AsyncLogger::getInstance().log(level, __VA_ARGS__); \
+   } while (0)
+
+namespace auv_core
+{
+// Log Throttle
+// Allows at most one message per period (one per AUV_LOG_THROTTLE call site). Lock-free, so it does not block the caller.
+class LogThrottle
+{
+private:
+   std::atomic<int64_t> last_; // [ns], steady clock
+
+public:
+   LogThrottle();
+   bool allow(double period);
+};
+
+// Async Logger
+// Logging for the control and guidance threads. log() copies the format string pointer and the (numeric) arguments into a
+// fixed-capacity, lock-free ring buffer and returns; a background thread formats the messages and writes them out
+// (DEBUG/INFO to stdout, WARN/ERROR to stderr). log() never blocks, allocates, or makes a system call: if the buffer is
+// full, the message is dropped (and counted).
+// Since formatting is deferred, the format string must be a string literal (or otherwise outlive the message), and the
+// arguments must be integers, floating-point numbers, or strings that also outlive the message (at most MAX_ARGS), e.g.
+// "%d", "%.3f", "%g", "%s".
+class AsyncLogger
+{
+public:
+   // Levels
+   static const int LEVEL_DEBUG = 0;
+   static const int LEVEL_INFO = 1;
+   static const int LEVEL_WARN = 2;
+   static const int LEVEL_ERROR = 3;
+
+   static const int CAPACITY = 256; // Number of messages in the ring buffer (power of two)
+   static const int MAX_ARGS = 8;
+
+private:
+   struct Arg
+   {
+      bool isInteger;
+      long long i;
+      double d;
+      const char *s; // Not NULL for strings
+   };
+
+   struct Record
+   {
+      std::atomic<uint64_t> sequence; // Slot state (see log() and drain())
+      int level;
+      double time; // [s], wall clock
+      const char *format;
+      int numArgs;
+      Arg args[MAX_ARGS];
+   };
+
+   Record buffer_[CAPACITY];
+   std::atomic<uint64_t> head_; // Next slot to write (producers)
+   std::atomic<uint64_t> tail_; // Next slot to read (only written by the logging thread)
+   std::atomic<uint64_t> dropped_;
+   std::atomic<int> level_;
+   std::atomic<bool> stop_;
+   std::thread *thread_;
+
+   AsyncLogger();
+   AsyncLogger(const AsyncLogger &) = delete;
+   AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+   template <typename T>
+   static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, Arg>::type makeArg(T value)
+   {
+      Arg arg = {true, (long long)value, 0.0, NULL};
+      return arg;
+   }
+
+   template <typename T>
+   static typename std::enable_if<std::is_floating_point<T>::value, Arg>::type makeArg(T value)
+   {
+      Arg arg = {false, 0, (double)value, NULL};
+      return arg;
+   }
+
+   static Arg makeArg(const char *value)
+   {
+      Arg arg = {false, 0, 0.0, (value != NULL) ? value : "(null)"};
+      return arg;
+   }
+
+   Record *acquire(int level, const char *format);
+   void commit(Record *record);
+   static void fillArgs(Arg *args) {}
+
+   template <typename T, typename... Args>
+   static void fillArgs(Arg *args, T value, Args... rest)
+   {
+      args[0] = AsyncLogger::makeArg(value);
+      AsyncLogger::fillArgs(args + 1, rest...);
+   }
+
+   static std::string format(const Record &record);
+   bool drain();
+   void run();
+
+public:
+   ~AsyncLogger();
+   static AsyncLogger &getInstance();
+
+   void setLevel(int level);
+   int getLevel();
+   uint64_t getDropped();
+   void flush();
+
+   /**
+    * @param level Level of the message (LEVEL_*)
+    * @param format printf-style format string (string literal)
+    * @param args Numeric or string arguments
+    * \brief Queue a message. Returns false if it was filtered out by the level or dropped because the buffer is full.
+    */
+   template <typename... Args>
+   bool log(int level, const char *format, Args... args)
+   {
+      static_assert(sizeof...(Args) <= MAX_ARGS, "AsyncLogger: too many arguments");
+      Record *record = AsyncLogger::acquire(level, format);
+      if (record == NULL)
+         return false;
+
+      record->numArgs = sizeof...(Args);
+      AsyncLogger::fillArgs(record->args, args...);
+      AsyncLogger::commit(record);
+      return true;
+   }
+};
+} // namespace auv_core
+
+#endif
\ No newline at end of file
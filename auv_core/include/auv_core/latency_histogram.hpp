@@ -0,0 +1,151 @@
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+
+#include "math.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace auv_core
+{
+// Latency Histogram
+// Fixed-size histogram of durations [us], with log-spaced buckets (SUB_BUCKETS per power of two, so each bucket is at most
+// 1/SUB_BUCKETS wide relative to its lower edge), from 1 us up to 2^MAX_EXPONENT us (~17 min). Durations below 1 us go in
+// the first bucket, durations above the range go in the last one.
+// Recording is lock-free and never allocates, so it is safe to call from the control loop. Another thread may read the
+// statistics while durations are being recorded (they may be off by the samples recorded during the read).
+class LatencyHistogram
+{
+public:
+   static const int SUB_BUCKETS = 8;
+   static const int MAX_EXPONENT = 30;
+   static const int NUM_BUCKETS = 1 + SUB_BUCKETS * MAX_EXPONENT;
+
+private:
+   std::atomic<uint32_t> buckets_[NUM_BUCKETS];
+   std::atomic<uint64_t> count_;
+   std::atomic<double> max_;
+
+   /**
+    * @param micros Duration [us]
+    * \brief Returns the index of the bucket containing the duration
+    */
+   static int getBucket(double micros)
+   {
+      if (!(micros >= 1.0))
+         return 0;
+
+      int exponent = 0;
+      double mantissa = frexp(micros, &exponent); // micros = mantissa * 2^exponent, mantissa in [0.5, 1)
+      int bucket = 1 + SUB_BUCKETS * (exponent - 1) + (int)(SUB_BUCKETS * (2.0 * mantissa - 1.0));
+      return (bucket < NUM_BUCKETS) ? bucket : NUM_BUCKETS - 1;
+   }
+
+   /**
+    * @param bucket Bucket index
+    * \brief Returns the upper edge of the bucket [us]
+    */
+   static double getBucketUpperEdge(int bucket)
+   {
+      if (bucket <= 0)
+         return 1.0;
+      int exponent = (bucket - 1) / SUB_BUCKETS;
+      int sub = (bucket - 1) % SUB_BUCKETS;
+      return ldexp(1.0 + (double)(sub + 1) / SUB_BUCKETS, exponent);
+   }
+
+public:
+   LatencyHistogram()
+   {
+      LatencyHistogram::reset();
+   }
+
+   /**
+    * \brief Clear all recorded durations
+    */
+   void reset()
+   {
+      for (int i = 0; i < NUM_BUCKETS; i++)
+         buckets_[i].store(0, std::memory_order_relaxed);
+      count_.store(0, std::memory_order_relaxed);
+      max_.store(0.0, std::memory_order_relaxed);
+   }
+
+   /**
+    * @param micros Duration [us]
+    */
+   void record(double micros)
+   {
+      buckets_[LatencyHistogram::getBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+      count_.fetch_add(1, std::memory_order_relaxed);
+
+      double max = max_.load(std::memory_order_relaxed);
+      while (micros > max && !max_.compare_exchange_weak(max, micros, std::memory_order_relaxed))
+      {
+      }
+   }
+
+   /**
+    * \brief Returns the number of recorded durations
+    */
+   uint64_t getCount() const
+   {
+      return count_.load(std::memory_order_relaxed);
+   }
+
+   /**
+    * \brief Returns the longest recorded duration [us]
+    */
+   double getMax() const
+   {
+      return max_.load(std::memory_order_relaxed);
+   }
+
+   /**
+    * @param percentile Percentile, in [0, 100]
+    * \brief Returns the duration [us] below which the given percentage of the recorded durations fall (the upper edge of
+    * the bucket containing it, so this overestimates by at most one bucket width). Returns zero if nothing was recorded.
+    */
+   double getPercentile(double percentile) const
+   {
+      uint64_t total = 0;
+      for (int i = 0; i < NUM_BUCKETS; i++)
+         total += buckets_[i].load(std::memory_order_relaxed);
+      if (total == 0)
+         return 0.0;
+
+      double rank = std::min(std::max(percentile, 0.0), 100.0) / 100.0 * total;
+      uint64_t cumulative = 0;
+      for (int i = 0; i < NUM_BUCKETS; i++)
+      {
+         cumulative += buckets_[i].load(std::memory_order_relaxed);
+         if (cumulative > 0 && cumulative >= rank)
+            return std::min(LatencyHistogram::getBucketUpperEdge(i), LatencyHistogram::getMax());
+      }
+      return LatencyHistogram::getMax();
+   }
+};
+
+// Scoped Timer
+// Records the time between its construction and destruction in a LatencyHistogram.
+class ScopedTimer
+{
+private:
+   LatencyHistogram &histogram_;
+   std::chrono::steady_clock::time_point start_;
+
+public:
+   explicit ScopedTimer(LatencyHistogram &histogram) : histogram_(histogram)
+   {
+      start_ = std::chrono::steady_clock::now();
+   }
+
+   ~ScopedTimer()
+   {
+      histogram_.record(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count());
+   }
+};
+} // namespace auv_core
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef PRIORITY_INHERITANCE_MUTEX
+#define PRIORITY_INHERITANCE_MUTEX
+
+#include <pthread.h>
+
+namespace auv_core
+{
+// Priority Inheritance Mutex
+// Mutex shared by a real-time (SCHED_FIFO) thread and normal threads. While a higher priority thread waits for it, the
+// owner runs at that priority (PTHREAD_PRIO_INHERIT), so a thread of intermediate priority can not preempt the owner and
+// delay the real-time thread indefinitely (priority inversion), as it could with std::mutex.
+// Lockable, so it works with std::lock_guard, std::unique_lock, and std::condition_variable_any.
+class PriorityInheritanceMutex
+{
+private:
+   pthread_mutex_t mutex_;
+
+   PriorityInheritanceMutex(const PriorityInheritanceMutex &) = delete;
+   PriorityInheritanceMutex &operator=(const PriorityInheritanceMutex &) = delete;
+
+public:
+   PriorityInheritanceMutex()
+   {
+      pthread_mutexattr_t attr;
+      pthread_mutexattr_init(&attr);
+      pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+      pthread_mutex_init(&mutex_, &attr);
+      pthread_mutexattr_destroy(&attr);
+   }
+
+   ~PriorityInheritanceMutex()
+   {
+      pthread_mutex_destroy(&mutex_);
+   }
+
+   void lock()
+   {
+      pthread_mutex_lock(&mutex_);
+   }
+
+   bool try_lock()
+   {
+      return (pthread_mutex_trylock(&mutex_) == 0);
+   }
+
+   void unlock()
+   {
+      pthread_mutex_unlock(&mutex_);
+   }
+};
+} // namespace auv_core
+
+#endif
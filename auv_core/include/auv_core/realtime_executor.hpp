@@ -0,0 +1,58 @@
+#ifndef REALTIME_EXECUTOR
+#define REALTIME_EXECUTOR
+
+#include "auv_core/latency_histogram.hpp"
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace auv_core
+{
+// Real-Time Executor
+// Runs a task periodically on a dedicated thread. Each period ends at an absolute deadline (clock_nanosleep on
+// CLOCK_MONOTONIC), so the period does not drift with the task's duration or with late wake-ups. The thread can be pinned
+// to a CPU and scheduled SCHED_FIFO. If that is not permitted (e.g. no CAP_SYS_NICE or RLIMIT_RTPRIO), it keeps running
+// under the default scheduler, and isRealTime()/isPinned() report it.
+// Jitter (how late the thread wakes up after each deadline) and execution time are recorded lock-free [us]. If the task
+// is still running at a deadline, the missed periods are counted as overruns and skipped (not run back to back).
+class RealTimeExecutor
+{
+private:
+   int64_t period_; // [ns]
+   int cpu_, priority_;
+   std::function<void()> task_;
+   std::thread *thread_;
+   std::atomic<bool> stop_, realTime_, pinned_;
+   std::atomic<uint64_t> cycles_, overruns_;
+   LatencyHistogram jitter_, executionTime_;
+
+   RealTimeExecutor(const RealTimeExecutor &) = delete;
+   RealTimeExecutor &operator=(const RealTimeExecutor &) = delete;
+
+   static int64_t now();
+   void configureThread();
+   void run(std::promise<void> configured);
+
+public:
+   RealTimeExecutor(double period, int cpu = -1, int priority = 0);
+   ~RealTimeExecutor();
+
+   bool start(const std::function<void()> &task);
+   void stop();
+   bool isRunning();
+   bool isRealTime();
+   bool isPinned();
+   double getPeriod();
+
+   uint64_t getCycles();
+   uint64_t getOverruns();
+   uint64_t takeOverruns();
+   const LatencyHistogram &getJitter();
+   const LatencyHistogram &getExecutionTime();
+   void resetStatistics();
+};
+} // namespace auv_core
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TRIPLE_BUFFER
+#define TRIPLE_BUFFER
+
+#include "eigen3/Eigen/Core"
+#include <atomic>
+
+namespace auv_core
+{
+// Triple Buffer
+// Lock-free (wait-free) hand-off of the latest value from ONE writer thread to ONE reader thread.
+// The writer fills its back buffer and publishes it by swapping it with the middle buffer. The reader swaps the middle
+// buffer with its front buffer only if new data was published. Neither side ever blocks or waits for the other, and the
+// reader never sees a partially written value (unlike a two-slot double buffer, where the writer can lap the reader).
+// Intermediate values are dropped if the writer publishes faster than the reader reads.
+template <typename T>
+class TripleBuffer
+{
+private:
+   static const int INDEX_MASK = 3;
+   static const int NEW_DATA = 4; // Set in middle_ when the middle buffer holds data the reader has not seen
+
+   T buffers_[3];
+   std::atomic<int> middle_;
+   int back_;  // Only accessed by the writer
+   int front_; // Only accessed by the reader
+
+public:
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   TripleBuffer()
+   {
+      front_ = 0;
+      middle_.store(1);
+      back_ = 2;
+   }
+
+   /**
+    * @param value Initial value of all three buffers
+    * \brief Reset the buffer. NOT thread-safe, only call this while neither the reader nor the writer are active.
+    */
+   void reset(const T &value)
+   {
+      for (int i = 0; i < 3; i++)
+         buffers_[i] = value;
+      front_ = 0;
+      middle_.store(1);
+      back_ = 2;
+   }
+
+   // Writer
+
+   /**
+    * \brief Returns the buffer the writer may fill. Call publish() once it is complete.
+    */
+   T &getWriteBuffer()
+   {
+      return buffers_[back_];
+   }
+
+   /**
+    * \brief Make the write buffer available to the reader
+    */
+   void publish()
+   {
+      back_ = middle_.exchange(back_ | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+   }
+
+   /**
+    * @param value Value to publish
+    */
+   void write(const T &value)
+   {
+      buffers_[back_] = value;
+      TripleBuffer::publish();
+   }
+
+   // Reader
+
+   /**
+    * \brief Returns true if the writer published a value the reader has not seen yet
+    */
+   bool hasNewData()
+   {
+      return (middle_.load(std::memory_order_acquire) & NEW_DATA) != 0;
+   }
+
+   /**
+    * \brief Returns the most recently published value. The reference remains valid until the next call to read().
+    */
+   const T &read()
+   {
+      if (TripleBuffer::hasNewData())
+         front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+      return buffers_[front_];
+   }
+};
+} // namespace auv_core
+
+#endif
\ No newline at end of file
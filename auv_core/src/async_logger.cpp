@@ -0,0 +1,257 @@
+#include "auv_core/async_logger.hpp"
+
+namespace auv_core
+{
+LogThrottle::LogThrottle()
+{
+   last_.store(INT64_MIN);
+}
+
+/**
+ * @param period Minimum time between two messages [s]
+ * \brief Returns true if a message may be logged now (at most one caller is allowed per period)
+ */
+bool LogThrottle::allow(double period)
+{
+   int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+   int64_t last = last_.load(std::memory_order_relaxed);
+   if (last != INT64_MIN && now - last < (int64_t)(period * 1e9))
+      return false;
+   return last_.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+// The ring buffer is a bounded multi-producer queue (D. Vyukov): each slot holds a sequence number, equal to the position
+// of the slot's next write while it is free, and to that position + 1 once the message is committed. Producers claim a
+// position by incrementing head_, so they never wait on each other or on the logging thread.
+AsyncLogger::AsyncLogger()
+{
+   for (int i = 0; i < AsyncLogger::CAPACITY; i++)
+      buffer_[i].sequence.store(i, std::memory_order_relaxed);
+   head_.store(0);
+   tail_.store(0);
+   dropped_.store(0);
+   level_.store(AsyncLogger::LEVEL_INFO);
+   stop_.store(false);
+   thread_ = new std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+   stop_ = true;
+   thread_->join();
+   delete thread_;
+}
+
+/**
+ * \brief Returns the logger shared by all threads (its logging thread starts on first use)
+ */
+AsyncLogger &AsyncLogger::getInstance()
+{
+   static AsyncLogger logger;
+   return logger;
+}
+
+/**
+ * @param level Messages below this level are ignored (default: LEVEL_INFO)
+ */
+void AsyncLogger::setLevel(int level)
+{
+   level_.store(level, std::memory_order_relaxed);
+}
+
+int AsyncLogger::getLevel()
+{
+   return level_.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the number of messages dropped because the buffer was full
+ */
+uint64_t AsyncLogger::getDropped()
+{
+   return dropped_.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Block until all messages queued before this call have been written (not for use in the control loop)
+ */
+void AsyncLogger::flush()
+{
+   uint64_t head = head_.load(std::memory_order_acquire);
+   while (tail_.load(std::memory_order_acquire) < head)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/**
+ * @param level Level of the message
+ * @param format Format string
+ * \brief Claim a slot in the ring buffer. Returns NULL if the message is filtered out or the buffer is full.
+ */
+AsyncLogger::Record *AsyncLogger::acquire(int level, const char *format)
+{
+   if (level < level_.load(std::memory_order_relaxed) || format == NULL)
+      return NULL;
+
+   uint64_t pos = head_.load(std::memory_order_relaxed);
+   Record *record;
+   while (true)
+   {
+      record = &buffer_[pos & (AsyncLogger::CAPACITY - 1)];
+      int64_t diff = (int64_t)(record->sequence.load(std::memory_order_acquire) - pos);
+      if (diff == 0)
+      {
+         if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+      }
+      else if (diff < 0) // Slot not read yet, the buffer is full
+      {
+         dropped_.fetch_add(1, std::memory_order_relaxed);
+         return NULL;
+      }
+      else
+         pos = head_.load(std::memory_order_relaxed);
+   }
+
+   record->level = level;
+   record->time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+   record->format = format;
+   return record;
+}
+
+/**
+ * @param record Slot returned by acquire(), fully written
+ * \brief Hand the message to the logging thread
+ */
+void AsyncLogger::commit(Record *record)
+{
+   uint64_t pos = record->sequence.load(std::memory_order_relaxed);
+   record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+/**
+ * @param record Message
+ * \brief Format the message: each conversion in the format string is printed with the next argument (integers are
+ * converted for floating-point conversions and vice versa, strings are only printed by %s). Length modifiers are ignored.
+ */
+std::string AsyncLogger::format(const Record &record)
+{
+   std::string out;
+   char spec[32], text[64];
+   int argIndex = 0;
+
+   for (const char *c = record.format; *c != '\0'; c++)
+   {
+      if (*c != '%')
+      {
+         out += *c;
+         continue;
+      }
+      if (*(c + 1) == '%')
+      {
+         out += '%';
+         c++;
+         continue;
+      }
+
+      // Flags, width, and precision are kept, length modifiers are dropped
+      int len = 0;
+      spec[len++] = '%';
+      const char *s = c + 1;
+      for (; *s != '\0' && strchr("-+ #0123456789.", *s) != NULL && len < 24; s++)
+         spec[len++] = *s;
+      while (*s != '\0' && strchr("hlLqjzt", *s) != NULL)
+         s++;
+      if (*s == '\0')
+         break;
+
+      char conversion = *s;
+      c = s;
+      if (argIndex >= record.numArgs || strchr("diouxXcfFeEgGaAs", conversion) == NULL ||
+          (conversion == 's') != (record.args[argIndex].s != NULL))
+      {
+         out += "<?>";
+         argIndex++;
+         continue;
+      }
+
+      const Arg &arg = record.args[argIndex++];
+      if (conversion == 's')
+      {
+         spec[len++] = 's';
+         spec[len] = '\0';
+         int size = snprintf(NULL, 0, spec, arg.s);
+         std::string text(std::max(size, 0) + 1, '\0');
+         snprintf(&text[0], text.size(), spec, arg.s);
+         text.resize(std::max(size, 0));
+         out += text;
+         continue;
+      }
+      if (strchr("diouxXc", conversion) != NULL)
+      {
+         spec[len++] = 'l';
+         spec[len++] = 'l';
+         spec[len++] = (conversion == 'c') ? 'd' : conversion;
+         spec[len] = '\0';
+         snprintf(text, sizeof(text), spec, arg.isInteger ? arg.i : (long long)arg.d);
+      }
+      else
+      {
+         spec[len++] = conversion;
+         spec[len] = '\0';
+         snprintf(text, sizeof(text), spec, arg.isInteger ? (double)arg.i : arg.d);
+      }
+      out += text;
+   }
+   return out;
+}
+
+/**
+ * \brief Write out all committed messages. Returns true if any were written.
+ */
+bool AsyncLogger::drain()
+{
+   static const char *levelNames[] = {"DEBUG", " INFO", " WARN", "ERROR"};
+   bool written = false;
+   char prefix[64];
+
+   while (true)
+   {
+      uint64_t pos = tail_.load(std::memory_order_relaxed);
+      Record &record = buffer_[pos & (AsyncLogger::CAPACITY - 1)];
+      if (record.sequence.load(std::memory_order_acquire) != pos + 1)
+         break;
+
+      int level = std::min(std::max(record.level, (int)AsyncLogger::LEVEL_DEBUG), (int)AsyncLogger::LEVEL_ERROR);
+      snprintf(prefix, sizeof(prefix), "[%s] [%.6f]: ", levelNames[level], record.time);
+      std::string line = prefix + AsyncLogger::format(record) + "\n";
+
+      // Release the slot before writing, so producers are not held up by the output
+      record.sequence.store(pos + AsyncLogger::CAPACITY, std::memory_order_release);
+      tail_.store(pos + 1, std::memory_order_release);
+
+      FILE *stream = (level >= AsyncLogger::LEVEL_WARN) ? stderr : stdout;
+      fwrite(line.data(), 1, line.size(), stream);
+      written = true;
+   }
+
+   if (written)
+   {
+      fflush(stdout);
+      fflush(stderr);
+   }
+   return written;
+}
+
+/**
+ * \brief Logging thread: write out messages until stopped, then write out any remaining ones
+ */
+void AsyncLogger::run()
+{
+   while (!stop_)
+   {
+      if (!AsyncLogger::drain())
+         std::this_thread::sleep_for(std::chrono::milliseconds(5));
+   }
+   AsyncLogger::drain();
+}
+} // namespace auv_core
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "auv_core/realtime_executor.hpp"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <algorithm>
+#include <utility>
+
+namespace auv_core
+{
+/**
+ * @param period Task period [s]
+ * @param cpu CPU to pin the thread to (negative: not pinned)
+ * @param priority SCHED_FIFO priority, clamped to the range allowed by the system (zero: default scheduler)
+ */
+RealTimeExecutor::RealTimeExecutor(double period, int cpu, int priority)
+{
+   period_ = std::max((int64_t)(fabs(period) * 1e9), (int64_t)1000);
+   cpu_ = cpu;
+   priority_ = std::max(0, priority);
+   thread_ = NULL;
+   stop_ = false;
+   realTime_ = false;
+   pinned_ = false;
+   cycles_ = 0;
+   overruns_ = 0;
+}
+
+RealTimeExecutor::~RealTimeExecutor()
+{
+   RealTimeExecutor::stop();
+}
+
+/**
+ * \brief Returns the monotonic clock [ns]
+ */
+int64_t RealTimeExecutor::now()
+{
+   struct timespec time;
+   clock_gettime(CLOCK_MONOTONIC, &time);
+   return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/**
+ * \brief Pin the calling (executor) thread to its CPU and switch it to SCHED_FIFO, if requested. Failures (e.g. EPERM
+ * without real-time privileges, EINVAL for a CPU that does not exist) leave the thread as it was.
+ */
+void RealTimeExecutor::configureThread()
+{
+   pthread_t handle = pthread_self();
+
+   if (cpu_ >= 0 && cpu_ < CPU_SETSIZE)
+   {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu_, &cpus);
+      pinned_ = (pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpus) == 0);
+   }
+
+   if (priority_ > 0)
+   {
+      struct sched_param param;
+      param.sched_priority = std::min(std::max(priority_, sched_get_priority_min(SCHED_FIFO)), sched_get_priority_max(SCHED_FIFO));
+      realTime_ = (pthread_setschedparam(handle, SCHED_FIFO, &param) == 0);
+   }
+}
+
+/**
+ * @param task Function to run every period, on the executor's thread
+ * \brief Start the thread (the first run is one period from now). Returns false if it is already running. The thread
+ * applies its scheduling before its first period, and this returns once it has, so isRealTime() and isPinned() report
+ * the scheduling every run of the task gets.
+ */
+bool RealTimeExecutor::start(const std::function<void()> &task)
+{
+   if (thread_ != NULL || !task)
+      return false;
+
+   task_ = task;
+   stop_ = false;
+   realTime_ = false;
+   pinned_ = false;
+   std::promise<void> configured;
+   std::future<void> ready = configured.get_future();
+   thread_ = new std::thread(&RealTimeExecutor::run, this, std::move(configured));
+   ready.wait();
+   return true;
+}
+
+/**
+ * \brief Stop the thread (waits for the current run of the task to finish, and at most one period)
+ */
+void RealTimeExecutor::stop()
+{
+   if (thread_ == NULL)
+      return;
+
+   stop_ = true;
+   thread_->join();
+   delete thread_;
+   thread_ = NULL;
+}
+
+bool RealTimeExecutor::isRunning()
+{
+   return (thread_ != NULL);
+}
+
+/**
+ * \brief Returns true if the thread is scheduled SCHED_FIFO
+ */
+bool RealTimeExecutor::isRealTime()
+{
+   return realTime_;
+}
+
+/**
+ * \brief Returns true if the thread is pinned to its CPU
+ */
+bool RealTimeExecutor::isPinned()
+{
+   return pinned_;
+}
+
+/**
+ * \brief Returns the task period [s]
+ */
+double RealTimeExecutor::getPeriod()
+{
+   return period_ * 1e-9;
+}
+
+/**
+ * \brief Returns the number of times the task has run
+ */
+uint64_t RealTimeExecutor::getCycles()
+{
+   return cycles_.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the number of periods skipped because the task was still running at their deadline
+ */
+uint64_t RealTimeExecutor::getOverruns()
+{
+   return overruns_.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the number of overruns since the last call, and clears them
+ */
+uint64_t RealTimeExecutor::takeOverruns()
+{
+   return overruns_.exchange(0);
+}
+
+/**
+ * \brief Returns how late the thread woke up after each deadline [us]
+ */
+const LatencyHistogram &RealTimeExecutor::getJitter()
+{
+   return jitter_;
+}
+
+/**
+ * \brief Returns the duration of each run of the task [us]
+ */
+const LatencyHistogram &RealTimeExecutor::getExecutionTime()
+{
+   return executionTime_;
+}
+
+/**
+ * \brief Clear the jitter and execution time histograms, and the overrun count
+ */
+void RealTimeExecutor::resetStatistics()
+{
+   jitter_.reset();
+   executionTime_.reset();
+   overruns_ = 0;
+}
+
+/**
+ * @param configured Set once the thread is configured, before the first period starts
+ */
+void RealTimeExecutor::run(std::promise<void> configured)
+{
+   RealTimeExecutor::configureThread();
+   configured.set_value();
+
+   int64_t deadline = RealTimeExecutor::now();
+   while (!stop_)
+   {
+      deadline += period_;
+      struct timespec wakeup;
+      wakeup.tv_sec = deadline / 1000000000;
+      wakeup.tv_nsec = deadline % 1000000000;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+      {
+      }
+      if (stop_)
+         break;
+
+      int64_t start = RealTimeExecutor::now();
+      jitter_.record((start - deadline) * 1e-3);
+      task_();
+      cycles_++;
+      int64_t end = RealTimeExecutor::now();
+      executionTime_.record((end - start) * 1e-3);
+
+      // Skip the deadlines that have already passed, keeping the phase
+      if (end - deadline >= period_)
+      {
+         int64_t missed = (end - deadline) / period_;
+         overruns_ += missed;
+         deadline += missed * period_;
+      }
+   }
+}
+} // namespace auv_core
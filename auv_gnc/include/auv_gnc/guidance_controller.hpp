@@ -2,13 +2,24 @@
 #define GUIDANCE_CONTROLLER
 
 #include "auv_control/auv_model.hpp"
+#include "auv_core/async_logger.hpp"
 #include "auv_core/constants.hpp"
 #include "auv_core/eigen_ros.hpp"
+#include "auv_core/latency_histogram.hpp"
+#include "auv_core/priority_inheritance_mutex.hpp"
+#include "auv_core/realtime_executor.hpp"
+#include "auv_core/triple_buffer.hpp"
 #include "auv_guidance/basic_trajectory.hpp"
+#include "auv_guidance/compiled_trajectory.hpp"
+#include "auv_guidance/min_jerk_time_cache.hpp"
 #include "auv_guidance/tgen_limits.hpp"
+#include "auv_guidance/trajectory_arena.hpp"
 #include "auv_guidance/waypoint.hpp"
+#include "auv_msgs/LQRWeights.h"
 #include "auv_msgs/SixDoF.h"
+#include "auv_msgs/StageLatency.h"
 #include "auv_msgs/Thrust.h"
+#include "auv_msgs/ThrusterHealth.h"
 #include "auv_msgs/Trajectory.h"
 #include "auv_msgs/TrajectoryGeneratorAction.h"
 
@@ -17,7 +28,12 @@
 
 #include <yaml-cpp/yaml.h>
 #include <algorithm>
+#include <atomic>
 #include <boost/thread.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "math.h"
 
@@ -33,31 +49,127 @@ private:
   std::vector<std::string> activeThrusterNames_, inactiveThrusterNames_;
   std::string auvConfigFile_;
   YAML::Node auvConfig_;
-  auv_control::AUVModel *auvModel_;
+  auv_control::AbstractAUVModel *auvModel_;
+  auv_control::AbstractAUVModel *feedForwardModel_; // Only used by the trajectory thread (NULL if feed-forward is disabled)
 
   // LQR Parameters
-  std::vector<double> Qdiag_, QdiagIntegral_, Rdiag_;
-  bool enableLQRIntegral_;
+  std::vector<double> Qdiag_, QdiagIntegral_, Rdiag_; // Updated when new weights are accepted on lqrTuningTopic_
+  std::string lqrTuningTopic_;
+  bool enableLQRIntegral_, enableGainThread_;
+  std::string lqrSolver_;
+  double controlRate_;
+  std::string nominalThrustSolver_;
+  bool checkNominalThrust_;
+  double nominalThrustTolerance_;
+  bool enableGainSchedule_;
+  std::string gainScheduleFile_;
+  std::vector<std::vector<double> > gainScheduleBreakpoints_;
+  bool enableThrustSaturation_;
+  int thrustSaturationIterations_;
+
+  // MPC Parameters (the reference is sampled over the horizon every tick, columns are steps)
+  bool enableMPC_;
+  int mpcHorizon_, mpcIterations_;
+  double mpcTimeStep_;
+  Eigen::MatrixXd mpcRefs_, mpcAccels_;
+
+  // Feed-Forward Schedule
+  // If enabled, each new trajectory is sampled at the control period and its nominal thrust (optionally its LQR gains) is
+  // computed once by feedForwardModel_ on the trajectory thread, so each tick only interpolates. Not used with MPC or
+  // cascaded control.
+  bool enableFeedForward_, feedForwardGains_, feedForwardReady_;
+
+  // Cascaded Control
+  // The outer (translational) loop runs in runController at control_rate, the inner (attitude) loop runs on its own
+  // thread at innerRate_ and publishes the thrust. The inner loop gets the latest state from sixDofCB through a
+  // lock-free snapshot, and the outer loop command through the AUV model. Each loop counts its missed deadlines.
+  bool enableCascaded_;
+  double innerRate_;
+  std::thread *innerLoopThread_;
+  std::atomic<bool> stopInnerLoop_, innerLoopActive_;
+  auv_core::TripleBuffer<auv_guidance::Vector13d> stateBuffer_; // sixDofCB -> inner loop
+  auv_msgs::Thrust innerThrustMsg_;                             // Only used by the inner loop
+  auv_core::LatencyHistogram innerLoopLatency_, outerLoopLatency_;
+  std::atomic<unsigned long> innerLoopOverruns_, outerLoopOverruns_;
+
+  // Latency Compensation
+  // The state is already old when the control is computed, and the thrust is applied even later. If enabled, the state
+  // is predicted (AUV model, previously commanded thrust) from its stamp to the expected actuation time, now plus the
+  // actuation delay, before computing the control. The horizon is capped, and it is reported as a latency stage.
+  // Not used with cascaded control.
+  bool enableLatencyCompensation_;
+  double actuationDelay_, maxPredictionHorizon_; // [s]
+  ros::Time stateStamp_;
+  auv_guidance::Vector13d predictedState_;
+  auv_core::LatencyHistogram predictionLatency_, compensatedLatency_;
+
+  // Executor
+  // If enabled, runController runs on a dedicated (optionally pinned, SCHED_FIFO) thread at control_rate, and spin()
+  // processes the ROS callbacks on the calling thread. controllerMutex_ serializes the callbacks and the trajectory
+  // thread with runController. They only copy their inputs or swap in a new trajectory while holding it, and it inherits
+  // the control thread's priority, so the control thread waits at most that long.
+  bool enableExecutor_;
+  int executorCPU_, executorPriority_;
+  auv_core::RealTimeExecutor *executor_;
+  auv_core::PriorityInheritanceMutex controllerMutex_;
+
+  // Trajectory Thread
+  // Each new goal is planned and compiled (Ceres, arena allocation, feed-forward schedule) on the trajectory thread, never
+  // on the control thread. The plan is built in the slot runController is not using and swapped in once ready, so the
+  // control loop keeps following the previous trajectory meanwhile. The AUV model is not thread-safe, so the feed-forward
+  // schedule is built with feedForwardModel_ and swapped into auvModel_ with the plan. goalId_ counts the accepted goals
+  // and activeGoalId_ is the goal of the active plan: only the latest goal's trajectory completes the action.
+  struct TrajectoryPlan
+  {
+    auv_guidance::TrajectoryArena arena; // Owns the trajectory, its waypoints and segments
+    auv_guidance::BasicTrajectory *basicTrajectory;
+    auv_guidance::CompiledTrajectory compiledTrajectory; // Flattened basicTrajectory
+    auv_guidance::Trajectory *trajectory; // Evaluated trajectory: compiledTrajectory, or basicTrajectory if it does not compile
+    double duration;
+    int type;
+  };
+  TrajectoryPlan plans_[2];
+  int activePlan_;
+  std::thread *trajectoryThread_;
+  std::condition_variable_any trajectoryCondition_;
+  bool stopTrajectoryThread_;
+  unsigned long goalId_, activeGoalId_;
 
   // Trajectory Generator Parameters
   auv_msgs::Trajectory desiredTrajectory_;
   auv_guidance::TGenLimits *tgenLimits_;
-  auv_guidance::Waypoint *startWaypoint_, *endWaypoint_;
-  auv_guidance::BasicTrajectory *basicTrajectory_;
+  auv_guidance::Trajectory *trajectory_; // Trajectory of the active plan
   auv_guidance::Vector13d state_;
   auv_guidance::Vector13d ref_;
   auv_guidance::Vector6d accel_;
   Eigen::Vector3d linearAccel_;
   Eigen::Quaterniond quaternion_;
   int tgenType_;
-  bool tgenInit_, newTrajectory_;
+  bool tgenInit_;
   ros::Time startTime_;
-  auv_control::Vector8d thrust_;
+  auv_control::AbstractAUVModel::ThrustVector thrust_;
 
   // ROS Parameters
   ros::NodeHandle nh_;
-  ros::Subscriber sixDofSub_;
+  ros::Subscriber sixDofSub_, thrusterHealthSub_, lqrTuningSub_;
   ros::Publisher thrustPub_;
+  auv_msgs::Thrust thrustMsg_; // Names and size are set once, only the thrusts and stamp change every tick
+
+  // Thruster Health
+  // Health updates are applied by the control loop once the AUV model has the configuration (bit i: active thruster i)
+  std::string thrusterHealthTopic_;
+  unsigned int thrusterHealth_;
+  bool newThrusterHealth_;
+
+  // Latency Diagnostics
+  // Trajectory evaluation and publishing are timed here, the LQR stages are timed by the AUV model.
+  // Every period, the statistics are published and the histograms are cleared.
+  auv_core::LatencyHistogram trajectoryLatency_, publishLatency_;
+  ros::Publisher latencyPub_;
+  std::string latencyTopic_;
+  double latencyPeriod_; // [s], disabled if <= 0
+  ros::Time lastLatencyTime_;
+  auv_msgs::StageLatency latencyMsg_;
   std::string subTopic_, pubTopic_, actionName_;
   double trajectoryDuration_;
   bool resultMessageSent_;
@@ -68,19 +180,36 @@ private:
 
   // Private Methods
   void initAUVModel();
+  void configureAUVModel(auv_control::AbstractAUVModel *model, const Eigen::VectorXd &minThrust,
+                         const Eigen::VectorXd &maxThrust, bool thrustLimitsFound);
+  void buildLQRCostMatrices(const std::vector<double> &Qdiag, const std::vector<double> &QdiagIntegral,
+                            const std::vector<double> &Rdiag, Eigen::MatrixXd &Q, Eigen::MatrixXd &R);
+  void lqrWeightsCB(const auv_msgs::LQRWeights::ConstPtr &weights);
   void sixDofCB(const auv_msgs::SixDoF::ConstPtr &state);
+  void thrusterHealthCB(const auv_msgs::ThrusterHealth::ConstPtr &health);
+  void updateThrusterHealth();
   void tgenActionGoalCB();
   void tgenActionPreemptCB();
   bool isActionServerActive();
   bool isTrajectoryTypeValid(int type);
-  void initNewTrajectory();
+  void runTrajectoryThread();
+  void planTrajectory(TrajectoryPlan &plan, const auv_msgs::Trajectory &goal, const auv_guidance::Vector13d &state,
+                      const Eigen::Quaterniond &quaternion, const Eigen::Vector3d &linearAccel);
+  void sampleTrajectory(TrajectoryPlan &plan, Eigen::MatrixXd &refs, Eigen::MatrixXd &accels);
+  auv_control::FeedForwardSchedule *compileFeedForward(const Eigen::MatrixXd &refs, const Eigen::MatrixXd &accels,
+                                                       unsigned int thrusterHealth);
+  void compensateLatency();
   void publishThrustMessage();
+  void publishLatencyMessage();
+  void runInnerLoop();
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   GuidanceController(ros::NodeHandle nh);
+  ~GuidanceController();
   void runController();
+  void spin();
 };
 }  // namespace auv_gnc
 
@@ -15,14 +15,95 @@ GuidanceController::GuidanceController(ros::NodeHandle nh)
     }
     auvConfig_ = YAML::LoadFile(auvConfigFile_);
 
+    // Trajectory generator and controller messages (auv_core::AsyncLogger): debug, info, warn, or error
+    std::string logLevel;
+    nh_.param("log_level", logLevel, std::string("info"));
+    if (logLevel == "debug")
+        auv_core::AsyncLogger::getInstance().setLevel(auv_core::AsyncLogger::LEVEL_DEBUG);
+    else if (logLevel == "warn")
+        auv_core::AsyncLogger::getInstance().setLevel(auv_core::AsyncLogger::LEVEL_WARN);
+    else if (logLevel == "error")
+        auv_core::AsyncLogger::getInstance().setLevel(auv_core::AsyncLogger::LEVEL_ERROR);
+    else
+        auv_core::AsyncLogger::getInstance().setLevel(auv_core::AsyncLogger::LEVEL_INFO);
+
     // LQR Variables
     nh_.param("Q_diag", Qdiag_, std::vector<double>(0));
     nh_.param("Q_diag_integral", QdiagIntegral_, std::vector<double>(0));
     nh_.param("R_diag", Rdiag_, std::vector<double>(0));
     nh_.param("enable_LQR_integral", enableLQRIntegral_, false);
+    nh_.param("enable_gain_thread", enableGainThread_, false);
+    nh_.param("lqr_solver", lqrSolver_, std::string("schur"));
+    nh_.param("lqr_tuning_topic", lqrTuningTopic_, std::string("/auv_gnc/controller/lqr_tuning"));
+    nh_.param("control_rate", controlRate_, 50.0);
+    if (controlRate_ <= 0)
+        controlRate_ = 50.0;
+    nh_.param("nominal_thrust/solver", nominalThrustSolver_, std::string("pinv"));
+    nh_.param("nominal_thrust/check", checkNominalThrust_, false);
+    nh_.param("nominal_thrust/tolerance", nominalThrustTolerance_, 0.01);
+
+    // LQR Gain Schedule (order must match the auv_control::GainSchedule scheduling variables)
+    std::string scheduleVars[] = {"roll", "pitch", "yaw", "u", "v", "w", "p", "q", "r"};
+    nh_.param("gain_schedule/enable", enableGainSchedule_, false);
+    nh_.param("gain_schedule/file", gainScheduleFile_, std::string(""));
+    gainScheduleBreakpoints_.clear();
+    for (int i = 0; i < auv_control::GainSchedule::NUM_SCHED_VARS; i++)
+    {
+        std::vector<double> breakpoints;
+        nh_.param("gain_schedule/" + scheduleVars[i], breakpoints, std::vector<double>(1, 0.0));
+        gainScheduleBreakpoints_.push_back(breakpoints);
+    }
+
+    // Thrust Saturation (limits are in the AUV model)
+    nh_.param("thrust_saturation/enable", enableThrustSaturation_, false);
+    nh_.param("thrust_saturation/max_iterations", thrustSaturationIterations_, 16);
+
+    // MPC (alternative to the LQR, uses the same cost matrices)
+    nh_.param("mpc/enable", enableMPC_, false);
+    nh_.param("mpc/horizon", mpcHorizon_, 30);
+    nh_.param("mpc/time_step", mpcTimeStep_, 0.02);
+    nh_.param("mpc/max_iterations", mpcIterations_, 50);
+
+    // Latency Compensation
+    nh_.param("latency_compensation/enable", enableLatencyCompensation_, false);
+    nh_.param("latency_compensation/actuation_delay", actuationDelay_, 0.01);
+    nh_.param("latency_compensation/max_horizon", maxPredictionHorizon_, 0.1);
+    actuationDelay_ = std::max(actuationDelay_, 0.0);
+    maxPredictionHorizon_ = std::max(maxPredictionHorizon_, 0.0);
 
+    // Feed-Forward Schedule (compiled for each new trajectory)
+    nh_.param("feed_forward/enable", enableFeedForward_, false);
+    nh_.param("feed_forward/gains", feedForwardGains_, false);
+    feedForwardReady_ = false;
+
+    // Executor (control loop thread)
+    nh_.param("executor/enable", enableExecutor_, false);
+    nh_.param("executor/cpu", executorCPU_, -1);
+    nh_.param("executor/priority", executorPriority_, 80);
+    executor_ = NULL;
+
+    // Cascaded Control (the outer loop runs at control_rate)
+    nh_.param("cascaded/enable", enableCascaded_, false);
+    nh_.param("cascaded/inner_rate", innerRate_, 250.0);
+    innerLoopThread_ = NULL;
+    stopInnerLoop_ = false;
+    innerLoopActive_ = false;
+    innerLoopOverruns_ = 0;
+    outerLoopOverruns_ = 0;
+
+    feedForwardModel_ = NULL;
     GuidanceController::initAUVModel();
 
+    // Thrust message (thruster names do not change)
+    thrustMsg_.names.clear();
+    for (int i = 0; i < activeThrusterNames_.size(); i++)
+        thrustMsg_.names.push_back(activeThrusterNames_[i]);
+
+    for (int i = 0; i < inactiveThrusterNames_.size(); i++)
+        thrustMsg_.names.push_back(inactiveThrusterNames_[i]);
+    thrustMsg_.thrusts.assign(thrustMsg_.names.size(), 0.0);
+    innerThrustMsg_ = thrustMsg_;
+
     // Trajectory Generator Limits
     double maxXYDistance, maxZDistance, maxPathInclination;
     double maxXVel, maxYVel, maxZVel, maxRotVel;
@@ -56,27 +137,84 @@ GuidanceController::GuidanceController(ros::NodeHandle nh)
                                                maxXVel, maxYVel, maxZVel, maxRotVel, maxXAccel, maxYAccel, maxZAccel, maxRotAccel,
                                                xyzJerk, xyzClosingJerk, rotJerk, rotClosingJerk);
 
+    // Min jerk duration cache (shared by all trajectories, see auv_guidance::MinJerkTimeCache)
+    int timeCacheCapacity;
+    double timeCacheResolution;
+    nh_.param("time_cache/capacity", timeCacheCapacity, 256);
+    nh_.param("time_cache/resolution", timeCacheResolution, 1e-6);
+    auv_guidance::MinJerkTimeCache::shared().setCapacity(std::max(0, timeCacheCapacity));
+    auv_guidance::MinJerkTimeCache::shared().setResolution(timeCacheResolution);
+
     // Pubs, Subs, and Action Servers
     nh_.param("subscriber_topic", subTopic_, std::string("/auv_gnc/trans_ekf/six_dof"));
     nh_.param("publisher_topic", pubTopic_, std::string("/auv_gnc/controller/thrust"));
     nh_.param("action_name", actionName_, std::string("/auv_gnc/controller/check_for_trajectory"));
+    nh_.param("thruster_health_topic", thrusterHealthTopic_, std::string("/auv_gnc/controller/thruster_health"));
+    nh_.param("latency/topic", latencyTopic_, std::string("/auv_gnc/controller/latency"));
+    nh_.param("latency/period", latencyPeriod_, 1.0);
 
     sixDofSub_ = nh_.subscribe<auv_msgs::SixDoF>(subTopic_, 1, &GuidanceController::sixDofCB, this);
+    thrusterHealthSub_ = nh_.subscribe<auv_msgs::ThrusterHealth>(thrusterHealthTopic_, 10, &GuidanceController::thrusterHealthCB, this);
+    lqrTuningSub_ = nh_.subscribe<auv_msgs::LQRWeights>(lqrTuningTopic_, 1, &GuidanceController::lqrWeightsCB, this);
     thrustPub_ = nh_.advertise<auv_msgs::Thrust>(pubTopic_, 1, this);
+    if (latencyPeriod_ > 0)
+        latencyPub_ = nh_.advertise<auv_msgs::StageLatency>(latencyTopic_, 1, this);
+
+    // Latency message (stage names do not change): trajectory, AUV model stages, publish
+    latencyMsg_.stages.clear();
+    latencyMsg_.stages.push_back("trajectory");
+    for (int i = 0; i < auv_control::AbstractAUVModel::NUM_STAGES; i++)
+        latencyMsg_.stages.push_back(std::string("lqr/") + auv_control::AbstractAUVModel::STAGE_NAMES[i]);
+    latencyMsg_.stages.push_back("publish");
+    if (enableCascaded_)
+    {
+        latencyMsg_.stages.push_back("cascaded/outer_loop");
+        latencyMsg_.stages.push_back("cascaded/inner_loop");
+    }
+    if (enableLatencyCompensation_)
+    {
+        latencyMsg_.stages.push_back("prediction");
+        latencyMsg_.stages.push_back("prediction/compensated"); // Prediction horizon
+    }
+    if (enableExecutor_)
+    {
+        latencyMsg_.stages.push_back("executor/jitter");
+        latencyMsg_.stages.push_back("executor/execution");
+    }
+    latencyMsg_.counts.assign(latencyMsg_.stages.size(), 0);
+    latencyMsg_.p50.assign(latencyMsg_.stages.size(), 0.0);
+    latencyMsg_.p99.assign(latencyMsg_.stages.size(), 0.0);
+    latencyMsg_.max.assign(latencyMsg_.stages.size(), 0.0);
+    lastLatencyTime_ = ros::Time::now();
 
     // Initialize variables
     state_.setZero();
+    predictedState_.setZero();
     ref_.setZero();
     accel_.setZero();
     linearAccel_.setZero();
-    thrust_.setZero();
+    thrust_.setZero(auvModel_->getMaxThrusters());
     quaternion_.setIdentity();
+    thrusterHealth_ = auvModel_->getThrusterHealth(); // All active thrusters are healthy
+    newThrusterHealth_ = false;
 
     tgenType_ = 0;
     tgenInit_ = false;
-    newTrajectory_ = false;
+    trajectory_ = NULL;
     resultMessageSent_ = false;
     trajectoryDuration_ = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        plans_[i].basicTrajectory = NULL;
+        plans_[i].trajectory = NULL;
+        plans_[i].duration = 0;
+        plans_[i].type = 0;
+    }
+    activePlan_ = 0;
+    goalId_ = 0;
+    activeGoalId_ = 0;
+    stopTrajectoryThread_ = false;
+    trajectoryThread_ = new std::thread(&GuidanceController::runTrajectoryThread, this);
 
     // Initialize action server
     tgenActionServer_.reset(new TGenActionServer(nh_, actionName_, false));
@@ -84,9 +222,49 @@ GuidanceController::GuidanceController(ros::NodeHandle nh)
     tgenActionServer_->registerPreemptCallback(boost::bind(&GuidanceController::tgenActionPreemptCB, this));
     tgenActionServer_->start();
 
+    // Inner loop thread (everything it uses is initialized)
+    if (enableCascaded_)
+    {
+        stateBuffer_.reset(state_);
+        innerLoopThread_ = new std::thread(&GuidanceController::runInnerLoop, this);
+    }
+
     ROS_INFO("Guidance Controller initialized");
 }
 
+GuidanceController::~GuidanceController()
+{
+    if (executor_ != NULL)
+    {
+        executor_->stop();
+        delete executor_;
+        executor_ = NULL;
+    }
+    if (innerLoopThread_ != NULL)
+    {
+        stopInnerLoop_ = true;
+        innerLoopThread_->join();
+        delete innerLoopThread_;
+        innerLoopThread_ = NULL;
+    }
+    if (trajectoryThread_ != NULL)
+    {
+        {
+            std::lock_guard<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
+            stopTrajectoryThread_ = true;
+        }
+        trajectoryCondition_.notify_one();
+        trajectoryThread_->join(); // Waits for the plan being built, if any
+        delete trajectoryThread_;
+        trajectoryThread_ = NULL;
+    }
+    if (feedForwardModel_ != NULL)
+    {
+        delete feedForwardModel_;
+        feedForwardModel_ = NULL;
+    }
+}
+
 /**
  * \brief Initialize AUV model from parameters
  */
@@ -143,15 +321,19 @@ void GuidanceController::initAUVModel()
     inactiveThrusterNames_.clear();
 
     int numThrusters = auvConfig_["thrusters"].size();
-    numThrusters = std::max(numThrusters, 8); // Cap thrusters at 8
     std::vector<bool> thrustersEnabled;
     thrustersEnabled.clear();
 
     for (int i = 0; i < numThrusters; i++)
     {
         bool enabled = auvConfig_["thrusters"][i]["enable"].as<bool>();
-        thrustersEnabled.push_back(enabled);
         std::string name = auvConfig_["thrusters"][i]["name"].as<std::string>();
+        if (enabled && numActiveThrusters_ >= auv_control::AbstractAUVModel::MAX_THRUSTERS) // Cap thrusters at the largest model
+        {
+            ROS_WARN("GuidanceController: Too many thrusters enabled, ignoring %s", name.c_str());
+            enabled = false;
+        }
+        thrustersEnabled.push_back(enabled);
         if (enabled)
         {
             numActiveThrusters_++;
@@ -162,8 +344,10 @@ void GuidanceController::initAUVModel()
     }
 
     // Each COLUMN contains a thruster's data (x, y, z, yaw, pitch)
-    auv_control::Matrix58d thrusterData;
-    thrusterData.setZero();
+    Eigen::MatrixXd thrusterData = Eigen::MatrixXd::Zero(5, numActiveThrusters_);
+    Eigen::VectorXd minThrust = Eigen::VectorXd::Zero(numActiveThrusters_);
+    Eigen::VectorXd maxThrust = Eigen::VectorXd::Zero(numActiveThrusters_);
+    bool thrustLimitsFound = true;
     int col = 0;
     for (int i = 0; i < numThrusters; i++)
     {
@@ -174,40 +358,185 @@ void GuidanceController::initAUVModel()
                     thrusterData(j, col) = auvConfig_["thrusters"][i]["pose"][j].as<double>() - CoM(j);
                 else
                     thrusterData(j, col) = auvConfig_["thrusters"][i]["pose"][j].as<double>();
+
+            // Thrust limits: [min, max] [N]
+            if (auvConfig_["thrusters"][i]["thrust_limits"])
+            {
+                minThrust(col) = auvConfig_["thrusters"][i]["thrust_limits"][0].as<double>();
+                maxThrust(col) = auvConfig_["thrusters"][i]["thrust_limits"][1].as<double>();
+            }
+            else
+                thrustLimitsFound = false;
             col++;
         }
     }
 
-    auvModel_ = new auv_control::AUVModel(Fg, Fb, CoB, inertia, dragCoeffs, thrusterData, numActiveThrusters_);
+    // Matrices are sized for the smallest supported thruster count that fits the enabled thrusters
+    auvModel_ = auv_control::AbstractAUVModel::create(Fg, Fb, CoB, inertia, dragCoeffs, thrusterData, numActiveThrusters_);
+    ROS_INFO("GuidanceController: %d thrusters enabled, using the %d-thruster AUV model", numActiveThrusters_, auvModel_->getMaxThrusters());
 
-    // LQR Cost Matrices
-    auv_control::Matrix12d Q;
-    auv_control::Matrix18d Qaug;
-    auv_control::Matrix8d R;
-    Q.setZero();
-    Qaug.setZero();
-    R.setZero();
+    GuidanceController::configureAUVModel(auvModel_, minThrust, maxThrust, thrustLimitsFound);
+    if (enableThrustSaturation_ && !thrustLimitsFound)
+        ROS_WARN("GuidanceController: Thrust saturation disabled, every enabled thruster needs thrust_limits in the AUV model.");
 
-    for (int i = 0; i < 12; i++)
+    // MPC (the LQR gains are not needed)
+    if (enableMPC_)
     {
-        if (i < 8)
-            R(i, i) = fabs(Rdiag_[i]);
-        Q(i, i) = fabs(Qdiag_[i]);
+        if (auvModel_->setMPCHorizon(mpcHorizon_, mpcTimeStep_, mpcIterations_))
+        {
+            mpcRefs_ = Eigen::MatrixXd::Zero(13, mpcHorizon_);
+            mpcAccels_ = Eigen::MatrixXd::Zero(6, mpcHorizon_);
+            ROS_INFO("GuidanceController: Using MPC, %d steps of %f s.", mpcHorizon_, mpcTimeStep_);
+            return;
+        }
+        ROS_WARN("GuidanceController: Invalid MPC horizon or time step, using LQR.");
+        enableMPC_ = false;
     }
 
-    if (!enableLQRIntegral_)
+    // Cascaded Control (the LQR gains are not needed)
+    if (enableCascaded_)
     {
-        auvModel_->setLQRCostMatrices(Q, R);
+        if (innerRate_ > 0 && auvModel_->setCascadedControl(1.0 / innerRate_, 1.0 / controlRate_))
+        {
+            ROS_INFO("GuidanceController: Using cascaded control, inner loop at %f Hz, outer loop at %f Hz.", innerRate_, controlRate_);
+            return;
+        }
+        ROS_WARN("GuidanceController: Unable to design the cascaded control gains, using LQR.");
+        enableCascaded_ = false;
     }
-    else
+
+    // LQR Gain Schedule (load from file if it matches the current config, otherwise build and save it)
+    if (enableGainSchedule_)
     {
-        Qaug.block<12, 12>(0, 0) = Q;
-        for (int i = 0; i < 6; i++)
+        if (!gainScheduleFile_.empty() && auvModel_->loadGainSchedule(gainScheduleFile_, gainScheduleBreakpoints_))
         {
-            Qaug(12 + i, 12 + i) = fabs(QdiagIntegral_[i]);
+            ROS_INFO("GuidanceController: Loaded LQR gain schedule from %s", gainScheduleFile_.c_str());
         }
-        auvModel_->setLQRIntegralCostMatrices(Qaug, R);
+        else
+        {
+            ROS_INFO("GuidanceController: Building LQR gain schedule.");
+            auvModel_->buildGainSchedule(gainScheduleBreakpoints_);
+            if (!gainScheduleFile_.empty() && !auvModel_->saveGainSchedule(gainScheduleFile_))
+                ROS_WARN("GuidanceController: Unable to save LQR gain schedule to %s", gainScheduleFile_.c_str());
+        }
+    }
+    else if (enableGainThread_)
+    {
+        // Solve for the LQR gains in the background, so the control loop never waits on the Riccati solver
+        auvModel_->startGainThread();
+    }
+
+    // Feed-forward schedules are built by the trajectory thread with its own copy of the AUV model (same parameters, no
+    // gain schedule or gain thread), then swapped into auvModel_, so the control loop never waits for them
+    if (enableFeedForward_)
+    {
+        feedForwardModel_ = auv_control::AbstractAUVModel::create(Fg, Fb, CoB, inertia, dragCoeffs, thrusterData, numActiveThrusters_);
+        GuidanceController::configureAUVModel(feedForwardModel_, minThrust, maxThrust, thrustLimitsFound);
+    }
+}
+
+/**
+ * @param model AUV model to configure
+ * @param minThrust Minimum thrust of each enabled thruster [N]
+ * @param maxThrust Maximum thrust of each enabled thruster [N]
+ * @param thrustLimitsFound True if every enabled thruster has thrust limits
+ * \brief Set the LQR cost matrices, thrust limits, and solvers from the ROS parameters
+ */
+void GuidanceController::configureAUVModel(auv_control::AbstractAUVModel *model, const Eigen::VectorXd &minThrust,
+                                           const Eigen::VectorXd &maxThrust, bool thrustLimitsFound)
+{
+    // LQR Cost Matrices
+    Eigen::MatrixXd Q, R;
+    GuidanceController::buildLQRCostMatrices(Qdiag_, QdiagIntegral_, Rdiag_, Q, R);
+    if (!enableLQRIntegral_)
+        model->setLQRCostMatrices(Q, R);
+    else
+        model->setLQRIntegralCostMatrices(Q, R);
+
+    // Thrust Saturation
+    if (enableThrustSaturation_ && thrustLimitsFound)
+        model->setThrustLimits(minThrust, maxThrust, thrustSaturationIterations_);
+
+    // Nominal Thrust Solver
+    if (nominalThrustSolver_ == std::string("ceres"))
+        model->setNominalThrustSolver(auv_control::AbstractAUVModel::NOMINAL_THRUST_CERES);
+    else
+        model->setNominalThrustSolver(auv_control::AbstractAUVModel::NOMINAL_THRUST_PINV);
+
+    // LQR Solver (the discrete-time gains are designed for the control period)
+    if (lqrSolver_ == std::string("kleinman"))
+        model->setLQRSolver(auv_control::AbstractAUVModel::LQR_SOLVER_KLEINMAN);
+    else if (lqrSolver_ == std::string("discrete"))
+        model->setLQRSolver(auv_control::AbstractAUVModel::LQR_SOLVER_DISCRETE);
+    else
+        model->setLQRSolver(auv_control::AbstractAUVModel::LQR_SOLVER_SCHUR);
+    model->setControlPeriod(1.0 / controlRate_);
+}
+
+/**
+ * @param Qdiag State cost diagonal (12 elements)
+ * @param QdiagIntegral Integral state cost diagonal (6 elements, only used if the LQR integral is enabled)
+ * @param Rdiag Input cost diagonal, ordered by enabled thruster
+ * @param Q State cost matrix, 12x12 (18x18 if the LQR integral is enabled)
+ * @param R Input cost matrix
+ */
+void GuidanceController::buildLQRCostMatrices(const std::vector<double> &Qdiag, const std::vector<double> &QdiagIntegral,
+                                              const std::vector<double> &Rdiag, Eigen::MatrixXd &Q, Eigen::MatrixXd &R)
+{
+    int numInputCosts = std::min(numActiveThrusters_, (int)Rdiag.size());
+    Q = Eigen::MatrixXd::Zero(enableLQRIntegral_ ? 18 : 12, enableLQRIntegral_ ? 18 : 12);
+    R = Eigen::MatrixXd::Zero(numInputCosts, numInputCosts);
+
+    for (int i = 0; i < 12; i++)
+        Q(i, i) = fabs(Qdiag[i]);
+    for (int i = 0; i < numInputCosts; i++)
+        R(i, i) = fabs(Rdiag[i]);
+    if (enableLQRIntegral_)
+    {
+        for (int i = 0; i < 6; i++)
+            Q(12 + i, 12 + i) = fabs(QdiagIntegral[i]);
+    }
+}
+
+/**
+ * \brief Change the LQR weights while running. Empty arrays keep the current weights. The AUV model solves for the new
+ * gains (on the gain thread if it runs) and swaps them in once ready, so the control loop is not interrupted.
+ */
+void GuidanceController::lqrWeightsCB(const auv_msgs::LQRWeights::ConstPtr &weights)
+{
+    std::vector<double> Qdiag = weights->Q_diag.empty() ? Qdiag_ : weights->Q_diag;
+    std::vector<double> QdiagIntegral = weights->Q_diag_integral.empty() ? QdiagIntegral_ : weights->Q_diag_integral;
+    std::vector<double> Rdiag = weights->R_diag.empty() ? Rdiag_ : weights->R_diag;
+
+    bool valid = (Qdiag.size() == 12) && (!enableLQRIntegral_ || QdiagIntegral.size() == 6) &&
+                 !Rdiag.empty() && ((int)Rdiag.size() <= numActiveThrusters_);
+    for (int i = 0; valid && i < Qdiag.size(); i++)
+        valid = std::isfinite(Qdiag[i]) && (Qdiag[i] >= 0);
+    for (int i = 0; valid && enableLQRIntegral_ && i < QdiagIntegral.size(); i++)
+        valid = std::isfinite(QdiagIntegral[i]) && (QdiagIntegral[i] >= 0);
+    for (int i = 0; valid && i < Rdiag.size(); i++)
+        valid = std::isfinite(Rdiag[i]) && (Rdiag[i] > 0);
+    if (!valid)
+    {
+        ROS_WARN("GuidanceController: Rejected LQR weights, Q_diag needs 12 (Q_diag_integral 6) non-negative values and R_diag up to %d positive values.",
+                 numActiveThrusters_);
+        return;
+    }
+
+    Eigen::MatrixXd Q, R;
+    GuidanceController::buildLQRCostMatrices(Qdiag, QdiagIntegral, Rdiag, Q, R);
+    if (!auvModel_->reconfigureLQRCostMatrices(Q, R))
+    {
+        ROS_WARN("GuidanceController: Rejected LQR weights, the gains can not be changed while running (gain schedule or cascaded control).");
+        return;
     }
+    if (feedForwardModel_ != NULL)
+        feedForwardModel_->reconfigureLQRCostMatrices(Q, R); // Applied before it builds the next schedule
+
+    Qdiag_ = Qdiag;
+    QdiagIntegral_ = QdiagIntegral;
+    Rdiag_ = Rdiag;
+    ROS_INFO("GuidanceController: New LQR weights accepted, switching gains once they are solved for.");
 }
 
 /**
@@ -215,6 +544,9 @@ void GuidanceController::initAUVModel()
  */
 void GuidanceController::sixDofCB(const auv_msgs::SixDoF::ConstPtr &state)
 {
+    std::lock_guard<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
+    stateStamp_ = state->header.stamp;
+
     // Inertial Position, expressed in Inertial-frame
     state_(acc::STATE_XI) = state->pose.position.x;
     state_(acc::STATE_YI) = state->pose.position.y;
@@ -240,18 +572,67 @@ void GuidanceController::sixDofCB(const auv_msgs::SixDoF::ConstPtr &state)
 
     // Inertial Translational Acceleration, expressed in Body-frame
     auv_core::eigen_ros::vectorMsgToEigen(state->linear_accel, linearAccel_);
+
+    if (enableCascaded_)
+        stateBuffer_.write(state_);
+}
+
+/**
+ * \brief Update the health of the listed thrusters. Inactive (disabled) thrusters are ignored.
+ */
+void GuidanceController::thrusterHealthCB(const auv_msgs::ThrusterHealth::ConstPtr &health)
+{
+    std::lock_guard<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
+    unsigned int healthMask = thrusterHealth_;
+    for (int i = 0; i < health->names.size() && i < health->healthy.size(); i++)
+    {
+        std::vector<std::string>::iterator it = std::find(activeThrusterNames_.begin(), activeThrusterNames_.end(), health->names[i]);
+        if (it == activeThrusterNames_.end())
+            continue;
+
+        unsigned int bit = 1u << (it - activeThrusterNames_.begin());
+        if (health->healthy[i])
+            healthMask |= bit;
+        else
+            healthMask &= ~bit;
+    }
+
+    if (healthMask != thrusterHealth_)
+    {
+        thrusterHealth_ = healthMask;
+        newThrusterHealth_ = true;
+    }
+}
+
+/**
+ * \brief Switch the AUV model to the latest thruster health, if its configuration has been computed (no solver work)
+ */
+void GuidanceController::updateThrusterHealth()
+{
+    if (!newThrusterHealth_ || !auvModel_->setThrusterHealth(thrusterHealth_))
+        return;
+
+    newThrusterHealth_ = false;
+    for (int i = 0; i < numActiveThrusters_; i++)
+    {
+        if (!(thrusterHealth_ & (1u << i)))
+            AUV_LOG(auv_core::AsyncLogger::LEVEL_WARN, "GuidanceController: Thruster %s failed, allocating around it.",
+                    activeThrusterNames_[i].c_str()); // The names are not changed after initialization
+    }
 }
 
 void GuidanceController::tgenActionGoalCB()
 {
     boost::shared_ptr<const auv_msgs::TrajectoryGeneratorGoal> tgenPtr = tgenActionServer_->acceptNewGoal();
+    std::lock_guard<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
 
     if (GuidanceController::isTrajectoryTypeValid(tgenPtr->trajectory.type))
     {
+        // Planned on the trajectory thread (the previous trajectory is followed until then)
         desiredTrajectory_ = tgenPtr->trajectory;
-        tgenType_ = desiredTrajectory_.type;
-        newTrajectory_ = true;
+        goalId_++;
         resultMessageSent_ = false;
+        trajectoryCondition_.notify_one();
 
         if (!tgenInit_)
             tgenInit_ = true;
@@ -268,7 +649,10 @@ void GuidanceController::tgenActionGoalCB()
 void GuidanceController::tgenActionPreemptCB()
 {
     tgenActionServer_->setPreempted();
+    std::lock_guard<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
     tgenInit_ = false;
+    trajectory_ = NULL; // Not followed again, even if no new goal has been planned yet when the next one is accepted
+    innerLoopActive_ = false; // The inner loop also publishes zero thrust once it stops
     thrust_.setZero();
     resultMessageSent_ = false;
     GuidanceController::publishThrustMessage();
@@ -294,47 +678,195 @@ bool GuidanceController::isTrajectoryTypeValid(int type)
 
 void GuidanceController::runController()
 {
-    if (!tgenInit_)
+    // The action server calls the goal and preempt callbacks with its own lock held, so it is only called once
+    // controllerMutex_ is released (the locks are always taken in the same order)
+    std::unique_lock<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
+    bool trajectoryCompleted = false;
+
+    GuidanceController::updateThrusterHealth();
+    if (!tgenInit_ || trajectory_ == NULL)
         return;
     
-    if (newTrajectory_) // Initialize new trajectory once
+    double evalTime = ros::Time::now().toSec() - startTime_.toSec();
+
+    // With a feed-forward schedule, the AUV model interpolates the reference instead
+    if (!feedForwardReady_ && GuidanceController::isTrajectoryTypeValid(tgenType_))
     {
-        GuidanceController::initNewTrajectory();
+        auv_core::ScopedTimer timer(trajectoryLatency_);
+        ref_ = trajectory_->computeState(evalTime);
+        accel_ = trajectory_->computeAccel(evalTime);
+        if (enableMPC_)
+        {
+            mpcRefs_.col(0) = ref_;
+            mpcAccels_.col(0) = accel_;
+            for (int k = 1; k < mpcHorizon_; k++)
+            {
+                mpcRefs_.col(k) = trajectory_->computeState(evalTime + k * mpcTimeStep_);
+                mpcAccels_.col(k) = trajectory_->computeAccel(evalTime + k * mpcTimeStep_);
+            }
+        }
+    }
+
+    if (evalTime > trajectoryDuration_ && !resultMessageSent_ && activeGoalId_ == goalId_)
+    {
+        resultMessageSent_ = true;
+        trajectoryCompleted = true;
+    }
+
+    if (checkNominalThrust_ && !feedForwardReady_ && !auvModel_->checkNominalThrust(ref_, accel_, nominalThrustTolerance_))
+        AUV_LOG_THROTTLE(1.0, auv_core::AsyncLogger::LEVEL_WARN, "GuidanceController: closed-form and Ceres nominal thrusts disagree.");
+
+    if (enableCascaded_)
+    {
+        // Outer loop only, the inner loop publishes the thrust
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        auvModel_->computeCascadedOuterLoop(state_, ref_, accel_);
+        innerLoopActive_ = true;
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        outerLoopLatency_.record(micros);
+        if (micros > 1e6 / controlRate_)
+            outerLoopOverruns_++;
     }
     else
     {
-        double evalTime = ros::Time::now().toSec() - startTime_.toSec();
+        const auv_guidance::Vector13d *state = &state_;
+        if (enableLatencyCompensation_)
+        {
+            GuidanceController::compensateLatency();
+            state = &predictedState_;
+        }
+
+        if (enableMPC_)
+            thrust_ = auvModel_->computeMPCThrust(*state, mpcRefs_, mpcAccels_);
+        else if (feedForwardReady_)
+            thrust_ = auvModel_->computeLQRThrust(*state, evalTime);
+        else
+            thrust_ = auvModel_->computeLQRThrust(*state, ref_, accel_);
+        auv_core::ScopedTimer timer(publishLatency_);
+        GuidanceController::publishThrustMessage();
+    }
+
+    if (latencyPeriod_ > 0 && (ros::Time::now() - lastLatencyTime_).toSec() >= latencyPeriod_)
+        GuidanceController::publishLatencyMessage();
+
+    lock.unlock();
+    if (trajectoryCompleted)
+    {
+        auv_msgs::TrajectoryGeneratorResult result;
+        result.completed = true;
+        tgenActionServer_->setSucceeded(result);
+    }
+}
+
+/**
+ * \brief Run the controller at control_rate until ROS shuts down. With the executor, the control loop runs on its own
+ * thread and this thread processes the ROS callbacks, otherwise both run on this thread, one after the other.
+ */
+void GuidanceController::spin()
+{
+    if (enableExecutor_)
+    {
+        executor_ = new auv_core::RealTimeExecutor(1.0 / controlRate_, executorCPU_, executorPriority_);
+        executor_->start(std::bind(&GuidanceController::runController, this));
+        if (executorPriority_ > 0 && !executor_->isRealTime())
+            ROS_WARN("GuidanceController: No real-time privileges, the control thread uses the default scheduler.");
+        if (executorCPU_ >= 0 && !executor_->isPinned())
+            ROS_WARN("GuidanceController: Unable to pin the control thread to CPU %d.", executorCPU_);
+        ROS_INFO("GuidanceController: Control thread running at %f Hz (real-time: %s, pinned: %s).", controlRate_,
+                 executor_->isRealTime() ? "yes" : "no", executor_->isPinned() ? "yes" : "no");
+
+        ros::spin();
+        executor_->stop();
+        return;
+    }
+
+    ros::Rate rate(controlRate_);
+    while (ros::ok())
+    {
+        ros::spinOnce();
+        GuidanceController::runController();
+        rate.sleep();
+    }
+}
+
+/**
+ * \brief Trajectory thread: plan and compile the trajectory of each new goal, from the latest state, and swap it in for
+ * runController. A goal superseded while it is planned is dropped, and the latest goal is planned instead.
+ */
+void GuidanceController::runTrajectoryThread()
+{
+    std::unique_lock<auv_core::PriorityInheritanceMutex> lock(controllerMutex_);
+    unsigned long plannedGoalId = goalId_;
+    Eigen::MatrixXd refs, accels; // Feed-forward samples (reused)
+    while (!stopTrajectoryThread_)
+    {
+        trajectoryCondition_.wait(lock, [&]() { return stopTrajectoryThread_ || plannedGoalId != goalId_; });
+        if (stopTrajectoryThread_)
+            break;
+
+        // Copy the goal and the latest state, then plan without holding the lock, in the plan runController is not using
+        plannedGoalId = goalId_;
+        auv_msgs::Trajectory goal = desiredTrajectory_;
+        auv_guidance::Vector13d state = state_;
+        Eigen::Quaterniond quaternion = quaternion_;
+        Eigen::Vector3d linearAccel = linearAccel_;
+        unsigned int thrusterHealth = thrusterHealth_;
+        TrajectoryPlan &plan = plans_[1 - activePlan_];
+        lock.unlock();
 
-        if (tgenType_ == auv_msgs::Trajectory::BASIC_ABS_XYZ || tgenType_ == auv_msgs::Trajectory::BASIC_ABS_XYZ)
+        // The feed-forward schedule is built with feedForwardModel_, auvModel_ keeps controlling meanwhile
+        GuidanceController::planTrajectory(plan, goal, state, quaternion, linearAccel);
+        auv_control::FeedForwardSchedule *schedule = NULL;
+        if (feedForwardModel_ != NULL)
         {
-            ref_ = basicTrajectory_->computeState(evalTime);
-            accel_ = basicTrajectory_->computeAccel(evalTime);
-            //ROS_INFO("Time in Trajectory: %f", dt);
-            //std::cout << "Reference state: " << std::endl << ref << std::endl; // Debug
-            //std::cout << "Accel state: " << std::endl << accel << std::endl; // Debug
+            GuidanceController::sampleTrajectory(plan, refs, accels);
+            schedule = GuidanceController::compileFeedForward(refs, accels, thrusterHealth);
         }
 
-        if (evalTime > trajectoryDuration_ && !resultMessageSent_)
+        lock.lock();
+        if (plannedGoalId != goalId_ || stopTrajectoryThread_)
         {
-            resultMessageSent_ = true;
-            auv_msgs::TrajectoryGeneratorResult result;
-            result.completed = true;
-            tgenActionServer_->setSucceeded(result);
+            delete schedule;
+            continue;
         }
 
-        thrust_ = auvModel_->computeLQRThrust(state_, ref_, accel_);
-        GuidanceController::publishThrustMessage();
+        // Swap in the plan and its feed-forward schedule, the previous trajectory is followed until then
+        activePlan_ = 1 - activePlan_;
+        trajectory_ = plan.trajectory;
+        tgenType_ = plan.type;
+        trajectoryDuration_ = plan.duration;
+        feedForwardReady_ = (schedule != NULL);
+        schedule = auvModel_->swapFeedForward(schedule);
+        activeGoalId_ = plannedGoalId;
+        resultMessageSent_ = false;
+        startTime_ = ros::Time::now(); // The trajectory starts once it is compiled
+
+        // Free the previous trajectory's schedule without holding the lock
+        lock.unlock();
+        delete schedule;
+        lock.lock();
     }
 }
 
 /**
- * \brief Initialize new trajectory
+ * @param plan Plan to build (its previous trajectory is destroyed and its memory reused)
+ * @param goal Desired trajectory
+ * @param state Current state
+ * @param quaternion Current attitude
+ * @param linearAccel Current inertial translational acceleration, expressed in B-frame
+ * \brief Plan the trajectory from the current state to the goal, and flatten it for evaluation
  */
-void GuidanceController::initNewTrajectory()
+void GuidanceController::planTrajectory(TrajectoryPlan &plan, const auv_msgs::Trajectory &goal, const auv_guidance::Vector13d &state,
+                                        const Eigen::Quaterniond &quaternion, const Eigen::Vector3d &linearAccel)
 {
     ROS_INFO("GuidanceController: Initializing new trajectory.");
-    newTrajectory_ = false;
-    startTime_ = ros::Time::now();
+
+    // The plan's previous trajectory is no longer evaluated, destroy it and reuse its memory
+    plan.arena.reset();
+    plan.basicTrajectory = NULL;
+    plan.trajectory = NULL;
+    plan.duration = 0;
+    plan.type = goal.type;
 
     Eigen::Vector3d zero3d = Eigen::Vector3d::Zero();
     Eigen::Vector3d posIStart = zero3d;
@@ -342,44 +874,212 @@ void GuidanceController::initNewTrajectory()
     Eigen::Vector3d accelIStart = zero3d;
     
     // Inertial position, velocity, and accel expressed in I-frame
-    posIStart = state_.segment<3>(acc::STATE_XI);
-    velIStart = quaternion_ * state_.segment<3>(acc::STATE_U);
-    accelIStart = quaternion_ * linearAccel_;
+    posIStart = state.segment<3>(acc::STATE_XI);
+    velIStart = quaternion * state.segment<3>(acc::STATE_U);
+    accelIStart = quaternion * linearAccel;
 
-    startWaypoint_ = new auv_guidance::Waypoint(posIStart, velIStart, accelIStart, quaternion_, state_.segment<3>(acc::STATE_P));
+    auv_guidance::Waypoint *startWaypoint = plan.arena.create<auv_guidance::Waypoint>(posIStart, velIStart, accelIStart, quaternion, state.segment<3>(acc::STATE_P));
 
-    if (tgenType_ == auv_msgs::Trajectory::BASIC_ABS_XYZ || tgenType_ == auv_msgs::Trajectory::BASIC_REL_XYZ)
+    if (goal.type == auv_msgs::Trajectory::BASIC_ABS_XYZ || goal.type == auv_msgs::Trajectory::BASIC_REL_XYZ)
     {  
         Eigen::Vector3d posIEnd = zero3d;
         Eigen::Quaterniond quatEnd;
 
-        auv_core::eigen_ros::pointMsgToEigen(desiredTrajectory_.pose.position, posIEnd);
-        auv_core::eigen_ros::quaternionMsgToEigen(desiredTrajectory_.pose.orientation, quatEnd);
+        auv_core::eigen_ros::pointMsgToEigen(goal.pose.position, posIEnd);
+        auv_core::eigen_ros::quaternionMsgToEigen(goal.pose.orientation, quatEnd);
+
+        if (goal.type == auv_msgs::Trajectory::BASIC_REL_XYZ)
+            posIEnd = (quaternion * posIStart) + posIEnd;
+
+        auv_guidance::Waypoint *endWaypoint = plan.arena.create<auv_guidance::Waypoint>(posIEnd, zero3d, zero3d, quatEnd, zero3d);
+        plan.basicTrajectory = plan.arena.create<auv_guidance::BasicTrajectory>(startWaypoint, endWaypoint, tgenLimits_, &plan.arena);
+        plan.duration = plan.basicTrajectory->getTime();
+
+        // Evaluate the flattened trajectory (no chain of segment objects)
+        plan.compiledTrajectory.clear();
+        plan.trajectory = &plan.compiledTrajectory;
+        if (!plan.basicTrajectory->compile(plan.compiledTrajectory))
+        {
+            ROS_WARN("GuidanceController: Unable to compile the trajectory, evaluating its segments instead.");
+            plan.trajectory = plan.basicTrajectory;
+        }
+
+        auv_guidance::MinJerkTimeCache &timeCache = auv_guidance::MinJerkTimeCache::shared();
+        ROS_DEBUG("GuidanceController: Min jerk time cache: %lu hits, %lu misses, %lu evictions, %lu entries.",
+                  (unsigned long)timeCache.getHits(), (unsigned long)timeCache.getMisses(),
+                  (unsigned long)timeCache.getEvictions(), (unsigned long)timeCache.size());
+    }
+}
+
+/**
+ * @param plan Planned trajectory
+ * @param refs Reference state at each sample (one column per sample, the first is at time zero)
+ * @param accels Reference acceleration at each sample
+ * \brief Sample the planned trajectory at the control period, for the feed-forward schedule
+ */
+void GuidanceController::sampleTrajectory(TrajectoryPlan &plan, Eigen::MatrixXd &refs, Eigen::MatrixXd &accels)
+{
+    double period = 1.0 / controlRate_;
+    int numSamples = (plan.trajectory == NULL) ? 0 : (int)ceil(plan.duration / period) + 1;
+    refs.resize(13, numSamples);
+    accels.resize(6, numSamples);
+    for (int i = 0; i < numSamples; i++)
+    {
+        refs.col(i) = plan.trajectory->computeState(i * period);
+        accels.col(i) = plan.trajectory->computeAccel(i * period);
+    }
+}
+
+/**
+ * @param refs Reference state at each sample (see sampleTrajectory)
+ * @param accels Reference acceleration at each sample
+ * @param thrusterHealth Latest thruster health (see thrusterHealthCB)
+ * \brief Have feedForwardModel_ precompute the nominal thrust (and optionally the LQR gains) at each sample, for
+ * auvModel_. Returns NULL if this fails, and the trajectory is evaluated every tick instead. Only called by the
+ * trajectory thread.
+ */
+auv_control::FeedForwardSchedule *GuidanceController::compileFeedForward(const Eigen::MatrixXd &refs, const Eigen::MatrixXd &accels,
+                                                                         unsigned int thrusterHealth)
+{
+    ros::WallTime start = ros::WallTime::now();
+    if (!feedForwardModel_->setThrusterHealth(thrusterHealth))
+        ROS_WARN("GuidanceController: Thruster configuration not ready, the feed-forward nominal thrust is recomputed every tick.");
+
+    int numSamples = refs.cols();
+    int mismatches = 0;
+    for (int i = 0; checkNominalThrust_ && i < numSamples; i++)
+    {
+        if (!feedForwardModel_->checkNominalThrust(refs.col(i), accels.col(i), nominalThrustTolerance_))
+            mismatches++;
+    }
+    if (mismatches > 0)
+        ROS_WARN("GuidanceController: closed-form and Ceres nominal thrusts disagree at %d of %d samples.", mismatches, numSamples);
+
+    // The gain thread solves for the gains of auvModel_ instead
+    bool compileGains = feedForwardGains_ && !(enableGainThread_ && !enableGainSchedule_);
+    auv_control::FeedForwardSchedule *schedule = feedForwardModel_->buildFeedForward(refs, accels, 1.0 / controlRate_, compileGains);
+    if (schedule != NULL)
+        ROS_INFO("GuidanceController: Compiled %d feed-forward samples in %f s.", numSamples, (ros::WallTime::now() - start).toSec());
+    else
+        ROS_WARN("GuidanceController: Unable to compile the feed-forward schedule, evaluating the trajectory every tick.");
+    return schedule;
+}
+
+/**
+ * \brief Predict the state at the expected actuation time (now plus the actuation delay) from the latest state, assuming
+ * the previously commanded thrust is applied until then. States without a stamp are only predicted over the actuation
+ * delay.
+ */
+void GuidanceController::compensateLatency()
+{
+    auv_core::ScopedTimer timer(predictionLatency_);
+    double age = stateStamp_.isZero() ? 0.0 : (ros::Time::now() - stateStamp_).toSec();
+    double horizon = std::min(std::max(age + actuationDelay_, 0.0), maxPredictionHorizon_);
+    predictedState_ = auvModel_->predictState(state_, thrust_, horizon);
+    compensatedLatency_.record(1e6 * horizon);
+}
+
+/**
+ * \brief Cascaded inner loop: every period, compute and publish the thrust from the latest state and outer loop command.
+ * A tick that ends after the next one was due counts as an overrun, and the missed ticks are skipped.
+ */
+void GuidanceController::runInnerLoop()
+{
+    std::chrono::nanoseconds period((long long)(1e9 / innerRate_));
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+    bool wasActive = false;
+    while (!stopInnerLoop_)
+    {
+        deadline += period;
+        std::this_thread::sleep_until(deadline);
 
-        if (tgenType_ == auv_msgs::Trajectory::BASIC_REL_XYZ)
-            posIEnd = (quaternion_ * posIStart) + posIEnd;
+        bool active = innerLoopActive_;
+        if (active || wasActive)
+        {
+            auv_core::ScopedTimer timer(innerLoopLatency_);
+            auv_control::AbstractAUVModel::ThrustVector thrust;
+            if (active)
+                thrust = auvModel_->computeCascadedInnerLoop(stateBuffer_.read());
+            else
+                thrust.setZero(auvModel_->getMaxThrusters()); // Stopped: publish zero thrust once
+            for (int i = 0; i < numActiveThrusters_; i++)
+                innerThrustMsg_.thrusts[i] = thrust(i);
+            innerThrustMsg_.header.stamp = ros::Time::now();
+            thrustPub_.publish(innerThrustMsg_);
+        }
+        wasActive = active;
 
-        endWaypoint_ = new auv_guidance::Waypoint(posIEnd, zero3d, zero3d, quatEnd, zero3d);
-        basicTrajectory_ = new auv_guidance::BasicTrajectory(startWaypoint_, endWaypoint_, tgenLimits_);
-        trajectoryDuration_ = basicTrajectory_->getTime();
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now > deadline + period)
+        {
+            innerLoopOverruns_++;
+            deadline = now;
+        }
     }
 }
 
 void GuidanceController::publishThrustMessage()
 {
-    auv_msgs::Thrust thrustMsg;
+    for (int i = 0; i < numActiveThrusters_; i++) // Inactive thrusters stay at zero
+        thrustMsg_.thrusts[i] = thrust_(i);
 
-    for (int i = 0; i < activeThrusterNames_.size(); i++)
-        thrustMsg.names.push_back(activeThrusterNames_[i]);
+    thrustMsg_.header.stamp = ros::Time::now();
+    thrustPub_.publish(thrustMsg_);
+}
 
-    for (int i = 0; i < inactiveThrusterNames_.size(); i++)
-        thrustMsg.names.push_back(inactiveThrusterNames_[i]);
+/**
+ * \brief Publish the latency statistics (p50, p99, and max) of each stage since the previous message, then clear them
+ */
+void GuidanceController::publishLatencyMessage()
+{
+    std::vector<const auv_core::LatencyHistogram *> histograms;
+    histograms.push_back(&trajectoryLatency_);
+    for (int i = 0; i < auv_control::AbstractAUVModel::NUM_STAGES; i++)
+        histograms.push_back(&auvModel_->getStageLatency(i));
+    histograms.push_back(&publishLatency_);
+    if (enableCascaded_)
+    {
+        histograms.push_back(&outerLoopLatency_);
+        histograms.push_back(&innerLoopLatency_);
+    }
+    if (enableLatencyCompensation_)
+    {
+        histograms.push_back(&predictionLatency_);
+        histograms.push_back(&compensatedLatency_);
+    }
+    if (executor_ != NULL)
+    {
+        histograms.push_back(&executor_->getJitter());
+        histograms.push_back(&executor_->getExecutionTime());
+    }
+
+    for (int i = 0; i < histograms.size(); i++)
+    {
+        latencyMsg_.counts[i] = histograms[i]->getCount();
+        latencyMsg_.p50[i] = histograms[i]->getPercentile(50);
+        latencyMsg_.p99[i] = histograms[i]->getPercentile(99);
+        latencyMsg_.max[i] = histograms[i]->getMax();
+    }
+
+    latencyMsg_.overruns = (executor_ != NULL) ? executor_->takeOverruns() : 0;
+    lastLatencyTime_ = ros::Time::now();
+    latencyMsg_.header.stamp = lastLatencyTime_;
+    latencyPub_.publish(latencyMsg_);
 
-    for (int i = 0; i < thrust_.rows(); i++)
-        thrustMsg.thrusts.push_back(thrust_(i));
+    trajectoryLatency_.reset();
+    publishLatency_.reset();
+    outerLoopLatency_.reset();
+    innerLoopLatency_.reset();
+    predictionLatency_.reset();
+    compensatedLatency_.reset();
 
-    thrustMsg.header.stamp = ros::Time::now();
-    thrustPub_.publish(thrustMsg);
+    unsigned long outerOverruns = outerLoopOverruns_.exchange(0), innerOverruns = innerLoopOverruns_.exchange(0);
+    if (outerOverruns > 0 || innerOverruns > 0)
+        AUV_LOG(auv_core::AsyncLogger::LEVEL_WARN, "GuidanceController: Cascaded loops missed deadlines: outer %lu, inner %lu.",
+                outerOverruns, innerOverruns);
+    if (executor_ != NULL)
+        executor_->resetStatistics();
+    auvModel_->resetStageLatency();
 }
 
 } // namespace auv_gnc
@@ -5,13 +5,6 @@ int main(int argc, char** argv) {
   ros::init(argc, argv, "guidance_controller");
   ros::NodeHandle nh("~");
   auv_gnc::GuidanceController gcon(nh);
-
-  ros::Rate rate(50);
-  while (ros::ok())
-  {
-    ros::spinOnce();
-    gcon.runController();
-    rate.sleep();
-  }
+  gcon.spin();
   return 0;
 }
\ No newline at end of file
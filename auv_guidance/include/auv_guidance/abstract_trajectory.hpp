@@ -5,6 +5,8 @@
 
 namespace auv_guidance
 {
+class CompiledTrajectory;
+
 typedef Eigen::Matrix<double, 12, 1> Vector12d;
 typedef Eigen::Matrix<double, 13, 1> Vector13d;
 typedef Eigen::Matrix<double, 6, 1> Vector6d;
@@ -17,6 +19,9 @@ class Trajectory
 public:
    virtual Vector13d computeState(double time) = 0;
    virtual Vector6d computeAccel(double time) = 0;
+
+   // Append the trajectory's segments to a compiled trajectory, starting at startTime [s]. Returns false if they do not fit.
+   virtual bool compile(CompiledTrajectory &compiled, double startTime) = 0;
 };
 } // namespace auv_guidance
 
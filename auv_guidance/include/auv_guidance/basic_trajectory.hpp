@@ -3,12 +3,14 @@
 
 #include "auv_guidance/abstract_trajectory.hpp"
 #include "auv_guidance/waypoint.hpp"
-#include "auv_guidance/min_jerk_time_solver.hpp"
+#include "auv_guidance/min_jerk_time_cache.hpp"
 #include "auv_guidance/min_jerk_trajectory.hpp"
 #include "auv_guidance/simultaneous_trajectory.hpp"
 #include "auv_guidance/long_trajectory.hpp"
 #include "auv_guidance/tgen_limits.hpp"
+#include "auv_guidance/trajectory_arena.hpp"
 #include "auv_control/auv_model.hpp"
+#include "auv_core/async_logger.hpp"
 #include "auv_core/rot3d.hpp"
 
 #include "eigen3/Eigen/Dense"
@@ -22,6 +24,7 @@ class BasicTrajectory : public Trajectory
 {
 private:
    TGenLimits *tGenLimits_;
+   TrajectoryArena *arena_;
    SimultaneousTrajectory *stStop_, *stPrimary_;
    LongTrajectory *ltPrimary_;
    MinJerkTrajectory *mjtHelper_;
@@ -37,7 +40,7 @@ private:
 public:
    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-   BasicTrajectory(Waypoint *wStart, Waypoint *wEnd, TGenLimits *tGenLimits);
+   BasicTrajectory(Waypoint *wStart, Waypoint *wEnd, TGenLimits *tGenLimits, TrajectoryArena *arena);
    void setStopTrajectory();
    void computeMaxVelocity();
    void computeSimultaneousTime();
@@ -45,6 +48,7 @@ public:
    double getTime();
    Vector13d computeState(double time);
    Vector6d computeAccel(double time);
+   bool compile(CompiledTrajectory &compiled, double startTime = 0);
 };
 } // namespace auv_guidance
 
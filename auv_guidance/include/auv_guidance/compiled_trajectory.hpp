@@ -0,0 +1,66 @@
+#ifndef COMPILED_TRAJECTORY
+#define COMPILED_TRAJECTORY
+
+#include "auv_guidance/abstract_trajectory.hpp"
+#include "auv_guidance/min_jerk_trajectory.hpp"
+#include "auv_core/constants.hpp"
+
+#include "eigen3/Eigen/Dense"
+#include "eigen3/Eigen/Core"
+#include "math.h"
+
+namespace auv_guidance
+{
+// Compiled Trajectory
+// Flat representation of a trajectory made of simultaneous segments (see SimultaneousTrajectory), built with
+// Trajectory::compile. Each segment stores, in structure-of-arrays form (indexed by segment), the quintic min jerk
+// polynomials of x, y, z, and the attitude angle in normalized time, with their velocity and acceleration polynomials
+// pre-scaled by the segment duration, its rotation axis, and the quaternions it slerps between.
+// Evaluation finds the segment by counting the segment boundaries before the time (fixed-size, without branches), then
+// evaluates the polynomials with Horner's method at the clamped normalized time. It does not allocate or keep any state,
+// so, unlike SimultaneousTrajectory, computeAccel does not depend on a previous call to computeState, and concurrent
+// readers are safe.
+class CompiledTrajectory : public Trajectory
+{
+public:
+   static const int MAX_SEGMENTS = 8;
+   static const int NUM_AXES = 4; // x, y, z, attitude angle
+   static const int AXIS_X = 0, AXIS_Y = 1, AXIS_Z = 2, AXIS_ATT = 3;
+
+private:
+   int numSegments_;
+   double duration_;
+
+   // Segment timing: end times are +inf for the last segment (it holds its final state) and unused segments
+   double startTimes_[MAX_SEGMENTS], endTimes_[MAX_SEGMENTS], durations_[MAX_SEGMENTS], invDurations_[MAX_SEGMENTS];
+
+   // Polynomials in normalized time, lowest order first: position (quintic), velocity (quartic), acceleration (cubic)
+   double position_[NUM_AXES][6][MAX_SEGMENTS], velocity_[NUM_AXES][5][MAX_SEGMENTS], accel_[NUM_AXES][4][MAX_SEGMENTS];
+
+   // Attitude: slerp from qStart to qEnd (w, x, y, z) in normalized time, angular rates about the rotation axis
+   double qStart_[4][MAX_SEGMENTS], qEnd_[4][MAX_SEGMENTS];
+   double slerpTheta_[MAX_SEGMENTS], slerpInvSinTheta_[MAX_SEGMENTS], slerpCotTheta_[MAX_SEGMENTS];
+   double slerpSign_[MAX_SEGMENTS], slerpLinear_[MAX_SEGMENTS];
+   double rotationAxis_[3][MAX_SEGMENTS];
+
+   int appendSegment(double startTime, double duration);
+   int findSegment(double time) const;
+   double computeTau(int segment, double time) const;
+   Eigen::Quaterniond computeQuaternion(int segment, double tau) const;
+
+public:
+   CompiledTrajectory();
+   void clear();
+   bool addSegment(double startTime, double duration, MinJerkTrajectory *mjt[NUM_AXES], const Eigen::Quaterniond &qStart,
+                   const Eigen::Quaterniond &qEnd, const Eigen::Ref<const Eigen::Vector3d> &rotationAxis);
+   int getNumSegments();
+   double getSegmentStartTime(int segment);
+   double getTime();
+
+   bool compile(CompiledTrajectory &compiled, double startTime);
+   Vector13d computeState(double time);
+   Vector6d computeAccel(double time);
+};
+} // namespace auv_guidance
+
+#endif
@@ -3,10 +3,12 @@
 
 #include "auv_guidance/abstract_trajectory.hpp"
 #include "auv_guidance/simultaneous_trajectory.hpp"
-#include "auv_guidance/min_jerk_time_solver.hpp"
+#include "auv_guidance/min_jerk_time_cache.hpp"
 #include "auv_guidance/tgen_limits.hpp"
+#include "auv_guidance/trajectory_arena.hpp"
 #include "auv_guidance/waypoint.hpp"
 #include "auv_control/auv_model.hpp"
+#include "auv_core/async_logger.hpp"
 #include "auv_core/rot3d.hpp"
 
 #include "eigen3/Eigen/Dense"
@@ -18,9 +20,13 @@ namespace auv_guidance
 {
 class LongTrajectory : public Trajectory
 {
+public:
+   static const int MAX_CURSOR_STEPS = 2; // Segments a lookup steps forward before it falls back to a binary search
+
 private:
    SimultaneousTrajectory *stPreRotation_, *stSpeedUp_, *stCruise_, *stSlowDown_, *stPostRotation_;
    TGenLimits *tGenLimits_;
+   TrajectoryArena *arena_;
    std::vector<SimultaneousTrajectory *> stList_;
    std::vector<double> stTimes_;
    Waypoint *wStart_, *wEnd_, *wPreTranslate_, *wCruiseStart_, *wCruiseEnd_, *wPostTranslate_;
@@ -34,14 +40,20 @@ private:
 public:
    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-   LongTrajectory(Waypoint *start, Waypoint *end, TGenLimits *tGenLimits, double cruiseRatio, double cruiseSpeed);
+   LongTrajectory(Waypoint *start, Waypoint *end, TGenLimits *tGenLimits, double cruiseRatio, double cruiseSpeed,
+                  TrajectoryArena *arena);
    void initTrajectory();
    void initWaypoints();
    void initSimultaneousTrajectories();
    double computeRotationTime(Eigen::Quaterniond qDiff);
    double getTime();
+   int getNumSegments();
+   int findSegment(double time, int hint);
+   Vector13d computeSegmentState(int segment, double time);
+   Vector6d computeSegmentAccel(int segment, double time);
    Vector13d computeState(double time);
    Vector6d computeAccel(double time);
+   bool compile(CompiledTrajectory &compiled, double startTime);
 };
 } // namespace auv_guidance
 
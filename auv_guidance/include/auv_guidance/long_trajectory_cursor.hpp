@@ -0,0 +1,30 @@
+#ifndef LONG_TRAJECTORY_CURSOR
+#define LONG_TRAJECTORY_CURSOR
+
+#include "auv_guidance/long_trajectory.hpp"
+
+namespace auv_guidance
+{
+// Long Trajectory Cursor
+// Reader of a LongTrajectory that remembers its active segment. Queries at increasing times (as the controller makes)
+// step forward from that segment in amortized O(1), earlier times or jumps ahead fall back to a binary search (see
+// LongTrajectory::findSegment). Each reader of a trajectory can have its own cursor, so readers at different times (e.g.
+// the current state and an MPC horizon) do not move each other's segment. The cursor does not own the trajectory and
+// is invalid once the trajectory's arena is reset. The controller does not use it yet: it evaluates a CompiledTrajectory
+// or BasicTrajectory.
+class LongTrajectoryCursor
+{
+private:
+   LongTrajectory *trajectory_;
+   int segment_;
+
+public:
+   LongTrajectoryCursor(LongTrajectory *trajectory);
+   void reset();
+   int getSegment();
+   Vector13d computeState(double time);
+   Vector6d computeAccel(double time);
+};
+} // namespace auv_guidance
+
+#endif
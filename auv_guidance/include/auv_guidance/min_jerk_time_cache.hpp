@@ -0,0 +1,80 @@
+#ifndef MIN_JERK_TIME_CACHE
+#define MIN_JERK_TIME_CACHE
+
+#include "auv_guidance/min_jerk_time_solver.hpp"
+#include "eigen3/Eigen/Core"
+#include "math.h"
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace auv_guidance
+{
+// Min Jerk Time Cache
+// Thread-safe LRU cache of MinJerkTimeSolver durations. Boundary conditions are keyed on (distance, v0, a0, vf, af, jerk),
+// each quantized to a multiple of the resolution (jerk is the mean of the start and end jerks, the solver only uses their
+// sum). A miss solves the quantized conditions, so the cached duration does not depend on which query filled the entry.
+// The least recently used entry is evicted when the cache is full. A capacity of zero disables the cache (every query is
+// solved, and counted as a miss).
+class MinJerkTimeCache
+{
+public:
+   static const int KEY_SIZE = 6;
+
+private:
+   struct Key
+   {
+      int64_t values[KEY_SIZE];
+      bool operator==(const Key &other) const;
+   };
+
+   struct KeyHash
+   {
+      size_t operator()(const Key &key) const;
+   };
+
+   struct Entry
+   {
+      Key key;
+      double time;
+   };
+
+   typedef std::list<Entry> EntryList;
+   typedef std::unordered_map<Key, EntryList::iterator, KeyHash> EntryMap;
+
+   EntryList entries_; // Most recently used first
+   EntryMap index_;
+   size_t capacity_;
+   double resolution_;
+   std::mutex mutex_;
+   std::atomic<uint64_t> hits_, misses_, evictions_;
+
+   MinJerkTimeCache(const MinJerkTimeCache &) = delete;
+   MinJerkTimeCache &operator=(const MinJerkTimeCache &) = delete;
+
+   Key makeKey(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end);
+   void trim();
+
+public:
+   MinJerkTimeCache(size_t capacity = 256, double resolution = 1e-6);
+   static MinJerkTimeCache &shared();
+
+   double getTime(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end);
+   void setCapacity(size_t capacity);
+   size_t getCapacity();
+   void setResolution(double resolution);
+   double getResolution();
+   size_t size();
+   void clear();
+
+   uint64_t getHits();
+   uint64_t getMisses();
+   uint64_t getEvictions();
+   double getHitRate();
+   void resetStatistics();
+};
+} // namespace auv_guidance
+
+#endif
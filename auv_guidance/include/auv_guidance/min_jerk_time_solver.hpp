@@ -5,26 +5,43 @@
 #include "eigen3/Eigen/Core"
 #include "auv_guidance/monotonic_trajectory_time_solver.hpp"
 #include "auv_guidance/min_jerk_trajectory.hpp"
+#include "math.h"
+#include <algorithm>
 
 namespace auv_guidance
 {
 // Solve for optimal time between two points given initial/final velocity, accel, and jerk
+// The distance covered by the min jerk velocity profile is a cubic in the duration dt:
+//    (j0 + jf)/120 * dt^3 + (a0 - af)/10 * dt^2 + (v0 + vf)/2 * dt = xf - x0
+// SOLVER_ANALYTIC (default) returns its smallest non-negative root directly. SOLVER_CERES solves the same equation
+// iteratively with Ceres (MonotonicTrajectoryTimeSolver).
+// Both solvers replace v0 with 0.001 m/s when v0 = vf = 0 (rest to rest), as MonotonicTrajectoryTimeSolver always has,
+// so the durations do not depend on the solver.
 class MinJerkTimeSolver
 {
+public:
+   static const int SOLVER_ANALYTIC = 0;
+   static const int SOLVER_CERES = 1;
+
 private:
-   // Ceres Problem
-   ceres::Problem problemMTTS_;
-   ceres::Solver::Options optionsMTTS_;
-   ceres::Solver::Summary summaryMTTS_;
+   Eigen::Vector4d start_, end_;
    double minTime_;
 
-   MinJerkTrajectory *mjt_;
+   static void computeCoefficients(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end,
+                                   double c[4]);
+   static double solveAnalytic(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end);
+   static double solveCeres(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end);
 
 public:
-   MinJerkTimeSolver(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end);
+   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   MinJerkTimeSolver(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end,
+                     int solver = SOLVER_ANALYTIC);
    double getTime();
    double getMiddleVelocity();
+   static double computeDistanceError(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end,
+                                      double duration);
 };
 } // namespace auv_guidance
 
-#endif
\ No newline at end of file
+#endif
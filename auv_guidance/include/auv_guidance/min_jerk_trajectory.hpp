@@ -19,6 +19,8 @@ public:
    void computeCoeffs();
    Eigen::Vector3d computeState(double time);
    double getMiddleVelocity();
+   double getDuration();
+   Eigen::Matrix<double, 6, 1> getCoeffs();
 };
 } // namespace auv_guidance
 
@@ -2,8 +2,10 @@
 #define SIMULTANEOUS_TRAJECTORY
 
 #include "auv_guidance/abstract_trajectory.hpp"
+#include "auv_guidance/compiled_trajectory.hpp"
 #include "auv_guidance/waypoint.hpp"
 #include "auv_guidance/min_jerk_trajectory.hpp"
+#include "auv_guidance/trajectory_arena.hpp"
 #include "auv_control/auv_model.hpp"
 #include "auv_core/constants.hpp"
 #include "auv_core/math_lib.hpp"
@@ -19,6 +21,7 @@ namespace auv_guidance
 class SimultaneousTrajectory : public Trajectory
 {
 private:
+   TrajectoryArena *arena_;
    MinJerkTrajectory *mjtX_, *mjtY_, *mjtZ_, *mjtAtt_;
    Waypoint *wStart_, *wEnd_;
    Eigen::Quaterniond qStart_, qEnd_, qDiff_, qSlerp_;
@@ -31,11 +34,12 @@ private:
 public:
    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-   SimultaneousTrajectory(Waypoint *start, Waypoint *end, double duration);
+   SimultaneousTrajectory(Waypoint *start, Waypoint *end, double duration, TrajectoryArena *arena);
    void initTrajectory();
    double getTime();
    Vector13d computeState(double time);
    Vector6d computeAccel(double time);
+   bool compile(CompiledTrajectory &compiled, double startTime);
 };
 } // namespace auv_guidance
 
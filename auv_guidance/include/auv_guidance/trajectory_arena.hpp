@@ -0,0 +1,88 @@
+#ifndef TRAJECTORY_ARENA
+#define TRAJECTORY_ARENA
+
+#include <stddef.h>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace auv_guidance
+{
+// Trajectory Arena
+// Monotonic arena that owns the waypoints and segments of a trajectory. Objects are constructed in place in large blocks,
+// one after the other, so a trajectory's segments are contiguous in memory. Nothing is freed individually: reset()
+// destroys every object (in reverse order of creation) and rewinds the blocks for the next trajectory, keeping them, so
+// planning a trajectory of the same size again does not allocate. release() also frees the blocks.
+// Not thread-safe: only use it from one thread at a time (e.g. plan on one thread, then hand the trajectory over).
+class TrajectoryArena
+{
+public:
+   static const size_t DEFAULT_BLOCK_SIZE = 16384; // [bytes]
+   static const size_t BLOCK_ALIGNMENT = 64;       // Cache line
+
+private:
+   struct Block
+   {
+      Block *next;
+      size_t size, used;
+      char *data;
+   };
+
+   struct Destructor
+   {
+      void (*destroy)(void *);
+      void *object;
+      Destructor *next;
+   };
+
+   Block *first_, *current_;
+   Destructor *destructors_; // Most recently created first
+   size_t blockSize_, numObjects_;
+
+   TrajectoryArena(const TrajectoryArena &) = delete;
+   TrajectoryArena &operator=(const TrajectoryArena &) = delete;
+
+   template <typename T>
+   static void destroy(void *object)
+   {
+      static_cast<T *>(object)->~T();
+   }
+
+public:
+   TrajectoryArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+   ~TrajectoryArena();
+
+   void *allocate(size_t size, size_t alignment);
+   void reset();
+   void release();
+
+   size_t getNumObjects();
+   size_t getBytesUsed();
+   size_t getBytesReserved();
+   size_t getNumBlocks();
+
+   /**
+    * @param args Constructor arguments
+    * \brief Construct a T in the arena. It is destroyed by reset(), release(), or the arena's destructor (never delete it).
+    */
+   template <typename T, typename... Args>
+   T *create(Args &&... args)
+   {
+      void *memory = TrajectoryArena::allocate(sizeof(T), std::max(alignof(T), (size_t)16)); // 16: Eigen fixed-size types
+      T *object = new (memory) T(std::forward<Args>(args)...);
+      if (!std::is_trivially_destructible<T>::value)
+      {
+         Destructor *destructor = new (TrajectoryArena::allocate(sizeof(Destructor), alignof(Destructor))) Destructor;
+         destructor->destroy = &TrajectoryArena::destroy<T>;
+         destructor->object = object;
+         destructor->next = destructors_;
+         destructors_ = destructor;
+      }
+      numObjects_++;
+      return object;
+   }
+};
+} // namespace auv_guidance
+
+#endif
@@ -0,0 +1,547 @@
+#include "auv_guidance/basic_trajectory.hpp"
+#include "auv_guidance/compiled_trajectory.hpp"
+#include "auv_guidance/long_trajectory_cursor.hpp"
+#include "auv_guidance/min_jerk_time_cache.hpp"
+#include "auv_guidance/min_jerk_time_solver.hpp"
+#include "auv_guidance/trajectory_arena.hpp"
+#include "auv_core/rot3d.hpp"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Microbenchmarks for auv_guidance (does not require ROS)
+// Usage: auv_guidance_bench [repetitions]
+// Returns 1 if the analytic min jerk time solver is farther from a solution than Ceres, or its duration differs from
+// Ceres' wherever Ceres converges, or Ceres does not converge where the solution is unique, anywhere on a grid of
+// boundary conditions, or if the min jerk time cache returns durations that differ from the solver's, miscounts its hits
+// and misses, does not evict the least recently used entries, or is not thread-safe, or if the trajectory arena does not
+// destroy its objects on reset, or keeps growing while planning a sequence of goals, or if a compiled trajectory does not
+// reproduce the states and accelerations of the BasicTrajectory it was compiled from, or if a LongTrajectory's segment
+// lookup differs from a linear scan or its cursor evaluates differently from the compiled form. Each benchmark reports its
+// failed checks by name with check().
+
+namespace
+{
+struct BoundaryConditions
+{
+   Eigen::Vector4d start, end;
+};
+
+// Dense grid of 1-D boundary conditions (position, velocity, acceleration, jerk)
+std::vector<BoundaryConditions, Eigen::aligned_allocator<BoundaryConditions>> makeGrid()
+{
+   const double distances[] = {0, 0.01, 0.1, 0.5, 1, 2, 5, 10, 30};
+   const double startVelocities[] = {0, 0.05, 0.2, 0.5, 1};
+   const double endVelocities[] = {0, 0.1, 0.5};
+   const double startAccels[] = {-0.5, -0.1, 0, 0.1, 0.5};
+   const double endAccels[] = {0, 0.2};
+   const double jerks[] = {0.1, 0.4, 1, 5};
+
+   std::vector<BoundaryConditions, Eigen::aligned_allocator<BoundaryConditions>> grid;
+   for (double distance : distances)
+      for (double v0 : startVelocities)
+         for (double vf : endVelocities)
+            for (double a0 : startAccels)
+               for (double af : endAccels)
+                  for (double jerk : jerks)
+                  {
+                     BoundaryConditions bc;
+                     bc.start << 0, v0, a0, jerk;
+                     bc.end << distance, vf, af, jerk;
+                     grid.push_back(bc);
+                  }
+   return grid;
+}
+
+// Counts its live instances (arena destruction check)
+struct LiveCounter
+{
+   static int live;
+   LiveCounter()
+   {
+      live++;
+   }
+   ~LiveCounter()
+   {
+      live--;
+   }
+};
+int LiveCounter::live = 0;
+
+// Goal sequence: distances up to 6.5 m (beyond max_xy_distance, so both simultaneous and long trajectories), with turns
+void makeGoal(int goal, Eigen::Vector3d &position, Eigen::Quaterniond &quaternion)
+{
+   double radius = 0.5 + (goal % 7);
+   position << radius * cos(0.9 * goal), radius * sin(0.9 * goal), 0.3 * sin(0.5 * goal);
+   quaternion = auv_core::rot3d::rpy2Quat(0, 0, 0.7 * goal);
+}
+
+// Check Reporter
+// Every benchmark checks the behavior it times with check(), which prints and records each failure. main() returns 1 if
+// any check failed.
+std::vector<std::string> failedChecks;
+
+/**
+ * @param name Description of what is checked, e.g. "MinJerkTimeCache: evicts the least recently used entries"
+ * @param passed Result of the check
+ * \brief Record the result of a check, and print it if it failed. Returns passed.
+ */
+bool check(const std::string &name, bool passed)
+{
+   if (!passed)
+   {
+      std::cout << "   FAILED: " << name << std::endl;
+      failedChecks.push_back(name);
+   }
+   return passed;
+}
+
+// Benchmark Context
+// Inputs shared by the benchmarks: the grid of boundary conditions with the durations both solvers find for them, and
+// the trajectory limits (guidance_controller.yaml) the goals are planned with
+struct BenchmarkContext
+{
+   int repetitions;
+   std::vector<BoundaryConditions, Eigen::aligned_allocator<BoundaryConditions>> grid;
+   std::vector<double> ceresTimes, analyticTimes;
+   auv_guidance::TGenLimits tGenLimits;
+
+   BenchmarkContext(int repetitions)
+       : repetitions(repetitions), grid(makeGrid()),
+         tGenLimits(3.0, 1.0, 1.40, 0.1, 0.1, 0.75, 0.4, 0.3, 1.57, 0.4, 0.4, 0.2, 3.14, 0.4, 1.0, 5.0, 6.0)
+   {
+   }
+};
+
+/**
+ * \brief Min jerk time solver: analytic vs. Ceres on the grid (boundary conditions as given, both solvers perturb v0
+ * rest to rest, see MinJerkTimeSolver), compared on the equation both solve, then the solve time of each
+ */
+void benchTimeSolver(BenchmarkContext &context)
+{
+   const std::vector<BoundaryConditions, Eigen::aligned_allocator<BoundaryConditions>> &grid = context.grid;
+   context.ceresTimes.resize(grid.size());
+   context.analyticTimes.resize(grid.size());
+   for (size_t i = 0; i < grid.size(); i++)
+   {
+      context.ceresTimes[i] = auv_guidance::MinJerkTimeSolver(grid[i].start, grid[i].end, auv_guidance::MinJerkTimeSolver::SOLVER_CERES).getTime();
+      context.analyticTimes[i] = auv_guidance::MinJerkTimeSolver(grid[i].start, grid[i].end).getTime();
+   }
+
+   int mismatches = 0, ceresFailures = 0, compared = 0;
+   double maxRelativeDifference = 0, maxError = 0;
+   for (size_t i = 0; i < grid.size(); i++)
+   {
+      double ceresTime = context.ceresTimes[i], analyticTime = context.analyticTimes[i];
+      double distance = fabs(grid[i].end(0) - grid[i].start(0));
+      double tolerance = 1e-9 * std::max(1.0, distance);
+      double ceresError = fabs(auv_guidance::MinJerkTimeSolver::computeDistanceError(grid[i].start, grid[i].end, ceresTime));
+      double analyticError = fabs(auv_guidance::MinJerkTimeSolver::computeDistanceError(grid[i].start, grid[i].end, analyticTime));
+      maxError = std::max(maxError, analyticError);
+
+      // Wherever Ceres converges, both durations must agree. If the error is increasing in the duration (a0 >= af, so
+      // every coefficient is positive), there is exactly one root, and Ceres must converge to it.
+      bool ceresSolved = (ceresError <= tolerance);
+      bool unique = (grid[i].start(2) >= grid[i].end(2)) && distance > 0;
+      bool worse = (analyticError > ceresError + tolerance);
+      bool differs = ceresSolved && (fabs(analyticTime - ceresTime) > 1e-6 * std::max(1.0, ceresTime));
+      if (ceresSolved)
+      {
+         compared++;
+         maxRelativeDifference = std::max(maxRelativeDifference, fabs(analyticTime - ceresTime) / std::max(1.0, ceresTime));
+      }
+      else if (unique)
+      {
+         ceresFailures++;
+      }
+
+      if (worse || differs || (!ceresSolved && unique))
+      {
+         if (mismatches < 10)
+            std::cout << "Mismatch: start [" << grid[i].start.transpose() << "] end [" << grid[i].end.transpose()
+                      << "] Ceres " << ceresTime << " s (error " << ceresError << "), analytic " << analyticTime
+                      << " s (error " << analyticError << ")" << std::endl;
+         mismatches++;
+      }
+   }
+
+   std::cout << "MinJerkTimeSolver: " << grid.size() << " boundary conditions, " << compared << " solved by Ceres, "
+             << ceresFailures << " Ceres failures with a unique root, " << mismatches << " mismatches, max |error| "
+             << maxError << " m, max relative difference to Ceres " << maxRelativeDifference << std::endl;
+   check("MinJerkTimeSolver: analytic and Ceres durations agree", mismatches == 0);
+   check("MinJerkTimeSolver: Ceres converges somewhere on the grid", compared > 0);
+
+   double sink = 0;
+   std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+   for (int r = 0; r < context.repetitions; r++)
+      for (size_t i = 0; i < grid.size(); i++)
+         sink += auv_guidance::MinJerkTimeSolver(grid[i].start, grid[i].end, auv_guidance::MinJerkTimeSolver::SOLVER_CERES).getTime();
+   double ceresMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+   begin = std::chrono::steady_clock::now();
+   for (int r = 0; r < context.repetitions; r++)
+      for (size_t i = 0; i < grid.size(); i++)
+         sink += auv_guidance::MinJerkTimeSolver(grid[i].start, grid[i].end).getTime();
+   double analyticMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+   double solves = (double)context.repetitions * grid.size();
+   std::cout << "MinJerkTimeSolver (Ceres): " << ceresMicros / solves << " us/solve" << std::endl;
+   std::cout << "MinJerkTimeSolver (analytic): " << analyticMicros / solves << " us/solve ("
+             << ceresMicros / std::max(analyticMicros, 1e-9) << "x faster)" << std::endl;
+   if (sink == 0)
+      std::cout << std::endl; // Keeps the solves from being optimized away
+}
+
+/**
+ * \brief Min jerk time cache: durations and hit/miss counts, LRU eviction, and threads sharing a cache, then the time
+ * of a hit
+ */
+void benchTimeCache(BenchmarkContext &context)
+{
+   const std::vector<BoundaryConditions, Eigen::aligned_allocator<BoundaryConditions>> &grid = context.grid;
+   const std::vector<double> &analyticTimes = context.analyticTimes;
+
+   // Every query of the first pass is a miss, every query of the second pass a hit, with the solver's durations (the
+   // grid values are multiples of the resolution)
+   auv_guidance::MinJerkTimeCache cache(2 * grid.size());
+   int cacheMismatches = 0;
+   for (int pass = 0; pass < 2; pass++)
+   {
+      for (size_t i = 0; i < grid.size(); i++)
+      {
+         double time = cache.getTime(grid[i].start, grid[i].end);
+         if (fabs(time - analyticTimes[i]) > 1e-9 * std::max(1.0, analyticTimes[i]))
+            cacheMismatches++;
+      }
+   }
+   bool cacheCounted = (cache.getMisses() == grid.size() && cache.getHits() == grid.size() && cache.getEvictions() == 0 &&
+                        cache.size() == grid.size());
+   std::cout << "MinJerkTimeCache: " << cacheMismatches << " mismatches, " << cache.getHits() << " hits, "
+             << cache.getMisses() << " misses (expected " << grid.size() << " each)" << std::endl;
+   check("MinJerkTimeCache: durations match the solver", cacheMismatches == 0);
+   check("MinJerkTimeCache: counts hits and misses", cacheCounted);
+
+   // Eviction: a full cache keeps the most recently used entries
+   const size_t smallCapacity = 100;
+   auv_guidance::MinJerkTimeCache smallCache(smallCapacity);
+   for (size_t i = 0; i < grid.size(); i++)
+      smallCache.getTime(grid[i].start, grid[i].end);
+   smallCache.resetStatistics();
+   smallCache.getTime(grid[grid.size() - smallCapacity].start, grid[grid.size() - smallCapacity].end); // Oldest kept
+   smallCache.getTime(grid[grid.size() - smallCapacity - 1].start, grid[grid.size() - smallCapacity - 1].end); // Evicted
+   bool evicted = (smallCache.size() == smallCapacity && smallCache.getHits() == 1 && smallCache.getMisses() == 1 &&
+                   smallCache.getEvictions() == 1);
+   std::cout << "MinJerkTimeCache (capacity " << smallCapacity << "): " << smallCache.getEvictions() << " evictions" << std::endl;
+   check("MinJerkTimeCache: evicts the least recently used entries", evicted);
+
+   // Threads sharing a cache smaller than the grid (concurrent hits, misses, and evictions)
+   const int numThreads = 4;
+   auv_guidance::MinJerkTimeCache sharedCache(grid.size() / 2);
+   std::vector<int> threadMismatches(numThreads, 0);
+   std::vector<std::thread> threads;
+   for (int t = 0; t < numThreads; t++)
+   {
+      threads.push_back(std::thread([&, t]() {
+         for (int pass = 0; pass < 3; pass++)
+         {
+            for (size_t k = 0; k < grid.size(); k++)
+            {
+               size_t i = (k * (t + 1) + pass) % grid.size();
+               double time = sharedCache.getTime(grid[i].start, grid[i].end);
+               if (fabs(time - analyticTimes[i]) > 1e-9 * std::max(1.0, analyticTimes[i]))
+                  threadMismatches[t]++;
+            }
+         }
+      }));
+   }
+   for (int t = 0; t < numThreads; t++)
+      threads[t].join();
+   int concurrentMismatches = 0;
+   for (int t = 0; t < numThreads; t++)
+      concurrentMismatches += threadMismatches[t];
+   bool concurrentCounted = (sharedCache.getHits() + sharedCache.getMisses() == (uint64_t)numThreads * 3 * grid.size() &&
+                             sharedCache.size() <= sharedCache.getCapacity());
+   std::cout << "MinJerkTimeCache (" << numThreads << " threads): " << concurrentMismatches << " mismatches, hit rate "
+             << sharedCache.getHitRate() << std::endl;
+   check("MinJerkTimeCache (threads): durations match the solver", concurrentMismatches == 0);
+   check("MinJerkTimeCache (threads): counts every query, stays within its capacity", concurrentCounted);
+
+   double sink = 0;
+   std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+   for (int r = 0; r < context.repetitions; r++)
+      for (size_t i = 0; i < grid.size(); i++)
+         sink += cache.getTime(grid[i].start, grid[i].end);
+   double cachedMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+   std::cout << "MinJerkTimeCache (hit): " << cachedMicros / ((double)context.repetitions * grid.size()) << " us/query" << std::endl;
+   if (sink == 0)
+      std::cout << std::endl; // Keeps the queries from being optimized away
+}
+
+/**
+ * \brief Trajectory arena: one arena planning a sequence of goals, reset between goals. Its objects must be destroyed on
+ * reset, and it must not keep growing.
+ */
+void benchArena(BenchmarkContext &context)
+{
+   auv_guidance::TrajectoryArena arena;
+   const int numGoals = 200;
+   size_t maxObjects = 0, maxBytesUsed = 0, reservedAfterFirst = 0;
+   int invalidTrajectories = 0, growingGoals = 0;
+   double planMicros = 0;
+   Eigen::Vector3d zero3d = Eigen::Vector3d::Zero();
+   for (int goal = 0; goal < numGoals; goal++)
+   {
+      Eigen::Vector3d endPosition;
+      Eigen::Quaterniond endQuaternion;
+      makeGoal(goal, endPosition, endQuaternion);
+
+      std::chrono::steady_clock::time_point planStart = std::chrono::steady_clock::now();
+      arena.reset();
+      auv_guidance::Waypoint *start = arena.create<auv_guidance::Waypoint>(zero3d, zero3d, zero3d, Eigen::Quaterniond::Identity(), zero3d);
+      auv_guidance::Waypoint *end = arena.create<auv_guidance::Waypoint>(endPosition, zero3d, zero3d, endQuaternion, zero3d);
+      auv_guidance::BasicTrajectory *trajectory = arena.create<auv_guidance::BasicTrajectory>(start, end, &context.tGenLimits, &arena);
+      planMicros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - planStart).count();
+
+      // Ends at the goal
+      auv_guidance::Vector13d finalState = trajectory->computeState(trajectory->getTime());
+      if (!(trajectory->getTime() > 0) || !finalState.allFinite() || (finalState.head<3>() - endPosition).norm() > 1e-3)
+         invalidTrajectories++;
+
+      maxObjects = std::max(maxObjects, arena.getNumObjects());
+      maxBytesUsed = std::max(maxBytesUsed, arena.getBytesUsed());
+      if (goal == 0)
+         reservedAfterFirst = arena.getBytesReserved();
+      else if (arena.getBytesReserved() > std::max(reservedAfterFirst, (size_t)auv_guidance::TrajectoryArena::DEFAULT_BLOCK_SIZE))
+         growingGoals++;
+   }
+
+   arena.reset();
+   for (int i = 0; i < 10; i++)
+      arena.create<LiveCounter>();
+   int liveBeforeReset = LiveCounter::live;
+   arena.reset();
+   int liveAfterReset = LiveCounter::live;
+   size_t blocksAfterReset = arena.getNumBlocks();
+   arena.release();
+   bool destroyed = (liveBeforeReset == 10 && liveAfterReset == 0 && blocksAfterReset > 0 && arena.getNumBlocks() == 0);
+
+   std::cout << "TrajectoryArena: " << numGoals << " goals, " << invalidTrajectories << " invalid, up to " << maxObjects
+             << " objects in " << maxBytesUsed << " bytes per trajectory, " << growingGoals << " goals grew the arena, "
+             << planMicros / numGoals << " us/goal" << std::endl;
+   check("TrajectoryArena: every trajectory ends at its goal", invalidTrajectories == 0);
+   check("TrajectoryArena: does not grow after the first goal", growingGoals == 0);
+   check("TrajectoryArena: destroys its objects on reset and releases its blocks", destroyed);
+}
+
+/**
+ * \brief Compiled trajectories: same states and accelerations as the BasicTrajectory (starting in motion, so with a stop
+ * trajectory), sampled densely from before the start to after the end, including the segment boundaries, then the
+ * evaluation time of each
+ */
+void benchCompiled(BenchmarkContext &context)
+{
+   auv_guidance::TrajectoryArena arena;
+   auv_guidance::CompiledTrajectory compiled;
+   const int numGoals = 200;
+   int uncompiled = 0, compiledMismatches = 0;
+   long samples = 0;
+   double maxStateDifference = 0, maxAccelDifference = 0, basicEvalMicros = 0, compiledEvalMicros = 0;
+   std::vector<double> times;
+   Eigen::Vector3d zero3d = Eigen::Vector3d::Zero();
+   for (int goal = 0; goal < numGoals; goal++)
+   {
+      Eigen::Vector3d endPosition;
+      Eigen::Quaterniond endQuaternion;
+      makeGoal(goal, endPosition, endQuaternion);
+      Eigen::Vector3d startVelocity(0.3 * sin(1.3 * goal), 0.2 * cos(1.3 * goal), 0.05 * sin(0.7 * goal));
+      Eigen::Vector3d startAccel(0.05 * cos(goal), 0.0, 0.02);
+      Eigen::Vector3d startAngVel(0.0, 0.0, 0.3 * sin(0.4 * goal));
+
+      arena.reset();
+      auv_guidance::Waypoint *start = arena.create<auv_guidance::Waypoint>(zero3d, startVelocity, startAccel,
+                                                                           Eigen::Quaterniond::Identity(), startAngVel);
+      auv_guidance::Waypoint *end = arena.create<auv_guidance::Waypoint>(endPosition, zero3d, zero3d, endQuaternion, zero3d);
+      auv_guidance::BasicTrajectory *trajectory = arena.create<auv_guidance::BasicTrajectory>(start, end, &context.tGenLimits, &arena);
+      compiled.clear();
+      if (!trajectory->compile(compiled))
+      {
+         uncompiled++;
+         continue;
+      }
+
+      double duration = trajectory->getTime();
+      times.clear();
+      for (int i = -50; i <= 1100; i++)
+         times.push_back(duration * i / 1000.0);
+      for (int i = 0; i < compiled.getNumSegments(); i++)
+         times.push_back(compiled.getSegmentStartTime(i));
+
+      for (size_t i = 0; i < times.size(); i++)
+      {
+         auv_guidance::Vector13d basicState = trajectory->computeState(times[i]);
+         auv_guidance::Vector6d basicAccel = trajectory->computeAccel(times[i]);
+         auv_guidance::Vector13d compiledState = compiled.computeState(times[i]);
+         auv_guidance::Vector6d compiledAccel = compiled.computeAccel(times[i]);
+         // q and -q are the same attitude (SimultaneousTrajectory's slerp may end at -qEnd, then switches to qEnd)
+         if ((basicState.segment<4>(6) + compiledState.segment<4>(6)).norm() < (basicState.segment<4>(6) - compiledState.segment<4>(6)).norm())
+            compiledState.segment<4>(6) *= -1.0;
+         double stateDifference = (basicState - compiledState).cwiseAbs().maxCoeff();
+         double accelDifference = (basicAccel - compiledAccel).cwiseAbs().maxCoeff();
+         maxStateDifference = std::max(maxStateDifference, stateDifference);
+         maxAccelDifference = std::max(maxAccelDifference, accelDifference);
+         if (!(stateDifference <= 1e-9 && accelDifference <= 1e-9))
+            compiledMismatches++;
+         samples++;
+      }
+
+      // Evaluation time (both return the state and accelerations of each sample)
+      double sum = 0;
+      std::chrono::steady_clock::time_point evalStart = std::chrono::steady_clock::now();
+      for (int r = 0; r < context.repetitions; r++)
+         for (size_t i = 0; i < times.size(); i++)
+            sum += trajectory->computeState(times[i])(0) + trajectory->computeAccel(times[i])(0);
+      basicEvalMicros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - evalStart).count();
+      evalStart = std::chrono::steady_clock::now();
+      for (int r = 0; r < context.repetitions; r++)
+         for (size_t i = 0; i < times.size(); i++)
+            sum += compiled.computeState(times[i])(0) + compiled.computeAccel(times[i])(0);
+      compiledEvalMicros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - evalStart).count();
+      if (sum == 0)
+         std::cout << std::endl; // Keeps the evaluations from being optimized away
+   }
+   arena.release();
+
+   std::cout << "CompiledTrajectory: " << numGoals << " goals, " << uncompiled << " did not compile, " << compiledMismatches
+             << " of " << samples << " samples differ, max difference " << maxStateDifference << " (state), "
+             << maxAccelDifference << " (accel)" << std::endl;
+   double evaluations = (double)context.repetitions * samples;
+   std::cout << "BasicTrajectory evaluation: " << basicEvalMicros / evaluations << " us/sample" << std::endl;
+   std::cout << "CompiledTrajectory evaluation: " << compiledEvalMicros / evaluations << " us/sample ("
+             << basicEvalMicros / std::max(compiledEvalMicros, 1e-9) << "x faster)" << std::endl;
+   check("CompiledTrajectory: every trajectory compiles", uncompiled == 0);
+   check("CompiledTrajectory: matches the BasicTrajectory", compiledMismatches == 0);
+}
+
+/**
+ * \brief Long trajectory cursor: from any hint, the segment lookup finds the segment a linear scan over the segment start
+ * times finds, and cursors swept forward or in random order evaluate like the stateless lookup and the compiled
+ * trajectory
+ */
+void benchCursor(BenchmarkContext &context)
+{
+   auv_guidance::TrajectoryArena arena;
+   auv_guidance::CompiledTrajectory compiled;
+   const int numGoals = 200;
+   int uncompiled = 0, lookupMismatches = 0, statelessMismatches = 0, cursorMismatches = 0;
+   long lookups = 0, cursorSamples = 0;
+   unsigned int shuffleState = 12345;
+   std::vector<double> times;
+   Eigen::Vector3d zero3d = Eigen::Vector3d::Zero();
+   for (int goal = 0; goal < numGoals; goal++)
+   {
+      Eigen::Vector3d endPosition;
+      Eigen::Quaterniond endQuaternion;
+      makeGoal(goal, endPosition, endQuaternion);
+      endPosition += 2.0 * endPosition.normalized(); // At least 2.5 m (a long trajectory)
+
+      arena.reset();
+      auv_guidance::Waypoint *start = arena.create<auv_guidance::Waypoint>(zero3d, zero3d, zero3d, Eigen::Quaterniond::Identity(), zero3d);
+      auv_guidance::Waypoint *end = arena.create<auv_guidance::Waypoint>(endPosition, zero3d, zero3d, endQuaternion, zero3d);
+      auv_guidance::LongTrajectory *trajectory = arena.create<auv_guidance::LongTrajectory>(start, end, &context.tGenLimits, 0.5, 0.5, &arena);
+      compiled.clear();
+      if (!trajectory->compile(compiled, 0) || compiled.getNumSegments() != trajectory->getNumSegments())
+      {
+         uncompiled++;
+         continue;
+      }
+
+      int numSegments = trajectory->getNumSegments();
+      double duration = trajectory->getTime();
+      times.clear();
+      for (int i = -50; i <= 1100; i++)
+         times.push_back(duration * i / 1000.0);
+      for (int i = 0; i < numSegments; i++)
+         times.push_back(compiled.getSegmentStartTime(i));
+      std::sort(times.begin(), times.end());
+
+      for (size_t i = 0; i < times.size(); i++)
+      {
+         int expected = numSegments - 1;
+         for (int j = 0; j < numSegments - 1; j++)
+         {
+            if (times[i] < compiled.getSegmentStartTime(j + 1))
+            {
+               expected = j;
+               break;
+            }
+         }
+         for (int hint = -1; hint <= numSegments; hint++)
+         {
+            if (trajectory->findSegment(times[i], hint) != expected)
+               lookupMismatches++;
+            lookups++;
+         }
+      }
+
+      // Forward sweep, then the same times in random order
+      for (int pass = 0; pass < 2; pass++)
+      {
+         if (pass == 1)
+         {
+            for (size_t i = times.size() - 1; i > 0; i--)
+            {
+               shuffleState = shuffleState * 1103515245 + 12345;
+               std::swap(times[i], times[(shuffleState >> 8) % (i + 1)]);
+            }
+         }
+         auv_guidance::LongTrajectoryCursor cursor(trajectory);
+         for (size_t i = 0; i < times.size(); i++)
+         {
+            auv_guidance::Vector13d cursorState = cursor.computeState(times[i]);
+            auv_guidance::Vector6d cursorAccel = cursor.computeAccel(times[i]);
+            if (!(trajectory->computeState(times[i]) == cursorState && trajectory->computeAccel(times[i]) == cursorAccel))
+               statelessMismatches++;
+            auv_guidance::Vector13d compiledState = compiled.computeState(times[i]);
+            auv_guidance::Vector6d compiledAccel = compiled.computeAccel(times[i]);
+            if ((cursorState.segment<4>(6) + compiledState.segment<4>(6)).norm() < (cursorState.segment<4>(6) - compiledState.segment<4>(6)).norm())
+               compiledState.segment<4>(6) *= -1.0;
+            if (!((cursorState - compiledState).cwiseAbs().maxCoeff() <= 1e-9 && (cursorAccel - compiledAccel).cwiseAbs().maxCoeff() <= 1e-9))
+               cursorMismatches++;
+            cursorSamples++;
+         }
+      }
+   }
+   arena.release();
+
+   std::cout << "LongTrajectoryCursor: " << lookupMismatches << " of " << lookups << " segment lookups differ from a linear scan, "
+             << cursorMismatches << " of " << cursorSamples << " samples differ from the compiled trajectory, "
+             << statelessMismatches << " from the stateless lookup" << std::endl;
+   check("LongTrajectory: every trajectory compiles to its segments", uncompiled == 0);
+   check("LongTrajectory::findSegment: matches a linear scan from any hint", lookupMismatches == 0);
+   check("LongTrajectoryCursor: matches the stateless computeState/computeAccel", statelessMismatches == 0);
+   check("LongTrajectoryCursor: matches the compiled trajectory", cursorMismatches == 0);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+   BenchmarkContext context((argc > 1) ? std::max(1, atoi(argv[1])) : 10);
+   std::cout << std::setprecision(4);
+
+   benchTimeSolver(context);
+   benchTimeCache(context);
+   benchArena(context);
+   benchCompiled(context);
+   benchCursor(context);
+
+   std::cout << failedChecks.size() << " checks failed" << std::endl;
+   for (size_t i = 0; i < failedChecks.size(); i++)
+      std::cout << "   " << failedChecks[i] << std::endl;
+   return failedChecks.empty() ? 0 : 1;
+}
@@ -6,12 +6,14 @@ namespace auv_guidance
  * @param start Starting waypoint
  * @param end Ending waypoint
  * @param travelDuration Desired travel duration [s]
+ * @param arena Arena that owns the waypoints and segments (the trajectory itself is usually created in it too)
  */
-BasicTrajectory::BasicTrajectory(Waypoint *wStart, Waypoint *wEnd, TGenLimits *tGenLimits)
+BasicTrajectory::BasicTrajectory(Waypoint *wStart, Waypoint *wEnd, TGenLimits *tGenLimits, TrajectoryArena *arena)
 {
     wStart_ = wStart;
     wEnd_ = wEnd;
     tGenLimits_ = tGenLimits;
+    arena_ = arena;
 
     qStop_.setIdentity();
     deltaVec_.setZero();
@@ -65,7 +67,7 @@ void BasicTrajectory::setStopTrajectory()
     qStop_ = wStart_->quaternion() * qRotate;                                         // Apply qRotate FROM qStart
 
     Eigen::Vector3d zero3d = Eigen::Vector3d::Zero();
-    wStop_ = new Waypoint(stopPos, zero3d, zero3d, qStop_, zero3d);
+    wStop_ = arena_->create<Waypoint>(stopPos, zero3d, zero3d, qStop_, zero3d);
 
     // Find travel time for translation and rotation, take the longer one
     Eigen::Vector4d transStart = Eigen::Vector4d::Zero();
@@ -78,15 +80,11 @@ void BasicTrajectory::setStopTrajectory()
     rotStart << 0, angVel, 0, tGenLimits_->rotJerk(angularDistance);
     rotEnd << angularDistance, 0, 0, tGenLimits_->rotJerk(angularDistance);
 
-    double timeTrans = 0, timeRot = 0;
-    MinJerkTimeSolver *mjts;
-    mjts = new MinJerkTimeSolver(transStart, transEnd);
-    timeTrans = mjts->getTime();
-    mjts = new MinJerkTimeSolver(rotStart, rotEnd);
-    timeRot = mjts->getTime();
+    double timeTrans = MinJerkTimeCache::shared().getTime(transStart, transEnd);
+    double timeRot = MinJerkTimeCache::shared().getTime(rotStart, rotEnd);
     stopDuration_ = std::max(timeTrans, timeRot); // Take longer duration
 
-    stStop_ = new SimultaneousTrajectory(wStart_, wStop_, stopDuration_);
+    stStop_ = arena_->create<SimultaneousTrajectory>(wStart_, wStop_, stopDuration_, arena_);
     totalDuration_ = stopDuration_;
 }
 
@@ -102,12 +100,12 @@ void BasicTrajectory::computeMaxVelocity()
     if (distanceXY > tGenLimits_->maxXYDistance())
     {
         simultaneousTrajectory_ = false;
-        std::cout << "BT: dixtance XY too large: " << distanceXY << " > " << tGenLimits_->maxXYDistance() << std::endl; // Debug
+        AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT: distance XY too large: %g > %g", distanceXY, tGenLimits_->maxXYDistance());
     }
     if (distanceZ > tGenLimits_->maxZDistance())
     {
         simultaneousTrajectory_ = false;
-        std::cout << "BT: dixtance Z too large: " << distanceZ << " > " << tGenLimits_->maxZDistance() << std::endl; // Debug
+        AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT: distance Z too large: %g > %g", distanceZ, tGenLimits_->maxZDistance());
     }
 
     BasicTrajectory::computeSimultaneousTime();
@@ -116,7 +114,7 @@ void BasicTrajectory::computeMaxVelocity()
     Eigen::Vector3d transStart = Eigen::Vector3d::Zero();
     Eigen::Vector3d transEnd = Eigen::Vector3d::Zero();
     transEnd(0) = distance_;
-    mjtHelper_ = new MinJerkTrajectory(transStart, transEnd, simultaneousDuration_);
+    mjtHelper_ = arena_->create<MinJerkTrajectory>(transStart, transEnd, simultaneousDuration_);
 
     initialMaxVelocity_ = fabs(mjtHelper_->getMiddleVelocity());
     maxVelocity_ = initialMaxVelocity_;
@@ -142,15 +140,11 @@ void BasicTrajectory::computeSimultaneousTime()
     rotEnd << angularDistance, 0, 0, tGenLimits_->rotJerk(angularDistance);
 
     // Compute durations
-    double timeTrans = 0, timeRot = 0;
-    MinJerkTimeSolver *mjts;
-    mjts = new MinJerkTimeSolver(transStart, transEnd);
-    timeTrans = mjts->getTime();
-    mjts = new MinJerkTimeSolver(rotStart, rotEnd);
-    timeRot = mjts->getTime();
+    double timeTrans = MinJerkTimeCache::shared().getTime(transStart, transEnd);
+    double timeRot = MinJerkTimeCache::shared().getTime(rotStart, rotEnd);
 
     simultaneousDuration_ = std::max(timeTrans, timeRot); // Take longer duration
-    std::cout << "BT: simultaneous duration: " << simultaneousDuration_ << std::endl; // Debug
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT: simultaneous duration: %g", simultaneousDuration_);
 }
 
 void BasicTrajectory::setPrimaryTrajectory()
@@ -164,13 +158,13 @@ void BasicTrajectory::setPrimaryTrajectory()
     if (maxXYVel > tGenLimits_->maxXVel())
     {
         simultaneousTrajectory_ = false;
-        std::cout << "BT: max XY velocity too large: " << maxXYVel <<  " > " << tGenLimits_->maxXVel() << std::endl; // Debug
+        AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT: max XY velocity too large: %g > %g", maxXYVel, tGenLimits_->maxXVel());
         maxXYVel = tGenLimits_->maxXVel();
     }
     if (maxZVel > tGenLimits_->maxZVel())
     {
         simultaneousTrajectory_ = false;
-        std::cout << "BT: max Z velocity too large: " << maxZVel << " > " << tGenLimits_->maxZVel() << std::endl; // Debug
+        AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT: max Z velocity too large: %g > %g", maxZVel, tGenLimits_->maxZVel());
         maxZVel = tGenLimits_->maxZVel();
     }
 
@@ -182,18 +176,18 @@ void BasicTrajectory::setPrimaryTrajectory()
     {
         longTrajectory_ = true;
         double cruiseRatio = 1.0 - maxVelocity_ / initialMaxVelocity_;
-        ltPrimary_ = new LongTrajectory(wStop_, wEnd_, tGenLimits_, cruiseRatio, maxVelocity_);
+        ltPrimary_ = arena_->create<LongTrajectory>(wStop_, wEnd_, tGenLimits_, cruiseRatio, maxVelocity_, arena_);
         longDuration_ = ltPrimary_->getTime();
         totalDuration_ += longDuration_;
     }
     else // Execute simultaneous trajectory
     {
         simultaneousTrajectory_ = true;
-        stPrimary_ = new SimultaneousTrajectory(wStop_, wEnd_, simultaneousDuration_);
+        stPrimary_ = arena_->create<SimultaneousTrajectory>(wStop_, wEnd_, simultaneousDuration_, arena_);
         totalDuration_ = simultaneousDuration_;
     }
-    std::cout << "BT long trajectory " << longTrajectory_ << std::endl; // Debug
-    std::cout << "BT simultaneous trajectory " << simultaneousTrajectory_ << std::endl; // Debug
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT long trajectory %d", longTrajectory_);
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "BT simultaneous trajectory %d", simultaneousTrajectory_);
 }
 
 double BasicTrajectory::getTime()
@@ -209,12 +203,10 @@ Vector13d BasicTrajectory::computeState(double time)
 {
     if (time <= stopDuration_)
     {
-        //std::cout << "ST: stop trajectory at time " << time << std::endl;
         return stStop_->computeState(time);
     }
     else if (simultaneousTrajectory_)
     {
-        //std::cout << "ST: main trajectory at time " << time - stopDuration_ << std::endl;
         return stPrimary_->computeState(time - stopDuration_);
     }
     else if (longTrajectory_)
@@ -243,4 +235,18 @@ Vector6d BasicTrajectory::computeAccel(double time)
         return ltPrimary_->computeAccel(time - stopDuration_);
     }
 }
+
+/**
+ * @param compiled Compiled trajectory to append the segments to (usually empty)
+ * @param startTime Time at which this trajectory starts in the compiled trajectory [s]
+ * \brief Flatten the stop and primary trajectories into the compiled trajectory
+ */
+bool BasicTrajectory::compile(CompiledTrajectory &compiled, double startTime)
+{
+    if (!stStop_->compile(compiled, startTime))
+        return false;
+    if (longTrajectory_)
+        return ltPrimary_->compile(compiled, startTime + stopDuration_);
+    return stPrimary_->compile(compiled, startTime + stopDuration_);
+}
 } // namespace auv_guidance
\ No newline at end of file
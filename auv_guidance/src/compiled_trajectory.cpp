@@ -0,0 +1,279 @@
+#include "auv_guidance/compiled_trajectory.hpp"
+#include <algorithm>
+
+namespace auv_guidance
+{
+CompiledTrajectory::CompiledTrajectory()
+{
+    CompiledTrajectory::clear();
+}
+
+/**
+ * \brief Remove all segments
+ */
+void CompiledTrajectory::clear()
+{
+    numSegments_ = 0;
+    duration_ = 0;
+    for (int i = 0; i < MAX_SEGMENTS; i++)
+    {
+        startTimes_[i] = 0;
+        endTimes_[i] = HUGE_VAL;
+        durations_[i] = 0;
+        invDurations_[i] = 0;
+    }
+}
+
+/**
+ * @param startTime Start time of the segment [s]
+ * @param duration Duration of the segment [s]
+ * \brief Returns the index of a new segment after the existing ones, with its timing set (-1 if there are already
+ * MAX_SEGMENTS segments)
+ */
+int CompiledTrajectory::appendSegment(double startTime, double duration)
+{
+    if (numSegments_ >= MAX_SEGMENTS)
+        return -1;
+
+    int segment = numSegments_++;
+    duration = std::max(duration, 0.0);
+    if (segment > 0)
+        endTimes_[segment - 1] = startTimes_[segment - 1] + durations_[segment - 1]; // No longer the last segment
+    startTimes_[segment] = startTime;
+    endTimes_[segment] = HUGE_VAL;
+    durations_[segment] = duration;
+    invDurations_[segment] = (duration > 0) ? 1.0 / duration : 0.0; // Zero duration: only the initial state
+    duration_ = std::max(duration_, startTime + duration);
+    return segment;
+}
+
+/**
+ * @param startTime Start time of the segment [s]
+ * @param duration Duration of the segment [s]
+ * @param mjt Min jerk trajectories of x, y, z, and the attitude angle, over the segment
+ * @param qStart Initial attitude
+ * @param qEnd Final attitude (qStart if the segment does not rotate)
+ * @param rotationAxis Axis of the attitude angle wrt B-frame
+ * \brief Append a segment. Returns false if there are already MAX_SEGMENTS segments.
+ */
+bool CompiledTrajectory::addSegment(double startTime, double duration, MinJerkTrajectory *mjt[NUM_AXES],
+                                    const Eigen::Quaterniond &qStart, const Eigen::Quaterniond &qEnd,
+                                    const Eigen::Ref<const Eigen::Vector3d> &rotationAxis)
+{
+    int segment = CompiledTrajectory::appendSegment(startTime, duration);
+    if (segment < 0)
+        return false;
+
+    double dt = durations_[segment], dt2 = dt * dt;
+    for (int axis = 0; axis < NUM_AXES; axis++)
+    {
+        Eigen::Matrix<double, 6, 1> c = mjt[axis]->getCoeffs();
+        for (int k = 0; k < 6; k++)
+            position_[axis][k][segment] = c(k);
+
+        if (dt > 0)
+        {
+            for (int k = 0; k < 5; k++)
+                velocity_[axis][k][segment] = (k + 1) * c(k + 1) / dt;
+            for (int k = 0; k < 4; k++)
+                accel_[axis][k][segment] = (k + 2) * (k + 1) * c(k + 2) / dt2;
+        }
+        else
+        {
+            // Zero duration: only evaluated at its start, where MinJerkTrajectory returns the initial conditions
+            Eigen::Vector3d initial = mjt[axis]->computeState(0);
+            for (int k = 0; k < 6; k++)
+                position_[axis][k][segment] = (k == 0) ? initial(0) : 0.0;
+            for (int k = 0; k < 5; k++)
+                velocity_[axis][k][segment] = (k == 0) ? initial(1) : 0.0;
+            for (int k = 0; k < 4; k++)
+                accel_[axis][k][segment] = (k == 0) ? initial(2) : 0.0;
+        }
+    }
+
+    // Slerp weights, as computed by Eigen::QuaternionBase::slerp
+    Eigen::Quaterniond q0 = qStart.normalized(), q1 = qEnd.normalized();
+    double d = q0.dot(q1), absD = fabs(d);
+    slerpLinear_[segment] = (absD >= 1.0 - Eigen::NumTraits<double>::epsilon()) ? 1.0 : 0.0;
+    slerpTheta_[segment] = (slerpLinear_[segment] > 0) ? 0.0 : acos(absD);
+    slerpInvSinTheta_[segment] = (slerpLinear_[segment] > 0) ? 0.0 : 1.0 / sin(slerpTheta_[segment]);
+    slerpCotTheta_[segment] = cos(slerpTheta_[segment]) * slerpInvSinTheta_[segment];
+    slerpSign_[segment] = (d < 0) ? -1.0 : 1.0;
+    qStart_[0][segment] = q0.w(), qStart_[1][segment] = q0.x(), qStart_[2][segment] = q0.y(), qStart_[3][segment] = q0.z();
+    qEnd_[0][segment] = q1.w(), qEnd_[1][segment] = q1.x(), qEnd_[2][segment] = q1.y(), qEnd_[3][segment] = q1.z();
+    for (int i = 0; i < 3; i++)
+        rotationAxis_[i][segment] = rotationAxis(i);
+    return true;
+}
+
+int CompiledTrajectory::getNumSegments()
+{
+    return numSegments_;
+}
+
+/**
+ * @param segment Segment index
+ * \brief Returns the start time of the segment [s]
+ */
+double CompiledTrajectory::getSegmentStartTime(int segment)
+{
+    return startTimes_[std::min(std::max(segment, 0), MAX_SEGMENTS - 1)];
+}
+
+/**
+ * \brief Returns the end time of the last segment [s]
+ */
+double CompiledTrajectory::getTime()
+{
+    return duration_;
+}
+
+/**
+ * @param compiled Compiled trajectory to append the segments to
+ * @param startTime Time at which this trajectory starts in the compiled trajectory [s]
+ * \brief Append a copy of the segments, offset by the start time. Returns false if they do not all fit.
+ */
+bool CompiledTrajectory::compile(CompiledTrajectory &compiled, double startTime)
+{
+    for (int i = 0; i < numSegments_; i++)
+    {
+        int segment = compiled.appendSegment(startTime + startTimes_[i], durations_[i]);
+        if (segment < 0)
+            return false;
+
+        for (int axis = 0; axis < NUM_AXES; axis++)
+        {
+            for (int k = 0; k < 6; k++)
+                compiled.position_[axis][k][segment] = position_[axis][k][i];
+            for (int k = 0; k < 5; k++)
+                compiled.velocity_[axis][k][segment] = velocity_[axis][k][i];
+            for (int k = 0; k < 4; k++)
+                compiled.accel_[axis][k][segment] = accel_[axis][k][i];
+        }
+        for (int k = 0; k < 4; k++)
+        {
+            compiled.qStart_[k][segment] = qStart_[k][i];
+            compiled.qEnd_[k][segment] = qEnd_[k][i];
+        }
+        compiled.slerpTheta_[segment] = slerpTheta_[i];
+        compiled.slerpInvSinTheta_[segment] = slerpInvSinTheta_[i];
+        compiled.slerpCotTheta_[segment] = slerpCotTheta_[i];
+        compiled.slerpSign_[segment] = slerpSign_[i];
+        compiled.slerpLinear_[segment] = slerpLinear_[i];
+        for (int k = 0; k < 3; k++)
+            compiled.rotationAxis_[k][segment] = rotationAxis_[k][i];
+    }
+    return true;
+}
+
+/**
+ * @param time Time [s]
+ * \brief Returns the index of the segment containing the time: the number of segments that end at or before it
+ */
+int CompiledTrajectory::findSegment(double time) const
+{
+    int segment = 0;
+    for (int i = 0; i < MAX_SEGMENTS - 1; i++)
+        segment += (time >= endTimes_[i]);
+    return segment;
+}
+
+/**
+ * @param segment Segment index
+ * @param time Time [s]
+ * \brief Returns the normalized time in the segment, clamped to [0, 1]
+ */
+double CompiledTrajectory::computeTau(int segment, double time) const
+{
+    double tau = (time - startTimes_[segment]) * invDurations_[segment];
+    return std::min(std::max(tau, 0.0), 1.0);
+}
+
+/**
+ * @param segment Segment index
+ * @param tau Normalized time
+ * \brief Returns the attitude wrt I-frame, slerped between the segment's attitudes. At the end of the segment, returns the
+ * final attitude itself, like SimultaneousTrajectory after its duration (the slerp ends at -qEnd if it takes the
+ * short way around through the opposite sign).
+ */
+Eigen::Quaterniond CompiledTrajectory::computeQuaternion(int segment, double tau) const
+{
+    // sin((1 - tau) theta) / sin(theta) = cos(tau theta) - sin(tau theta) cos(theta) / sin(theta): one sine and cosine
+    double linear = slerpLinear_[segment];
+    double sign = (tau < 1.0) ? slerpSign_[segment] : 1.0;
+    double sinTau = sin(tau * slerpTheta_[segment]), cosTau = cos(tau * slerpTheta_[segment]);
+    double scale0 = linear * (1.0 - tau) + (1.0 - linear) * (cosTau - sinTau * slerpCotTheta_[segment]);
+    double scale1 = sign * (linear * tau + (1.0 - linear) * sinTau * slerpInvSinTheta_[segment]);
+
+    Eigen::Quaterniond quaternion(scale0 * qStart_[0][segment] + scale1 * qEnd_[0][segment],
+                                  scale0 * qStart_[1][segment] + scale1 * qEnd_[1][segment],
+                                  scale0 * qStart_[2][segment] + scale1 * qEnd_[2][segment],
+                                  scale0 * qStart_[3][segment] + scale1 * qEnd_[3][segment]);
+    quaternion.normalize();
+    return quaternion;
+}
+
+/**
+ * @param time Time to compute the state at
+ * Computes the trajectory state at the specified time
+ */
+Vector13d CompiledTrajectory::computeState(double time)
+{
+    Vector13d state = Vector13d::Zero();
+    if (numSegments_ == 0)
+        return state;
+
+    int segment = CompiledTrajectory::findSegment(time);
+    double tau = CompiledTrajectory::computeTau(segment, time);
+
+    // Horner's method
+    double pos[NUM_AXES], vel[NUM_AXES];
+    for (int axis = 0; axis < NUM_AXES; axis++)
+    {
+        const double(*p)[MAX_SEGMENTS] = position_[axis];
+        const double(*v)[MAX_SEGMENTS] = velocity_[axis];
+        pos[axis] = ((((p[5][segment] * tau + p[4][segment]) * tau + p[3][segment]) * tau + p[2][segment]) * tau + p[1][segment]) * tau + p[0][segment];
+        vel[axis] = (((v[4][segment] * tau + v[3][segment]) * tau + v[2][segment]) * tau + v[1][segment]) * tau + v[0][segment];
+    }
+
+    Eigen::Quaterniond quaternion = CompiledTrajectory::computeQuaternion(segment, tau);
+    Eigen::Vector3d uvw(vel[AXIS_X], vel[AXIS_Y], vel[AXIS_Z]);
+    uvw = quaternion.conjugate() * uvw; // Inertial velocity expressed in B-frame
+    Eigen::Vector3d axis(rotationAxis_[0][segment], rotationAxis_[1][segment], rotationAxis_[2][segment]);
+
+    state.segment<3>(auv_core::constants::STATE_XI) << pos[AXIS_X], pos[AXIS_Y], pos[AXIS_Z];
+    state.segment<3>(auv_core::constants::STATE_U) = uvw;
+    state.segment<4>(auv_core::constants::STATE_Q0) << quaternion.w(), quaternion.x(), quaternion.y(), quaternion.z();
+    state.segment<3>(auv_core::constants::STATE_P) = axis * vel[AXIS_ATT]; // Angular velocity expressed in B-frame
+    return state;
+}
+
+/**
+ * @param time Time to compute accelerations at
+ * Compute inertial translational acceleration and time-derivative of angular veocity,
+ * both expressed in B-frame, at specified time
+ */
+Vector6d CompiledTrajectory::computeAccel(double time)
+{
+    Vector6d accel = Vector6d::Zero();
+    if (numSegments_ == 0)
+        return accel;
+
+    int segment = CompiledTrajectory::findSegment(time);
+    double tau = CompiledTrajectory::computeTau(segment, time);
+
+    double acc[NUM_AXES];
+    for (int axis = 0; axis < NUM_AXES; axis++)
+    {
+        const double(*a)[MAX_SEGMENTS] = accel_[axis];
+        acc[axis] = ((a[3][segment] * tau + a[2][segment]) * tau + a[1][segment]) * tau + a[0][segment];
+    }
+
+    Eigen::Quaterniond quaternion = CompiledTrajectory::computeQuaternion(segment, tau);
+    Eigen::Vector3d inertialTransAccel(acc[AXIS_X], acc[AXIS_Y], acc[AXIS_Z]);
+    Eigen::Vector3d axis(rotationAxis_[0][segment], rotationAxis_[1][segment], rotationAxis_[2][segment]);
+
+    accel << quaternion.conjugate() * inertialTransAccel, axis * acc[AXIS_ATT]; // Both expressed in B-frame
+    return accel;
+}
+} // namespace auv_guidance
@@ -1,4 +1,5 @@
 #include "auv_guidance/long_trajectory.hpp"
+#include <algorithm>
 
 namespace auv_guidance
 {
@@ -9,12 +10,15 @@ namespace auv_guidance
  * @param accelDuration Desired acceleration duration [s]
  * @param cruiseRatio Indicates what fraction of the total distance is to be traveled while cruising
  * @param cruiseSpeed Vehicle speed while cruising
+ * @param arena Arena that owns the waypoints and segments
  */
-LongTrajectory::LongTrajectory(Waypoint *wStart, Waypoint *wEnd, TGenLimits *tGenLimits, double cruiseRatio, double cruiseSpeed)
+LongTrajectory::LongTrajectory(Waypoint *wStart, Waypoint *wEnd, TGenLimits *tGenLimits, double cruiseRatio, double cruiseSpeed,
+                               TrajectoryArena *arena)
 {
     wStart_ = wStart;
     wEnd_ = wEnd;
     tGenLimits_ = tGenLimits;
+    arena_ = arena;
 
     totalDuration_ = 0;
     rotationDuration1_ = 0;
@@ -83,9 +87,7 @@ void LongTrajectory::initWaypoints()
     Eigen::Vector4d transEnd = Eigen::Vector4d::Zero();
     transStart << 0, 0, 0, tGenLimits_->xyzJerk(accelDistance);
     transEnd << accelDistance, 0, 0, tGenLimits_->xyzJerk(accelDistance);
-    MinJerkTimeSolver *mjts;
-    mjts = new MinJerkTimeSolver(transStart, transEnd);
-    accelDuration_ = mjts->getTime();
+    accelDuration_ = MinJerkTimeCache::shared().getTime(transStart, transEnd);
 
     // Init position vectors and cruise duration
     cruiseStartPos_ = wStart_->posI() + accelDistance * unitVec_;
@@ -96,10 +98,10 @@ void LongTrajectory::initWaypoints()
     // Init waypoints: pre-translate -> cruise start -> cruise end -> post-translate
     // Pre/Post translate waypoints are at rest
     Eigen::Vector3d zero3d = Eigen::Vector3d::Zero();
-    wPreTranslate_ = new Waypoint(wStart_->posI(), zero3d, zero3d, qCruise_, zero3d);
-    wCruiseStart_ = new Waypoint(cruiseStartPos_, cruiseVel_, zero3d, qCruise_, zero3d);
-    wCruiseEnd_ = new Waypoint(cruiseEndPos_, cruiseVel_, zero3d, qCruise_, zero3d);
-    wPostTranslate_ = new Waypoint(wEnd_->posI(), zero3d, zero3d, qCruise_, zero3d);
+    wPreTranslate_ = arena_->create<Waypoint>(wStart_->posI(), zero3d, zero3d, qCruise_, zero3d);
+    wCruiseStart_ = arena_->create<Waypoint>(cruiseStartPos_, cruiseVel_, zero3d, qCruise_, zero3d);
+    wCruiseEnd_ = arena_->create<Waypoint>(cruiseEndPos_, cruiseVel_, zero3d, qCruise_, zero3d);
+    wPostTranslate_ = arena_->create<Waypoint>(wEnd_->posI(), zero3d, zero3d, qCruise_, zero3d);
 }
 
 void LongTrajectory::initSimultaneousTrajectories()
@@ -113,39 +115,39 @@ void LongTrajectory::initSimultaneousTrajectories()
     {
         qDiff = qStart_.conjugate() * qCruise_;
         rotationDuration1_ = LongTrajectory::computeRotationTime(qDiff);
-        stPreRotation_ = new SimultaneousTrajectory(wStart_, wPreTranslate_, rotationDuration1_);
+        stPreRotation_ = arena_->create<SimultaneousTrajectory>(wStart_, wPreTranslate_, rotationDuration1_, arena_);
         stList_.push_back(stPreRotation_);
         totalDuration_ += rotationDuration1_;
         stTimes_.push_back(totalDuration_);
     }
 
-    stSpeedUp_ = new SimultaneousTrajectory(wPreTranslate_, wCruiseStart_, accelDuration_);
+    stSpeedUp_ = arena_->create<SimultaneousTrajectory>(wPreTranslate_, wCruiseStart_, accelDuration_, arena_);
     stList_.push_back(stSpeedUp_);
     totalDuration_ += accelDuration_;
     stTimes_.push_back(totalDuration_);
 
-    stCruise_ = new SimultaneousTrajectory(wCruiseStart_, wCruiseEnd_, cruiseDuration_);
+    stCruise_ = arena_->create<SimultaneousTrajectory>(wCruiseStart_, wCruiseEnd_, cruiseDuration_, arena_);
     stList_.push_back(stCruise_);
     totalDuration_ += cruiseDuration_;
     stTimes_.push_back(totalDuration_);
 
-    stSlowDown_ = new SimultaneousTrajectory(wCruiseEnd_, wPostTranslate_, accelDuration_);
+    stSlowDown_ = arena_->create<SimultaneousTrajectory>(wCruiseEnd_, wPostTranslate_, accelDuration_, arena_);
     stList_.push_back(stSlowDown_);
     totalDuration_ += accelDuration_;
     stTimes_.push_back(totalDuration_);
 
     qDiff = qCruise_.conjugate() * qEnd_;
     rotationDuration2_ = LongTrajectory::computeRotationTime(qDiff);
-    stPostRotation_ = new SimultaneousTrajectory(wPostTranslate_, wEnd_, rotationDuration2_);
+    stPostRotation_ = arena_->create<SimultaneousTrajectory>(wPostTranslate_, wEnd_, rotationDuration2_, arena_);
     stList_.push_back(stPostRotation_);
     totalDuration_ += rotationDuration2_;
     stTimes_.push_back(totalDuration_);
 
-    std::cout << "LT: set travel heading duration: " << rotationDuration1_ << std::endl;
-    std::cout << "LT: speed up duration: " << accelDuration_ << std::endl;
-    std::cout << "LT: cruise duration: " << cruiseDuration_ << std::endl;
-    std::cout << "LT: slow down duration: " << accelDuration_ << std::endl;
-    std::cout << "LT: final rotation duration: " << rotationDuration2_ << std::endl;
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "LT: set travel heading duration: %g", rotationDuration1_);
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "LT: speed up duration: %g", accelDuration_);
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "LT: cruise duration: %g", cruiseDuration_);
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "LT: slow down duration: %g", accelDuration_);
+    AUV_LOG(auv_core::AsyncLogger::LEVEL_DEBUG, "LT: final rotation duration: %g", rotationDuration2_);
 }
 
 /**
@@ -161,10 +163,7 @@ double LongTrajectory::computeRotationTime(Eigen::Quaterniond qDiff)
     rotStart << 0, 0, 0, tGenLimits_->rotJerk(angularDistance);
     rotEnd << angularDistance, 0, 0, tGenLimits_->rotJerk(angularDistance);
 
-    MinJerkTimeSolver *mjts;
-    mjts = new MinJerkTimeSolver(rotStart, rotEnd);
-
-    return mjts->getTime();
+    return MinJerkTimeCache::shared().getTime(rotStart, rotEnd);
 }
 
 double LongTrajectory::getTime()
@@ -172,42 +171,90 @@ double LongTrajectory::getTime()
     return totalDuration_;
 }
 
+int LongTrajectory::getNumSegments()
+{
+    return stList_.size();
+}
+
 /**
- * @param time Time to compute the state at
- * Computes the trajectory state at the specified time
+ * @param time Time [s]
+ * @param hint Segment to start looking from (usually the segment of the previous, earlier time)
+ * \brief Returns the segment that is active at the specified time: the first one that ends after it (the first one before
+ * the trajectory starts, the last one after it ends). When the time is not before the hinted segment, steps forward
+ * from it, so a sequence of increasing times costs amortized O(1) per lookup. Otherwise (random access, or more than
+ * MAX_CURSOR_STEPS segments ahead), falls back to a binary search.
  */
-Vector13d LongTrajectory::computeState(double time)
+int LongTrajectory::findSegment(double time, int hint)
 {
-    if (time < 0)
-        return stList_.front()->computeState(time);
-    if (time > totalDuration_)
-        return stList_.back()->computeState(time);
+    int last = stTimes_.size() - 1;
+    if (hint < 0 || hint > last)
+        hint = 0;
 
-    for (int i = 0; i < stList_.size(); i++)
+    int i = hint;
+    if (hint == 0 || time >= stTimes_[hint - 1])
     {
-        if (time < stTimes_[i])
+        for (int steps = 0; steps < MAX_CURSOR_STEPS && i < last; steps++, i++)
         {
-            double t = (i==0) ? time : time- stTimes_[i-1];
-            //std::cout << "BT: compute state from ST " << i << "at time " << t << std::endl;
-            return stList_[i]->computeState(t);
+            if (time < stTimes_[i])
+                return i;
         }
+        if (i == last)
+            return last;
     }
+    else
+        i = 0;
+
+    // The last segment's end time is not searched: the last segment also holds its final state after it
+    return std::upper_bound(stTimes_.begin() + i, stTimes_.begin() + last, time) - stTimes_.begin();
+}
+
+/**
+ * @param segment Segment index (see findSegment)
+ * @param time Time to compute the state at, from the start of the trajectory [s]
+ */
+Vector13d LongTrajectory::computeSegmentState(int segment, double time)
+{
+    double t = (segment == 0) ? time : time - stTimes_[segment - 1];
+    return stList_[segment]->computeState(t);
+}
+
+/**
+ * @param segment Segment index (see findSegment)
+ * @param time Time to compute the acceleration at, from the start of the trajectory [s]
+ */
+Vector6d LongTrajectory::computeSegmentAccel(int segment, double time)
+{
+    double t = (segment == 0) ? time : time - stTimes_[segment - 1];
+    return stList_[segment]->computeAccel(t);
+}
+
+/**
+ * @param time Time to compute the state at
+ * Computes the trajectory state at the specified time. Keeps no state, so concurrent readers are safe (a
+ * LongTrajectoryCursor keeps the segment between calls instead).
+ */
+Vector13d LongTrajectory::computeState(double time)
+{
+    return LongTrajectory::computeSegmentState(LongTrajectory::findSegment(time, 0), time);
 }
 
 Vector6d LongTrajectory::computeAccel(double time)
 {
-    if (time < 0)
-        return stList_.front()->computeAccel(time);
-    if (time > totalDuration_)
-        return stList_.back()->computeAccel(time);
+    return LongTrajectory::computeSegmentAccel(LongTrajectory::findSegment(time, 0), time);
+}
 
+/**
+ * @param compiled Compiled trajectory to append the segments to
+ * @param startTime Time at which this trajectory starts in the compiled trajectory [s]
+ */
+bool LongTrajectory::compile(CompiledTrajectory &compiled, double startTime)
+{
     for (int i = 0; i < stList_.size(); i++)
     {
-        if (time < stTimes_[i])
-        {
-            double t = (i==0) ? time : time - stTimes_[i-1];
-            return stList_[i]->computeAccel(t);
-        }
+        double segmentStart = (i == 0) ? startTime : startTime + stTimes_[i - 1];
+        if (!stList_[i]->compile(compiled, segmentStart))
+            return false;
     }
+    return true;
 }
 } // namespace auv_guidance
\ No newline at end of file
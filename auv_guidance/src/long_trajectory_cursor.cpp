@@ -0,0 +1,47 @@
+#include "auv_guidance/long_trajectory_cursor.hpp"
+
+namespace auv_guidance
+{
+/**
+ * @param trajectory Trajectory to read (not owned)
+ */
+LongTrajectoryCursor::LongTrajectoryCursor(LongTrajectory *trajectory)
+{
+    trajectory_ = trajectory;
+    segment_ = 0;
+}
+
+/**
+ * \brief Move the cursor back to the first segment
+ */
+void LongTrajectoryCursor::reset()
+{
+    segment_ = 0;
+}
+
+/**
+ * \brief Returns the segment of the last query
+ */
+int LongTrajectoryCursor::getSegment()
+{
+    return segment_;
+}
+
+/**
+ * @param time Time to compute the state at [s]
+ */
+Vector13d LongTrajectoryCursor::computeState(double time)
+{
+    segment_ = trajectory_->findSegment(time, segment_);
+    return trajectory_->computeSegmentState(segment_, time);
+}
+
+/**
+ * @param time Time to compute the acceleration at [s]
+ */
+Vector6d LongTrajectoryCursor::computeAccel(double time)
+{
+    segment_ = trajectory_->findSegment(time, segment_);
+    return trajectory_->computeSegmentAccel(segment_, time);
+}
+} // namespace auv_guidance
@@ -0,0 +1,212 @@
+#include "auv_guidance/min_jerk_time_cache.hpp"
+
+namespace auv_guidance
+{
+bool MinJerkTimeCache::Key::operator==(const Key &other) const
+{
+    for (int i = 0; i < KEY_SIZE; i++)
+    {
+        if (values[i] != other.values[i])
+            return false;
+    }
+    return true;
+}
+
+size_t MinJerkTimeCache::KeyHash::operator()(const Key &key) const
+{
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a over the quantized values
+    for (int i = 0; i < KEY_SIZE; i++)
+    {
+        hash ^= (uint64_t)key.values[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * @param capacity Maximum number of cached durations (zero: disabled)
+ * @param resolution Quantization step of the boundary conditions [SI units]
+ */
+MinJerkTimeCache::MinJerkTimeCache(size_t capacity, double resolution)
+{
+    capacity_ = capacity;
+    resolution_ = (resolution > 0) ? resolution : 1e-6;
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+    index_.reserve(capacity_);
+}
+
+/**
+ * \brief Returns the cache shared by all trajectories in the process
+ */
+MinJerkTimeCache &MinJerkTimeCache::shared()
+{
+    static MinJerkTimeCache cache;
+    return cache;
+}
+
+/**
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * \brief Quantize the boundary conditions (call with the mutex locked)
+ */
+MinJerkTimeCache::Key MinJerkTimeCache::makeKey(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end)
+{
+    double values[KEY_SIZE] = {end(0) - start(0), start(1), start(2), end(1), end(2), 0.5 * (start(3) + end(3))};
+    Key key;
+    for (int i = 0; i < KEY_SIZE; i++)
+        key.values[i] = llround(values[i] / resolution_);
+    return key;
+}
+
+/**
+ * \brief Evict the least recently used entries until the cache fits its capacity (call with the mutex locked)
+ */
+void MinJerkTimeCache::trim()
+{
+    while (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+        evictions_++;
+    }
+}
+
+/**
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * \brief Returns the min jerk trajectory duration (see MinJerkTimeSolver), from the cache if the quantized boundary
+ * conditions have been solved before
+ */
+double MinJerkTimeCache::getTime(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (capacity_ == 0)
+    {
+        lock.unlock();
+        misses_++;
+        return MinJerkTimeSolver(start, end).getTime();
+    }
+
+    Key key = MinJerkTimeCache::makeKey(start, end);
+    double resolution = resolution_;
+    EntryMap::iterator it = index_.find(key);
+    if (it != index_.end())
+    {
+        entries_.splice(entries_.begin(), entries_, it->second); // Most recently used
+        hits_++;
+        return it->second->time;
+    }
+
+    // Solve the quantized conditions without holding the lock
+    lock.unlock();
+    misses_++;
+    Eigen::Vector4d quantizedStart, quantizedEnd;
+    quantizedStart << 0, key.values[1] * resolution, key.values[2] * resolution, key.values[5] * resolution;
+    quantizedEnd << key.values[0] * resolution, key.values[3] * resolution, key.values[4] * resolution, key.values[5] * resolution;
+    double time = MinJerkTimeSolver(quantizedStart, quantizedEnd).getTime();
+
+    // Another thread may have solved the same conditions (or changed the resolution) in the meantime
+    lock.lock();
+    if (resolution_ == resolution && capacity_ > 0 && index_.find(key) == index_.end())
+    {
+        Entry entry;
+        entry.key = key;
+        entry.time = time;
+        entries_.push_front(entry);
+        index_[key] = entries_.begin();
+        MinJerkTimeCache::trim();
+    }
+    return time;
+}
+
+/**
+ * @param capacity Maximum number of cached durations (zero: disabled). Evicts the least recently used entries if the
+ * cache no longer fits.
+ */
+void MinJerkTimeCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    MinJerkTimeCache::trim();
+}
+
+size_t MinJerkTimeCache::getCapacity()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+/**
+ * @param resolution Quantization step of the boundary conditions [SI units]. Clears the cache if it changes.
+ */
+void MinJerkTimeCache::setResolution(double resolution)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (resolution <= 0 || resolution == resolution_)
+        return;
+    resolution_ = resolution;
+    index_.clear();
+    entries_.clear();
+}
+
+double MinJerkTimeCache::getResolution()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resolution_;
+}
+
+/**
+ * \brief Returns the number of cached durations
+ */
+size_t MinJerkTimeCache::size()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+/**
+ * \brief Remove all cached durations (the statistics are kept)
+ */
+void MinJerkTimeCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    entries_.clear();
+}
+
+uint64_t MinJerkTimeCache::getHits()
+{
+    return hits_.load(std::memory_order_relaxed);
+}
+
+uint64_t MinJerkTimeCache::getMisses()
+{
+    return misses_.load(std::memory_order_relaxed);
+}
+
+uint64_t MinJerkTimeCache::getEvictions()
+{
+    return evictions_.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the fraction of queries answered from the cache (zero if there were none)
+ */
+double MinJerkTimeCache::getHitRate()
+{
+    double hits = MinJerkTimeCache::getHits(), misses = MinJerkTimeCache::getMisses();
+    return (hits + misses > 0) ? hits / (hits + misses) : 0.0;
+}
+
+/**
+ * \brief Clear the hit, miss, and eviction counts
+ */
+void MinJerkTimeCache::resetStatistics()
+{
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+}
+} // namespace auv_guidance
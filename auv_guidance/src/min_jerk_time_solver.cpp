@@ -3,21 +3,172 @@
 namespace auv_guidance
 {
 /**
- * @param start Initial conditions of position, velocity, and acceleration.
- * @param end Final conditions of position, velocity, and acceleration
- * @param duration Duration for which trajectory will occur
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * @param solver SOLVER_ANALYTIC or SOLVER_CERES
  */
-MinJerkTimeSolver::MinJerkTimeSolver(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end)
+MinJerkTimeSolver::MinJerkTimeSolver(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end, int solver)
 {
-    minTime_ = 0;
-    problemMTTS_.AddResidualBlock(new ceres::AutoDiffCostFunction<MonotonicTrajectoryTimeSolver, 1, 1>(new MonotonicTrajectoryTimeSolver(start, end)), NULL, &minTime_);
-    problemMTTS_.SetParameterLowerBound(&minTime_, 0, 0.0);
-    optionsMTTS_.max_num_iterations = 100;
-    optionsMTTS_.linear_solver_type = ceres::DENSE_QR;
+    start_ = start;
+    end_ = end;
+    if (solver == MinJerkTimeSolver::SOLVER_CERES)
+        minTime_ = MinJerkTimeSolver::solveCeres(start, end);
+    else
+        minTime_ = MinJerkTimeSolver::solveAnalytic(start, end);
+}
+
+/**
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * @param c Coefficients of the distance error, constant term first
+ * \brief Computes the coefficients of the distance error (a cubic in the duration). Rest to rest (v0 = vf = 0), v0 is
+ * replaced with 0.001, like MonotonicTrajectoryTimeSolver does for Ceres.
+ */
+void MinJerkTimeSolver::computeCoefficients(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end,
+                                            double c[4])
+{
+    double v0 = (start(1) == 0 && end(1) == 0) ? 0.001 : start(1);
+    c[0] = -(end(0) - start(0));
+    c[1] = (v0 + end(1)) / 2.0;
+    c[2] = (start(2) - end(2)) / 10.0;
+    c[3] = (start(3) + end(3)) / 120.0;
+}
+
+/**
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * @param duration Duration of the trajectory
+ * \brief Returns the distance covered by the min jerk velocity profile in the duration, minus the distance to cover
+ * (zero at the solution of both solvers, including the rest to rest perturbation)
+ */
+double MinJerkTimeSolver::computeDistanceError(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end,
+                                               double duration)
+{
+    double c[4];
+    MinJerkTimeSolver::computeCoefficients(start, end, c);
+    return ((c[3] * duration + c[2]) * duration + c[1]) * duration + c[0];
+}
+
+/**
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * \brief Returns the smallest non-negative root of the distance error (a cubic). Between its stationary points the cubic
+ * is monotonic, so each interval holds at most one root, found by safeguarded Newton iterations. If there is no root,
+ * returns the point closest to one (smallest error among zero and the stationary points), like a least-squares solver.
+ */
+double MinJerkTimeSolver::solveAnalytic(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end)
+{
+    double c[4];
+    MinJerkTimeSolver::computeCoefficients(start, end, c);
+    if (c[0] == 0)
+        return 0;
+
+    // Degree, ignoring leading coefficients that are negligible relative to the others
+    double scale = std::max(std::max(fabs(c[0]), fabs(c[1])), std::max(fabs(c[2]), fabs(c[3])));
+    int degree = 3;
+    while (degree > 0 && fabs(c[degree]) <= 1e-15 * scale)
+        degree--;
+    if (degree == 0)
+        return 0; // Constant, no root
+
+    // Breakpoints: zero, the positive stationary points in increasing order (roots of 3c3 t^2 + 2c2 t + c1), and an
+    // upper bound on the roots (Cauchy bound)
+    double breakpoints[4];
+    int numBreakpoints = 0;
+    breakpoints[numBreakpoints++] = 0;
+    if (degree == 3)
+    {
+        double a = 3.0 * c[3], b = 2.0 * c[2], discriminant = b * b - 4.0 * a * c[1];
+        if (discriminant >= 0)
+        {
+            double q = -0.5 * (b + ((b >= 0) ? sqrt(discriminant) : -sqrt(discriminant)));
+            double t1 = q / a, t2 = (q != 0) ? c[1] / q : t1;
+            if (t1 > t2)
+                std::swap(t1, t2);
+            if (t1 > 0)
+                breakpoints[numBreakpoints++] = t1;
+            if (t2 > 0 && t2 != t1)
+                breakpoints[numBreakpoints++] = t2;
+        }
+    }
+    else if (degree == 2 && -c[1] / (2.0 * c[2]) > 0)
+    {
+        breakpoints[numBreakpoints++] = -c[1] / (2.0 * c[2]);
+    }
+    double bound = 0;
+    for (int i = 0; i < degree; i++)
+        bound = std::max(bound, fabs(c[i] / c[degree]));
+    double upper = std::max(1.0 + bound, breakpoints[numBreakpoints - 1]);
+    breakpoints[numBreakpoints++] = upper;
+
+    for (int i = 0; i + 1 < numBreakpoints; i++)
+    {
+        double lo = breakpoints[i], hi = breakpoints[i + 1];
+        double fLo = ((c[3] * lo + c[2]) * lo + c[1]) * lo + c[0];
+        double fHi = ((c[3] * hi + c[2]) * hi + c[1]) * hi + c[0];
+        if (fLo == 0)
+            return lo;
+        if ((fLo < 0) == (fHi < 0) && fHi != 0)
+            continue;
+
+        // Monotonic on [lo, hi] with a sign change: Newton steps, bisecting whenever a step leaves the bracket
+        double t = 0.5 * (lo + hi);
+        for (int iter = 0; iter < 100; iter++)
+        {
+            double f = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+            double df = (3.0 * c[3] * t + 2.0 * c[2]) * t + c[1];
+            if (f == 0)
+                break;
+            if ((f < 0) == (fLo < 0))
+                lo = t;
+            else
+                hi = t;
+
+            double next = (df != 0) ? t - f / df : 0.5 * (lo + hi);
+            if (!(next > lo && next < hi))
+                next = 0.5 * (lo + hi);
+            bool converged = fabs(next - t) <= 1e-15 * std::max(1.0, fabs(t));
+            t = next;
+            if (converged)
+                break;
+        }
+        return t;
+    }
+
+    // No root
+    double best = 0, bestError = fabs(c[0]);
+    for (int i = 1; i + 1 < numBreakpoints; i++)
+    {
+        double t = breakpoints[i];
+        double error = fabs(((c[3] * t + c[2]) * t + c[1]) * t + c[0]);
+        if (error < bestError)
+        {
+            best = t;
+            bestError = error;
+        }
+    }
+    return best;
+}
+
+/**
+ * @param start Initial conditions of position, velocity, acceleration, and jerk
+ * @param end Final conditions of position, velocity, acceleration, and jerk
+ * \brief Solve for the duration with Ceres, starting from zero
+ */
+double MinJerkTimeSolver::solveCeres(const Eigen::Ref<const Eigen::Vector4d> &start, const Eigen::Ref<const Eigen::Vector4d> &end)
+{
+    ceres::Problem problem;
+    ceres::Solver::Options options;
+    ceres::Solver::Summary summary;
+    double minTime = 0;
 
-    ceres::Solve(optionsMTTS_, &problemMTTS_, &summaryMTTS_);
+    problem.AddResidualBlock(new ceres::AutoDiffCostFunction<MonotonicTrajectoryTimeSolver, 1, 1>(new MonotonicTrajectoryTimeSolver(start, end)), NULL, &minTime);
+    problem.SetParameterLowerBound(&minTime, 0, 0.0);
+    options.max_num_iterations = 100;
+    options.linear_solver_type = ceres::DENSE_QR;
 
-    mjt_ = new MinJerkTrajectory(start.head<3>(), end.head<3>(), minTime_);
+    ceres::Solve(options, &problem, &summary);
+    return minTime;
 }
 
 /**
@@ -30,7 +181,8 @@ double MinJerkTimeSolver::getTime()
 
 double MinJerkTimeSolver::getMiddleVelocity()
 {
-    Eigen::Vector3d state =  mjt_->computeState(minTime_ / 2.0);
+    MinJerkTrajectory mjt(start_.head<3>(), end_.head<3>(), minTime_);
+    Eigen::Vector3d state = mjt.computeState(minTime_ / 2.0);
     return state(1);
 }
-} // namespace auv_guidance
\ No newline at end of file
+} // namespace auv_guidance
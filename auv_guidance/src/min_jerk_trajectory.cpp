@@ -73,4 +73,19 @@ double MinJerkTrajectory::getMiddleVelocity()
     return state(1);
 }
 
+double MinJerkTrajectory::getDuration()
+{
+    return tf_ - t0_;
+}
+
+/**
+ * Returns the position polynomial coefficients in normalized time tau = (t - t0) / duration, lowest order first
+ */
+Eigen::Matrix<double, 6, 1> MinJerkTrajectory::getCoeffs()
+{
+    Eigen::Matrix<double, 6, 1> coeffs;
+    coeffs << c0_, c1_, c2_, c3_, c4_, c5_;
+    return coeffs;
+}
+
 } // namespace auv_guidance
\ No newline at end of file
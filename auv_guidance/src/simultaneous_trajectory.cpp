@@ -6,9 +6,11 @@ namespace auv_guidance
  * @param start Starting waypoint
  * @param end Ending waypoint
  * @param travelDuration Desired travel duration [s]
+ * @param arena Arena that owns the min jerk trajectories
  */
-SimultaneousTrajectory::SimultaneousTrajectory(Waypoint *start, Waypoint *end, double duration)
+SimultaneousTrajectory::SimultaneousTrajectory(Waypoint *start, Waypoint *end, double duration, TrajectoryArena *arena)
 {
+    arena_ = arena;
     wStart_ = start;
     wEnd_ = end;
     totalDuration_ = duration;
@@ -46,10 +48,10 @@ void SimultaneousTrajectory::initTrajectory()
     angleStart(1) = angVel;
     angleEnd(0) = angularDistance_;
 
-    mjtX_ = new MinJerkTrajectory(wStart_->xI(), wEnd_->xI(), totalDuration_);
-    mjtY_ = new MinJerkTrajectory(wStart_->yI(), wEnd_->yI(), totalDuration_);
-    mjtZ_ = new MinJerkTrajectory(wStart_->zI(), wEnd_->zI(), totalDuration_);
-    mjtAtt_ = new MinJerkTrajectory(angleStart, angleEnd, totalDuration_);
+    mjtX_ = arena_->create<MinJerkTrajectory>(wStart_->xI(), wEnd_->xI(), totalDuration_);
+    mjtY_ = arena_->create<MinJerkTrajectory>(wStart_->yI(), wEnd_->yI(), totalDuration_);
+    mjtZ_ = arena_->create<MinJerkTrajectory>(wStart_->zI(), wEnd_->zI(), totalDuration_);
+    mjtAtt_ = arena_->create<MinJerkTrajectory>(angleStart, angleEnd, totalDuration_);
 }
 
 double SimultaneousTrajectory::getTime()
@@ -145,4 +147,14 @@ Vector6d SimultaneousTrajectory::computeAccel(double time)
     accel << inertialTransAccel, pqrDot; // Both expressed in B-frame
     return accel;
 }
+
+/**
+ * @param compiled Compiled trajectory to append the segment to
+ * @param startTime Time at which this trajectory starts in the compiled trajectory [s]
+ */
+bool SimultaneousTrajectory::compile(CompiledTrajectory &compiled, double startTime)
+{
+    MinJerkTrajectory *mjt[CompiledTrajectory::NUM_AXES] = {mjtX_, mjtY_, mjtZ_, mjtAtt_};
+    return compiled.addSegment(startTime, totalDuration_, mjt, qStart_, noRotation_ ? qStart_ : qEnd_, rotationAxis_);
+}
 } // namespace auv_guidance
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "auv_guidance/trajectory_arena.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace auv_guidance
+{
+/**
+ * @param blockSize Size of each block [bytes] (larger objects get a block of their own)
+ */
+TrajectoryArena::TrajectoryArena(size_t blockSize)
+{
+    blockSize_ = std::max(blockSize, (size_t)BLOCK_ALIGNMENT);
+    first_ = NULL;
+    current_ = NULL;
+    destructors_ = NULL;
+    numObjects_ = 0;
+}
+
+TrajectoryArena::~TrajectoryArena()
+{
+    TrajectoryArena::release();
+}
+
+/**
+ * @param size Number of bytes
+ * @param alignment Alignment of the memory (power of two, at most BLOCK_ALIGNMENT)
+ * \brief Returns uninitialized memory that lives until the arena is reset. Uses the current block if the memory fits,
+ * then the blocks kept by reset(), and allocates a new block otherwise.
+ */
+void *TrajectoryArena::allocate(size_t size, size_t alignment)
+{
+    alignment = std::min(std::max(alignment, (size_t)1), (size_t)BLOCK_ALIGNMENT);
+    while (current_ != NULL)
+    {
+        size_t offset = (current_->used + alignment - 1) & ~(alignment - 1);
+        if (offset + size <= current_->size)
+        {
+            current_->used = offset + size;
+            return current_->data + offset;
+        }
+        if (current_->next == NULL)
+            break;
+        current_ = current_->next; // Rewound by reset()
+        current_->used = 0;
+    }
+
+    // New block: header, then the data at the next cache line
+    size_t headerSize = (sizeof(Block) + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+    size_t dataSize = std::max(blockSize_, size);
+    void *memory = NULL;
+    if (posix_memalign(&memory, BLOCK_ALIGNMENT, headerSize + dataSize) != 0)
+        throw std::bad_alloc();
+
+    Block *block = static_cast<Block *>(memory);
+    block->next = NULL;
+    block->size = dataSize;
+    block->used = size;
+    block->data = static_cast<char *>(memory) + headerSize;
+    if (current_ == NULL)
+        first_ = block;
+    else
+        current_->next = block;
+    current_ = block;
+    return block->data;
+}
+
+/**
+ * \brief Destroy every object in the arena (most recently created first), and rewind the blocks (they are kept for the
+ * next trajectory). Pointers to the objects are no longer valid.
+ */
+void TrajectoryArena::reset()
+{
+    while (destructors_ != NULL)
+    {
+        Destructor *destructor = destructors_;
+        destructors_ = destructor->next;
+        destructor->destroy(destructor->object);
+    }
+    numObjects_ = 0;
+
+    current_ = first_;
+    if (current_ != NULL)
+        current_->used = 0;
+}
+
+/**
+ * \brief Destroy every object in the arena and free its blocks
+ */
+void TrajectoryArena::release()
+{
+    TrajectoryArena::reset();
+    while (first_ != NULL)
+    {
+        Block *block = first_;
+        first_ = block->next;
+        free(block);
+    }
+    current_ = NULL;
+}
+
+/**
+ * \brief Returns the number of objects created since the last reset
+ */
+size_t TrajectoryArena::getNumObjects()
+{
+    return numObjects_;
+}
+
+/**
+ * \brief Returns the number of bytes in use since the last reset (including alignment padding)
+ */
+size_t TrajectoryArena::getBytesUsed()
+{
+    size_t used = 0;
+    for (Block *block = first_; block != NULL; block = block->next)
+    {
+        used += block->used;
+        if (block == current_)
+            break;
+    }
+    return used;
+}
+
+/**
+ * \brief Returns the number of bytes in the arena's blocks
+ */
+size_t TrajectoryArena::getBytesReserved()
+{
+    size_t reserved = 0;
+    for (Block *block = first_; block != NULL; block = block->next)
+        reserved += block->size;
+    return reserved;
+}
+
+size_t TrajectoryArena::getNumBlocks()
+{
+    size_t numBlocks = 0;
+    for (Block *block = first_; block != NULL; block = block->next)
+        numBlocks++;
+    return numBlocks;
+}
+} // namespace auv_guidance